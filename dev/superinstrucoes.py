@@ -0,0 +1,263 @@
+# Escolhe as superinstruções do Loxie a partir de perfis das instruções
+#
+# Os perfis vêm de um build com PROFILE_OPS=Y: cada linha é a quantidade de
+# vezes que uma sequência de instruções seguidas foi executada, e os OpCodes
+# da sequência (em números). Vários perfis são somados
+#
+# Uso:
+#   python3 dev/superinstrucoes.py perfil.txt [-n 8] [-o inc/superinstructions.h]
+#
+# Sem -o, só mostra a escolha. Veja o README para o passo a passo
+
+import argparse
+import re
+import sys
+import zlib
+from pathlib import Path
+
+RAIZ = Path(__file__).resolve().parent.parent
+
+# Instruções que podem fazer parte de uma superinstrução, com o tamanho dos
+# seus operandos. Cada uma precisa de um SUPER_STEP_* em src/vm.c (e, se
+# tiver operandos, de um caso em _superOp, em src/debug.c)
+COMPONENTES = {
+    "OP_CONST_16": 1,
+    "OP_TRUE": 0,
+    "OP_FALSE": 0,
+    "OP_NIL": 0,
+    "OP_POP": 0,
+    "OP_DUP": 0,
+    "OP_GET_GLOBAL_16": 1,
+    "OP_SET_GLOBAL_16": 1,
+    "OP_GET_LOCAL_16": 1,
+    "OP_SET_LOCAL_16": 1,
+    "OP_GET_UPVALUE_16": 1,
+    "OP_EQUAL": 0,
+    "OP_GREATER": 0,
+    "OP_GREATER_EQUAL": 0,
+    "OP_LESS": 0,
+    "OP_LESS_EQUAL": 0,
+    "OP_ADD": 0,
+    "OP_SUB": 0,
+    "OP_MUL": 0,
+    "OP_DIV": 0,
+    "OP_MOD": 0,
+    "OP_NEGATE": 0,
+    "OP_NOT": 0,
+    "OP_JUMP_IF_FALSE": 2,
+    "OP_JUMP_IF_TRUE": 2,
+    "OP_JUMP": 2,
+    "OP_LOOP": 2,
+}
+
+# Instruções que sempre pulam, e por isso só podem ser a última da sequência
+SEMPRE_PULAM = {"OP_JUMP", "OP_LOOP"}
+
+# Mesmo valor de PROFILE_MAX_GRAM (inc/profile.h) e de SUPER_MAX_COUNT
+# (inc/opcodes.h)
+MAIOR_SEQUENCIA = 4
+
+
+def ler_opcodes():
+    """Nome de cada OpCode numerado em inc/opcodes.h"""
+    texto = (RAIZ / "inc" / "opcodes.h").read_text(encoding="utf-8")
+    return {
+        int(numero): nome
+        for nome, numero in re.findall(r"\b(OP_\w+)\s*=\s*(\d+)", texto)
+    }
+
+
+def ler_perfis(caminhos, opcodes):
+    """Soma as contagens dos perfis. As instruções especializadas em números
+    contam como a genérica, que é o que o compilador emite"""
+    contagens = {}
+    total = 0
+
+    for caminho in caminhos:
+        with open(caminho, encoding="utf-8") as arquivo:
+            for linha in arquivo:
+                campos = linha.split()
+                if len(campos) < 2:
+                    continue
+
+                nomes = []
+                for campo in campos[1:]:
+                    nome = opcodes.get(int(campo), "?")
+                    if nome.endswith("_NUM"):
+                        nome = nome[: -len("_NUM")]
+                    nomes.append(nome)
+
+                contagem = int(campos[0])
+                sequencia = tuple(nomes)
+                contagens[sequencia] = contagens.get(sequencia, 0) + contagem
+                if len(sequencia) == 1:
+                    total += contagem
+
+    return contagens, total
+
+
+def pode_juntar(sequencia):
+    if not 2 <= len(sequencia) <= MAIOR_SEQUENCIA:
+        return False
+    if any(nome not in COMPONENTES for nome in sequencia):
+        return False
+    return all(nome not in SEMPRE_PULAM for nome in sequencia[:-1])
+
+
+def contem(maior, menor):
+    """Se @a menor aparece seguida dentro de @a maior"""
+    n = len(menor)
+    return any(maior[i : i + n] == menor for i in range(len(maior) - n + 1))
+
+
+def cruza(a, b):
+    """Se o fim de uma sequência é o começo da outra. O otimizador junta da
+    esquerda pra direita sem sobrepor, então as duas disputam as instruções
+    em comum"""
+    for k in range(1, min(len(a), len(b))):
+        if a[-k:] == b[:k] or b[-k:] == a[:k]:
+            return True
+    return False
+
+
+def escolher(contagens, quantidade, minimo):
+    """Escolhe gulosamente as sequências que mais economizam despachos
+
+    Uma sequência economiza (tamanho - 1) despachos por execução. Depois que
+    uma é escolhida, as que a contêm só economizam o que ela não cobre, as
+    que estão dentro dela perdem as execuções que ela já junta, e as que
+    cruzam com ela ficam de fora
+    """
+    candidatas = [s for s in contagens if pode_juntar(s)]
+    escolhidas = []
+
+    def economia(sequencia):
+        coberto = max(
+            (len(s) - 1 for s in escolhidas if contem(sequencia, s)), default=0
+        )
+        execucoes = contagens[sequencia] - sum(
+            contagens[s] for s in escolhidas if contem(s, sequencia)
+        )
+        return max(execucoes, 0) * (len(sequencia) - 1 - coberto)
+
+    while len(escolhidas) < quantidade:
+        restantes = [
+            s
+            for s in candidatas
+            if s not in escolhidas
+            and not any(
+                cruza(s, e) and not contem(s, e) and not contem(e, s)
+                for e in escolhidas
+            )
+        ]
+        if not restantes:
+            break
+
+        melhor = max(restantes, key=lambda s: (economia(s), s))
+        ganho = economia(melhor)
+        if ganho < minimo:
+            break
+
+        escolhidas.append(melhor)
+        yield melhor, ganho
+
+
+def nome_da_super(sequencia):
+    partes = []
+    for nome in sequencia:
+        nome = nome[len("OP_") :]
+        if nome.endswith("_16"):
+            nome = nome[: -len("_16")]
+        partes.append(nome)
+    return "OP_SUPER_" + "_".join(partes)
+
+
+def gerar_cabecalho(escolhidas, total):
+    # As mais longas primeiro: o otimizador usa a primeira que encaixa
+    ordem = sorted(escolhidas, key=lambda e: (-len(e[0]), -e[1]))
+    identificador = zlib.crc32(" ".join(nome_da_super(s) for s, _ in ordem).encode()) & 0xFFFF
+
+    linhas = [
+        "/**",
+        " * @file superinstructions.h",
+        " *",
+        " * @brief Superinstruções escolhidas a partir de um perfil das instruções",
+        " *",
+        " * GERADO por dev/superinstrucoes.py. Não edite à mão: gere um perfil novo",
+        " * e rode o script de novo (veja o README)",
+        " *",
+        f" * Perfil com {total} instruções executadas. Cada superinstrução",
+        " * mostra quantos despachos ela economizaria nele",
+        " */",
+        "",
+        "#ifndef GUARD_LOXIE_SUPERINSTRUCTIONS_H",
+        "#define GUARD_LOXIE_SUPERINSTRUCTIONS_H",
+        "",
+        "/** Identifica o conjunto de superinstruções (muda o bytecode) */",
+        f"#define SUPERINSTRUCTIONS_ID 0x{identificador:04x}",
+        "",
+        "/** Quantidade de superinstruções */",
+        f"#define SUPERINSTRUCTION_COUNT {len(ordem)}",
+        "",
+        "/**",
+        " * @brief Lista as superinstruções, das maiores para as menores",
+        " *",
+        " * X(nome, tamanho com os operandos, quantidade de instruções, instruções...)",
+        " */",
+        "#define SUPERINSTRUCTIONS(X)" + " \\",
+    ]
+
+    for sequencia, ganho in ordem:
+        tamanho = 1 + sum(COMPONENTES[nome] for nome in sequencia)
+        linhas.append(f"\t/* {100.0 * ganho / total:.2f}% */ \\")
+        linhas.append(
+            f"\tX({nome_da_super(sequencia)}, {tamanho}, {len(sequencia)}, "
+            f"{', '.join(sequencia)}) \\"
+        )
+    linhas[-1] = linhas[-1][: -len(" \\")]
+
+    linhas += ["", "#endif\t// GUARD_LOXIE_SUPERINSTRUCTIONS_H", ""]
+    return "\r\n".join(linhas)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Escolhe as superinstruções a partir de perfis das instruções"
+    )
+    parser.add_argument("perfis", nargs="+", help="arquivos gerados com LOXIE_PROFILE")
+    parser.add_argument(
+        "-n", "--quantidade", type=int, default=8, help="máximo de superinstruções"
+    )
+    parser.add_argument(
+        "-m",
+        "--minimo",
+        type=float,
+        default=0.5,
+        help="economia mínima, em %% dos despachos, para escolher uma sequência",
+    )
+    parser.add_argument("-o", "--saida", help="onde escrever o cabeçalho gerado")
+    args = parser.parse_args()
+
+    contagens, total = ler_perfis(args.perfis, ler_opcodes())
+    if total == 0:
+        sys.exit("Perfil vazio")
+
+    escolhidas = list(
+        escolher(contagens, args.quantidade, total * args.minimo / 100.0)
+    )
+    if not escolhidas:
+        sys.exit("Nenhuma sequencia passou do minimo")
+
+    for sequencia, ganho in escolhidas:
+        print(
+            f"{100.0 * ganho / total:6.2f}%  {contagens[sequencia]:>12}  "
+            f"{' '.join(sequencia)}"
+        )
+
+    if args.saida:
+        with open(args.saida, "w", encoding="utf-8", newline="") as arquivo:
+            arquivo.write(gerar_cabecalho(escolhidas, total))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,123 @@
+/**
+ * @file bytecode.h
+ * @author Pedro B.
+ * @date 2026.10.16
+ *
+ * @brief Arquivos de bytecode pré-compilado (.loxc)
+ *
+ * Um .loxc guarda a árvore de funções que o compilador gerou para um
+ * script: o código, as constantes, a tabela de linhas e a quantidade de
+ * upvalues de cada função, junto com os nomes das variáveis globais na ordem
+ * dos seus índices. Rodar um .loxc pula o compilador inteiro
+ *
+ * O arquivo é mapeado na memória (de forma privada), e o código e as linhas
+ * das funções são usados direto do mapeamento. As páginas só são copiadas
+ * se a VM escrever nelas (quando acelera uma instrução, por exemplo)
+ *
+ * Com COMPILE_CACHE, o mesmo formato serve de cache de compilação: scripts
+ * rodados a partir do código-fonte são guardados em um diretório, e rodar o
+ * mesmo código no mesmo build do Loxie carrega o .loxc em vez de compilar.
+ * Cada arquivo do cache guarda o SHA-256 e o tamanho do código-fonte, que
+ * são conferidos ao carregar
+ *
+ * Todo .loxc carregado tem o código das funções conferido antes de rodar:
+ * instruções, índices de constantes, globais e upvalues e destinos dos
+ * pulos. Isso pega arquivos truncados, de outro build ou que não são .loxc.
+ * A altura da pilha, os índices das locais e os tipos dos operandos não são
+ * conferidos, então um .loxc adulterado de propósito ainda pode derrubar a
+ * VM: só rode arquivos confiáveis
+ */
+
+#ifndef GUARD_LOXIE_BYTECODE_H
+#define GUARD_LOXIE_BYTECODE_H
+
+#include "common.h"
+#include "object.h"
+
+/** Extensão dos arquivos de bytecode */
+#define LOXC_EXTENSION ".loxc"
+
+/**
+ * @brief Versão do formato. Precisa mudar sempre que o formato ou o
+ * significado do bytecode mudar
+ */
+#define LOXC_VERSION 2
+
+/**
+ * @brief Grava o script compilado em um arquivo .loxc
+ *
+ * Os nomes das variáveis globais saem de @a vm.globalNames, então o script
+ * precisa ter acabado de ser compilado (e não pode ter rodado)
+ *
+ * @param[in] script Função do script, retornada pelo compilador
+ * @param[in] PATH Caminho do arquivo
+ *
+ * @return Se o arquivo foi gravado. Se não, o erro já foi reportado
+ */
+bool bcWrite(ObjFunction *script, const char *PATH);
+
+/**
+ * @brief Carrega um arquivo .loxc
+ *
+ * Confere a versão do formato e as opções de compilação de quem gravou o
+ * arquivo, e registra as variáveis globais nos mesmos índices usados pelo
+ * código
+ *
+ * @param[in] PATH Caminho do arquivo
+ *
+ * @return Função do script (NULL caso o arquivo seja inválido ou
+ * incompatível. O erro já foi reportado)
+ */
+ObjFunction *bcLoad(const char *PATH);
+
+#ifdef COMPILE_CACHE
+/**
+ * @def CACHE_MAX_SIZE
+ * @brief Tamanho máximo, em bytes, dos arquivos no diretório do cache. Ao
+ * passar disso, os arquivos usados há mais tempo são apagados
+ */
+#ifndef CACHE_MAX_SIZE
+#define CACHE_MAX_SIZE ((uint64_t)64 * 1024 * 1024)
+#endif
+
+/**
+ * @def CACHE_MAX_AGE
+ * @brief Tempo, em segundos, que um arquivo de outro build do Loxie fica no
+ * cache depois do último uso
+ */
+#ifndef CACHE_MAX_AGE
+#define CACHE_MAX_AGE (24 * 60 * 60)
+#endif
+
+/**
+ * @brief Procura o bytecode de @a SOURCE no cache de compilação
+ *
+ * @param[in] SOURCE Código-fonte do script
+ *
+ * @return Função do script (NULL se não está no cache, ou se o arquivo do
+ * cache não serve. Nada é reportado)
+ */
+ObjFunction *bcCacheLoad(const char *SOURCE);
+
+/**
+ * @brief Guarda o script recém-compilado no cache de compilação. Vários
+ * processos podem gravar o mesmo script ao mesmo tempo. Falhas são ignoradas
+ *
+ * Depois de gravar, limpa o diretório: apaga os arquivos de outros builds
+ * que não são usados há CACHE_MAX_AGE, os temporários de processos que
+ * morreram, e os usados há mais tempo enquanto o cache passar de
+ * CACHE_MAX_SIZE
+ *
+ * @param[in] script Função do script, retornada pelo compilador
+ * @param[in] SOURCE Código-fonte do script
+ */
+void bcCacheStore(ObjFunction *script, const char *SOURCE);
+#endif
+
+/**
+ * @brief Libera os arquivos carregados. Chamado depois que todas as funções
+ * foram liberadas
+ */
+void bcFree(void);
+
+#endif	// GUARD_LOXIE_BYTECODE_H
@@ -10,6 +10,7 @@
 #define GUARD_LOXIE_CHUNK_H
 
 #include "common.h"
+#include "table.h"
 #include "value.h"
 #include "value_array.h"
 
@@ -29,6 +30,39 @@ typedef struct LineStart {
 	size_t line;   /**< Número da linha */
 } LineStart;
 
+/** Quantidade de formas diferentes que um cache em linha lembra */
+#define INLINE_CACHE_ENTRIES 4
+
+/** Quantidade máxima de caches em linha em uma única chunk */
+#define INLINE_CACHE_MAX UINT16_MAX
+
+/** Forward-declaration do struct ObjShape */
+struct ObjShape;
+
+/**
+ * @brief Struct representando uma forma vista por um cache em linha
+ */
+typedef struct InlineCacheEntry {
+	struct ObjShape *shape; /**< Forma do receptor */
+	int32_t slot;	/**< Índice do campo na instância (-1 se for um método) */
+	Value value;	/**< Método encontrado na classe (se @a slot for -1), ou a
+					   forma seguinte se a escrita adicionou um campo */
+} InlineCacheEntry;
+
+/**
+ * @brief Struct representando um cache em linha
+ *
+ * Cada acesso a uma propriedade (ou invocação de método) no código ganha seu
+ * próprio cache, que guarda o resultado da última busca para cada forma
+ * vista naquele ponto. Se a mesma forma aparecer de novo, pulamos a busca
+ * nos hashmaps
+ */
+typedef struct InlineCache {
+	uint8_t count; /**< Quantidade de entradas ocupadas */
+	uint8_t next;  /**< Próxima entrada a ser substituída quando cheio */
+	InlineCacheEntry entries[INLINE_CACHE_ENTRIES]; /**< Entradas */
+} InlineCache;
+
 /**
  * @brief Struct representando uma sequência de bytecodes
  */
@@ -38,10 +72,19 @@ typedef struct Chunk {
 	uint8_t *code; /**< Array de bytes */
 
 	ValueArray consts; /**< Array de valores constantes */
+	Table *constIndex; /**< Posição de cada constante no array, pelo valor.
+						  Só existe enquanto a chunk é compilada */
 
 	size_t lineCount; /**< Ocupação atual do array de linhas */
 	size_t lineSize;  /**< Tamanho do array de linhas */
 	LineStart *lines; /**< Array de linhas */
+
+	size_t cacheCount;	  /**< Quantidade de caches em linha */
+	size_t cacheSize;	  /**< Tamanho do array de caches em linha */
+	InlineCache *caches; /**< Caches em linha */
+
+	bool isMapped; /**< Se o código e as linhas moram em um arquivo .loxc
+					  mapeado (e não são liberados com a chunk) */
 } Chunk;
 
 /**
@@ -67,12 +110,25 @@ void chunkFree(Chunk *chunk);
  */
 void chunkWrite(Chunk *chunk, const uint8_t BYTE, const size_t LINE);
 
+/**
+ * @brief Descarta o código a partir de @a COUNT
+ *
+ * Usado pelo compilador para reescrever as últimas instruções emitidas
+ *
+ * @param[out] chunk Ponteiro pra chunk alvo
+ * @param[in] COUNT Novo tamanho do código
+ */
+void chunkTruncate(Chunk *chunk, const size_t COUNT);
+
 /**
  * @brief Adiciona um valor constante ao array de valores da chunk
  *
  * Este valor permanecerá no array até ser coletado pelo GC, e guarda
  * números, strings, objetos e outros valores usados no código
  *
+ * Enquanto a chunk tem um @a constIndex, números e strings que já estão no
+ * array são reaproveitados em vez de adicionados de novo
+ *
  * @param[out] chunk Ponteiro pra chunk alvo
  * @param[in] value Valor que será adicionado
  *
@@ -80,6 +136,15 @@ void chunkWrite(Chunk *chunk, const uint8_t BYTE, const size_t LINE);
  */
 size_t chunkAddConst(Chunk *chunk, Value value);
 
+/**
+ * @brief Tira a última constante do array de valores da chunk (e do índice)
+ *
+ * Usado pelo compilador quando descarta a única instrução que usava ela
+ *
+ * @param[out] chunk Ponteiro pra chunk alvo
+ */
+void chunkPopConst(Chunk *chunk);
+
 /**
  * @brief Adiciona uma instrução OP_CONST_* ao código e adiciona um valor
  * constante ao array de valores, selecionando entre as versões 16- e 32-bit
@@ -93,6 +158,14 @@ size_t chunkAddConst(Chunk *chunk, Value value);
  */
 size_t chunkWriteConst(Chunk *chunk, Value value, const size_t LINE);
 
+/**
+ * @brief Reserva um novo cache em linha na chunk
+ *
+ * @param[out] chunk Ponteiro pra chunk alvo
+ * @return Índice do cache no array de caches
+ */
+size_t chunkAddCache(Chunk *chunk);
+
 /**
  * @brief Acha a linha onde um dado offset está localizado no código-fonte
  *
@@ -105,4 +178,24 @@ size_t chunkWriteConst(Chunk *chunk, Value value, const size_t LINE);
  */
 size_t chunkGetLine(Chunk *chunk, const size_t OFFSET);
 
+/**
+ * @brief Tamanho de uma instrução do bytecode, incluindo seus operandos
+ *
+ * @param[in] chunk Ponteiro pra chunk onde a instrução está
+ * @param[in] OFFSET Offset da instrução
+ *
+ * @return O tamanho, ou 0 se a instrução é desconhecida
+ */
+size_t chunkInstructionLength(Chunk *chunk, const size_t OFFSET);
+
+/**
+ * @brief Instruções que uma superinstrução junta
+ *
+ * @param[in] OP OpCode
+ * @param[out] count Quantidade de instruções
+ *
+ * @return As instruções, em ordem (NULL se @a OP não é uma superinstrução)
+ */
+const uint8_t *chunkSuperOps(const uint8_t OP, uint8_t *count);
+
 #endif	// GUARD_LOXIE_CHUNK_H
@@ -39,4 +39,64 @@
  */
 #define INTENTIONALLY_UNUSED(VAR) ((void)(VAR))
 
+/*
+ * Referências comprimidas só fazem sentido com ponteiros de 64 bits, e a
+ * região do heap é reservada com o mmap do Linux
+ */
+#if defined(COMPRESSED_HEAP) && (!defined(__linux__) || !defined(__LP64__))
+#undef COMPRESSED_HEAP
+#endif
+
+#if defined(COMPRESSED_HEAP) && !defined(SLAB_ALLOC)
+#error "COMPRESSED_HEAP precisa de SLAB_ALLOC"
+#endif
+
+/*
+ * O cabeçalho compacto guarda o próximo objeto como uma referência para a
+ * região dos objetos, que só existe com as slabs (no Linux, com 64 bits).
+ * Fora disso, o cabeçalho volta a ter o ponteiro inteiro
+ */
+#if defined(COMPRESSED_HEAP) && !defined(COMPACT_HEADER)
+#define COMPACT_HEADER
+#endif
+
+#if defined(COMPACT_HEADER) &&                             \
+	(!defined(SLAB_ALLOC) || !defined(__linux__) || !defined(__LP64__))
+#undef COMPACT_HEADER
+#endif
+
+/*
+ * O JIT só gera código x86-64 (System V) para o Value em struct com números
+ * de 64 bits e ponteiros inteiros. Em qualquer outra configuração, tudo é
+ * interpretado
+ */
+#if defined(JIT) &&                                             \
+	(!defined(__x86_64__) || !defined(__linux__) ||             \
+	 defined(NAN_BOXING) || defined(LOXIE_USE_32BIT_NUMBERS) || \
+	 defined(COMPRESSED_HEAP) || defined(DEBUG_TRACE_EXECUTION))
+#undef JIT
+#endif
+
+/* O espaço de objetos grandes usa o mremap, que só existe no Linux */
+#if defined(LARGE_OBJECTS) && !defined(__linux__)
+#undef LARGE_OBJECTS
+#endif
+
+/*
+ * O cache de compilação identifica o build pelo executável (/proc/self/exe).
+ * Com DEBUG_PRINT_CODE, o script é sempre compilado, para o código aparecer
+ */
+#if defined(COMPILE_CACHE) && \
+	(!defined(__linux__) || defined(DEBUG_PRINT_CODE))
+#undef COMPILE_CACHE
+#endif
+
+/*
+ * Os coletores incremental e concorrente dividem cada coleta em fases
+ * (marcação e varredura), que avançam aos poucos durante a execução
+ */
+#if defined(GC_INCREMENTAL) || defined(GC_CONCURRENT)
+#define GC_PHASES
+#endif
+
 #endif	// GUARD_LOXIE_COMMON_H
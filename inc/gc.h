@@ -10,7 +10,17 @@
 #define GUARD_LOXIE_GC_H
 
 #include "common.h"
+#include "object.h"
 #include "value.h"
+#include "vm.h"
+
+/**
+ * @def GC_NURSERY_SIZE
+ * @brief Bytes alocados entre duas coletas menores (modo geracional)
+ */
+#ifndef GC_NURSERY_SIZE
+#define GC_NURSERY_SIZE (256 * 1024)
+#endif
 
 /**
  * @brief Roda o coletor de lixo
@@ -29,4 +39,235 @@ void gcMarkValue(Value value);
  */
 void gcMarkObject(Obj *object);
 
+#if (defined(GC_GENERATIONAL) + defined(GC_INCREMENTAL) + \
+	 defined(GC_CONCURRENT)) > 1
+#error "GC_GENERATIONAL, GC_INCREMENTAL e GC_CONCURRENT nao podem ser usados juntos"
+#endif
+
+#if defined(GC_PARALLEL) && defined(GC_PHASES)
+#error "GC_PARALLEL so pode ser usado com as coletas que param o programa"
+#endif
+
+#if defined(GC_LAZY_SWEEP) && \
+	(defined(GC_PHASES) || defined(GC_GENERATIONAL))
+#error "GC_LAZY_SWEEP so pode ser usado com a coleta que para o programa"
+#endif
+
+/**
+ * @def GC_MARK_COLOR
+ * @brief Valor de @a isMarked dos objetos marcados no ciclo atual
+ *
+ * Com a varredura preguiçosa, o significado do bit inverte a cada ciclo, e
+ * os sobreviventes não precisam ser desmarcados um por um
+ */
+#ifdef GC_LAZY_SWEEP
+#define GC_MARK_COLOR (vm.markColor)
+#else
+#define GC_MARK_COLOR true
+#endif
+
+/** Se o objeto foi marcado no ciclo atual */
+#define GC_IS_MARKED(object) ((object)->isMarked == GC_MARK_COLOR)
+
+#ifdef GC_LAZY_SWEEP
+/**
+ * @def GC_SWEEP_BUDGET
+ * @brief Quantidade máxima de objetos varridos antes de cada alocação
+ */
+#ifndef GC_SWEEP_BUDGET
+#define GC_SWEEP_BUDGET 256
+#endif
+
+/**
+ * @brief Varre os objetos pendentes do último ciclo até liberar @a bytes
+ * bytes (ou varrer GC_SWEEP_BUDGET objetos)
+ *
+ * Chamada antes de cada alocação, então a memória dos objetos mortos é
+ * devolvida quando alguém precisa dela, e não durante a pausa da coleta
+ *
+ * @param[in] bytes Quantidade de bytes que será alocada
+ */
+void gcSweep(size_t bytes);
+#endif
+
+#if defined(GC_COMPACT) &&                                  \
+	(defined(GC_PHASES) || defined(GC_GENERATIONAL) || \
+	 defined(GC_LAZY_SWEEP) || !defined(SLAB_ALLOC))
+#error "GC_COMPACT precisa de SLAB_ALLOC e da coleta que para o programa"
+#endif
+
+#ifdef GC_COMPACT
+/**
+ * @brief Coleta o lixo e move os objetos vivos para slabs novas, liberando
+ * as antigas
+ *
+ * Todas as referências conhecidas pela VM são atualizadas (pilha, frames,
+ * upvalues, globais, constantes, caches e a tabela de strings), e o código
+ * nativo do JIT é descartado. Ponteiros guardados em variáveis do C não
+ * são, então só pode ser chamada em um ponto seguro (veja
+ * @a vm.compactPending)
+ */
+void gcCompact(void);
+#endif
+
+#ifdef GC_PARALLEL
+/**
+ * @brief Para e libera as threads auxiliares de marcação
+ *
+ * A quantidade de threads que marcam é lida na primeira coleta, da
+ * variável de ambiente LOXIE_GC_THREADS (ou de GC_THREADS, ou da quantidade
+ * de processadores)
+ */
+void gcStopWorkers(void);
+#endif
+
+#if defined(GC_GENERATIONAL) || defined(GC_INCREMENTAL)
+/**
+ * @def GC_WRITE_BARRIER
+ * @brief Definido quando o coletor precisa ser avisado das escritas em
+ * objetos (veja @ref gcBarrier)
+ */
+#define GC_WRITE_BARRIER
+#endif
+
+#ifdef GC_PHASES
+/**
+ * @brief Fases de um ciclo do coletor incremental ou concorrente
+ */
+typedef enum {
+	GC_PHASE_IDLE = 0,	/**< Nenhum ciclo em andamento */
+	GC_PHASE_MARK = 1,	/**< Marcando, aos poucos, a partir da pilha cinza */
+	GC_PHASE_SWEEP = 2, /**< Liberando, aos poucos, os objetos não marcados */
+} GcPhase;
+
+/**
+ * @def GC_STEP_BUDGET
+ * @brief Quantidade de objetos marcados ou varridos a cada passo do coletor
+ * incremental
+ */
+#ifndef GC_STEP_BUDGET
+#define GC_STEP_BUDGET 512
+#endif
+
+/**
+ * @brief Avança o coletor em um passo, começando um ciclo se o heap passou
+ * do limite
+ *
+ * Cada passo faz no máximo @ref GC_STEP_BUDGET unidades de trabalho, então
+ * a pausa não depende do tamanho do heap. No modo concorrente, a marcação
+ * não faz parte dos passos: ela roda em outra thread
+ */
+void gcStep(void);
+#endif
+
+#ifdef GC_CONCURRENT
+/**
+ * @brief Começa um ciclo concorrente, se o heap passou do limite
+ *
+ * Só é chamada na criação de objetos. As outras alocações (um array
+ * crescendo, por exemplo) acontecem no meio de modificações que já passaram
+ * por @ref gcPreBarrier, e a thread de marcação não pode começar a ler o
+ * objeto modificado antes de a modificação terminar
+ */
+void gcStartCycle(void);
+
+/**
+ * @brief Percorre as referências de um objeto na thread principal, marcando
+ * o objeto e os seus filhos (caminho lento de @ref gcPreBarrier)
+ *
+ * @param[in] object Objeto que será percorrido
+ */
+void gcScanObject(Obj *object);
+
+/**
+ * @brief Espera a thread de marcação do ciclo atual terminar, se houver
+ */
+void gcJoin(void);
+#endif
+
+#ifdef GC_WRITE_BARRIER
+/**
+ * @brief Avisa o coletor que um objeto pode ter recebido qualquer referência
+ * (usada quando a escrita não passa por @ref gcBarrier)
+ *
+ * No modo geracional, um objeto velho é guardado no conjunto lembrado, e
+ * seus filhos são marcados como se ele fosse uma raiz na próxima coleta
+ * menor. No modo incremental, um objeto já marcado volta para a pilha cinza
+ *
+ * @param[in] object Objeto que foi modificado
+ */
+void gcRemember(Obj *object);
+#else
+static inline void gcRemember(Obj *object) {
+	(void)object;
+}
+#endif
+
+/**
+ * @brief Barreira de escrita: deve ser chamada sempre que @a VALUE for
+ * guardado dentro de @a owner
+ *
+ * No modo geracional, a marca dos objetos que sobreviveram a uma coleta
+ * não é apagada, então um objeto marcado é um objeto velho. Só escritas de
+ * um objeto novo dentro de um velho precisam ser lembradas.
+ *
+ * No modo incremental, um objeto marcado no meio de um ciclo pode já ter
+ * sido escurecido. Um objeto branco guardado nele é pintado de cinza, para
+ * que a marcação não o perca
+ *
+ * @param[in] owner Objeto que recebeu o valor
+ * @param[in] VALUE Valor guardado
+ */
+static inline void gcBarrier(Obj *owner, const Value VALUE) {
+#if defined(GC_GENERATIONAL)
+	if( owner->isMarked && IS_OBJECT(VALUE) && !AS_OBJECT(VALUE)->isMarked ) {
+		gcRemember(owner);
+	}
+#elif defined(GC_INCREMENTAL)
+	if( vm.gcPhase == GC_PHASE_MARK && owner->isMarked && IS_OBJECT(VALUE) &&
+		!AS_OBJECT(VALUE)->isMarked ) {
+		gcMarkObject(AS_OBJECT(VALUE));
+	}
+#else
+	(void)owner;
+	(void)VALUE;
+#endif
+}
+
+/**
+ * @brief Barreira anterior à escrita: deve ser chamada antes de qualquer
+ * modificação nas referências de @a owner
+ *
+ * No modo concorrente, a marcação segue as referências que existiam no
+ * começo do ciclo (snapshot-at-the-beginning). Um objeto que ainda não foi
+ * percorrido é percorrido pela própria thread principal antes de mudar,
+ * marcando os valores antigos. Assim, a thread de marcação nunca lê um
+ * objeto enquanto ele é modificado
+ *
+ * @param[in] owner Objeto que será modificado
+ */
+static inline void gcPreBarrier(Obj *owner) {
+#ifdef GC_CONCURRENT
+	if( vm.gcPhase == GC_PHASE_MARK &&
+		!__atomic_load_n(&owner->isScanned, __ATOMIC_ACQUIRE) ) {
+		gcScanObject(owner);
+	}
+#else
+	(void)owner;
+#endif
+}
+
+/**
+ * @brief Avisa o coletor que uma string internada, que só é alcançável pela
+ * tabela de strings, voltou a ser usada
+ *
+ * No modo concorrente, ela pode não ter sido alcançada no começo do ciclo, e
+ * seria liberada mesmo estando em uso
+ *
+ * @param[in] string String encontrada na tabela de strings
+ */
+static inline void gcRevive(Obj *string) {
+	gcPreBarrier(string);
+}
+
 #endif	// GUARD_LOXIE_GC_H
@@ -0,0 +1,161 @@
+/**
+ * @file jit.h
+ * @author Pedro B.
+ * @date 2026.10.16
+ *
+ * @brief Compilador JIT de base, que traduz o bytecode de funções quentes
+ * para código nativo x86-64
+ *
+ * Cada instrução vira um molde fixo de código de máquina. A pilha da VM
+ * continua sendo a mesma (o topo fica em um registrador enquanto o código
+ * nativo roda), então o código nativo pode devolver o controle pro
+ * interpretador no começo de qualquer instrução
+ */
+
+#ifndef GUARD_LOXIE_JIT_H
+#define GUARD_LOXIE_JIT_H
+
+#include "common.h"
+#include "object.h"
+#include "vm.h"
+
+/**
+ * @def JIT_THRESHOLD
+ * @brief Quantidade de chamadas até uma função ser compilada
+ */
+#ifndef JIT_THRESHOLD
+#define JIT_THRESHOLD 1000
+#endif
+
+/**
+ * @def TRACE_THRESHOLD
+ * @brief Quantidade de voltas até um loop ter o seu caminho gravado
+ */
+#ifndef TRACE_THRESHOLD
+#define TRACE_THRESHOLD 50
+#endif
+
+/**
+ * @def OSR_THRESHOLD
+ * @brief Quantidade de voltas até um loop sem trace fazer a função inteira
+ * ser compilada, continuando no código nativo no meio do loop
+ */
+#ifndef OSR_THRESHOLD
+#define OSR_THRESHOLD 1000
+#endif
+
+/** Quantidade máxima de instruções em um trace */
+#define TRACE_MAX_LENGTH 1024
+
+/** Quantidade máxima de chamadas aninhadas embutidas em um trace */
+#define TRACE_MAX_DEPTH 8
+
+/** Gravações abortadas até um loop desistir de ter um trace */
+#define TRACE_MAX_ABORTS 4
+
+/**
+ * @brief Struct representando o código nativo de uma função
+ */
+typedef struct JitCode {
+	uint8_t *code; /**< Código nativo, em memória executável */
+	size_t size;   /**< Tamanho do mapeamento de @a code */
+
+	size_t entryCount; /**< Tamanho do array de entradas (= tamanho da chunk) */
+	uint8_t **entries; /**< Endereço nativo de cada instrução do bytecode, ou
+						  NULL se ela só pode ser executada pelo
+						  interpretador */
+} JitCode;
+
+/**
+ * @brief Struct representando o trace de um loop
+ *
+ * Um trace é um caminho linear pelo corpo do loop (atravessando as funções
+ * chamadas nele), gravado enquanto o interpretador o executava
+ */
+typedef struct JitTrace {
+	uint8_t *header; /**< Começo do loop (alvo do OP_LOOP) */
+	uint32_t hits;	 /**< Voltas dadas desde a última gravação abortada */
+	uint8_t aborts;	 /**< Gravações abortadas */
+
+	uint8_t *code; /**< Código nativo, ou NULL se ainda não foi compilado */
+	size_t size;   /**< Tamanho do mapeamento de @a code */
+	uint8_t *loop; /**< Começo do loop dentro de @a code */
+
+	size_t objectCount; /**< Quantidade de objetos usados pelo código */
+	Obj **objects;		/**< Objetos usados pelo código (mantidos pelo GC) */
+
+	struct JitTrace *next; /**< Próximo trace da mesma função */
+} JitTrace;
+
+/**
+ * @brief Registra o JIT nos níveis de execução
+ *
+ * Chamadas quentes compilam a função. Loops quentes são gravados como
+ * traces, e os que não conseguem ter um trace compilam a função inteira
+ * (OSR)
+ */
+void jitInit(void);
+
+/**
+ * @brief Compila uma função para código nativo
+ *
+ * @param[out] function Função que será compilada
+ *
+ * @return Se a função foi compilada. Se não, ela continua sendo interpretada
+ */
+bool jitCompile(ObjFunction *function);
+
+/**
+ * @brief Executa o código nativo do frame atual a partir de @a fp
+ *
+ * O código nativo roda até encontrar uma instrução que só o interpretador
+ * sabe executar (chamadas, retornos, guardas de tipo que falharam, etc.)
+ *
+ * @param[in] frame Frame atual, cuja função já foi compilada
+ * @param[in] fp Instrução onde a execução começa
+ *
+ * @return A instrução onde o interpretador deve continuar, ou NULL se
+ * ocorreu um erro
+ */
+uint8_t *jitEnter(CallFrame *frame, uint8_t *fp);
+
+/**
+ * @brief Libera o código nativo de uma função
+ *
+ * @param[in] jit Código nativo
+ */
+void jitFree(JitCode *jit);
+
+/**
+ * @brief Grava uma instrução no trace atual, antes de ela ser executada
+ *
+ * @param[in] frame Frame atual
+ * @param[in] fp Instrução que será executada
+ *
+ * @return Se a gravação continua. Se não, o trace foi compilado ou abortado
+ */
+bool jitRecord(CallFrame *frame, uint8_t *fp);
+
+/**
+ * @brief Se um trace está sendo gravado
+ */
+bool jitIsRecording(void);
+
+/**
+ * @brief Aborta a gravação atual, se houver (usada em erros de execução)
+ */
+void jitStopRecording(void);
+
+/**
+ * @brief Marca os objetos referenciados pela gravação atual
+ */
+void jitMarkRoots(void);
+
+/**
+ * @brief Libera os traces de uma função
+ *
+ * @param[in] trace Primeiro trace da lista
+ */
+void jitFreeTraces(JitTrace *trace);
+
+#endif	// GUARD_LOXIE_JIT_H
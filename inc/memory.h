@@ -15,7 +15,7 @@
 /**
  * @brief Aloca memória
  */
-#define MEM_ALLOC(TYPE, COUNT) memRealloc(NULL, 0, sizeof(TYPE) * COUNT)
+#define MEM_ALLOC(TYPE, COUNT) memRealloc(NULL, 0, sizeof(TYPE) * (COUNT))
 
 /**
  * @brief Cresce a capacidade de um array, dobrando-a
@@ -33,7 +33,7 @@
  * @param[in] NEW Tamanho novo do array
  */
 #define MEM_GROW_ARRAY(TYPE, ARR, OLD, NEW) \
-	memRealloc(ARR, sizeof(TYPE) * OLD, sizeof(TYPE) * NEW)
+	memRealloc(ARR, sizeof(TYPE) * (OLD), sizeof(TYPE) * (NEW))
 
 /**
  * @brief Libera um array da memória
@@ -42,7 +42,7 @@
  * @param[in] ARR Array que será liberado
  * @param[in] OLD Tamanho velho do array
  */
-#define MEM_FREE_ARRAY(TYPE, ARR, OLD) memRealloc(ARR, sizeof(TYPE) * OLD, 0)
+#define MEM_FREE_ARRAY(TYPE, ARR, OLD) memRealloc(ARR, sizeof(TYPE) * (OLD), 0)
 
 /**
  * @brief Libera um ponteiro de tipo @a TYPE da memória
@@ -51,10 +51,44 @@
  * @param[in] PTR Ponteiro que será liberado
  */
 #define MEM_FREE(TYPE, PTR) memRealloc(PTR, sizeof(TYPE), 0)
+
+#ifdef LARGE_OBJECTS
+/**
+ * @def LOS_THRESHOLD
+ * @brief Tamanho a partir do qual um bloco fica nas próprias páginas, fora
+ * do malloc
+ */
+#ifndef LOS_THRESHOLD
+#define LOS_THRESHOLD (256 * 1024)
+#endif
+#endif
+
+#ifdef COMPACT_HEADER
+/**
+ * @def HEAP_RESERVE
+ * @brief Tamanho da região reservada para os objetos (no máximo 64 GiB, o
+ * alcance de uma referência de 32 bits em blocos de 16 bytes)
+ */
+#ifndef HEAP_RESERVE
+#define HEAP_RESERVE ((size_t)64 * 1024 * 1024 * 1024)
+#endif
+
+/**
+ * @def HEAP_RESERVE_MIN
+ * @brief Menor região aceita. Se o sistema não deixar reservar HEAP_RESERVE
+ * (um limite de endereços, como o ulimit -v), a reserva tenta a metade do
+ * tamanho até chegar nesse
+ */
+#ifndef HEAP_RESERVE_MIN
+#define HEAP_RESERVE_MIN ((size_t)16 * 1024 * 1024)
+#endif
+#endif
+
 /**
  * @brief Realoca uma quantidade de memória
  *
- * Wrapper para realloc e free
+ * Wrapper para realloc e free (ou mmap, mremap e munmap para blocos
+ * grandes). @a OLD_SIZE precisa ser o tamanho com que o bloco foi alocado
  *
  * @param[in] pointer Ponteiro pro bloco de memória que será realocado
  * @param[in] OLD_SIZE Tamanho velho do bloco de memória
@@ -64,6 +98,74 @@
  */
 void *memRealloc(void *pointer, const size_t OLD_SIZE, const size_t NEW_SIZE);
 
+/**
+ * @brief Aloca a memória de um objeto
+ *
+ * Com SLAB_ALLOC, objetos pequenos saem de slabs separadas por classe de
+ * tamanho, sem passar pelo malloc. Com COMPACT_HEADER, todos os objetos
+ * saem da região reservada. A contagem de @a vm.bytesAllocated e o GC
+ * funcionam como no memRealloc
+ *
+ * @param[in] SIZE Tamanho do objeto
+ *
+ * @return Memória do objeto (não inicializada)
+ */
+void *memAllocObject(const size_t SIZE);
+
+/**
+ * @brief Obtém o tamanho com que um objeto foi alocado
+ *
+ * @param[in] object Objeto
+ *
+ * @return Tamanho do objeto, em bytes
+ */
+size_t memObjectSize(Obj *object);
+
+#ifdef GC_COMPACT
+/**
+ * @def GC_COMPACT_MIN_BYTES
+ * @brief Bytes em slabs a partir dos quais o heap pode ser compactado
+ */
+#ifndef GC_COMPACT_MIN_BYTES
+#define GC_COMPACT_MIN_BYTES (1024 * 1024)
+#endif
+
+/**
+ * @def GC_COMPACT_RATIO
+ * @brief O heap está fragmentado quando menos de 1/GC_COMPACT_RATIO das
+ * slabs está em uso
+ */
+#ifndef GC_COMPACT_RATIO
+#define GC_COMPACT_RATIO 4
+#endif
+
+/**
+ * @brief Se as slabs têm espaço livre o bastante para valer a pena
+ * compactar os objetos
+ */
+bool memIsFragmented(void);
+
+/**
+ * @brief Começa a mover os objetos: as slabs atuais deixam de receber
+ * alocações, e as próximas células saem de slabs novas
+ */
+void memBeginEvacuation(void);
+
+/**
+ * @brief Copia um objeto para as slabs novas
+ *
+ * @param[in] object Objeto que será movido
+ *
+ * @return A cópia, ou o próprio objeto se ele não fica em uma slab
+ */
+Obj *memEvacuate(Obj *object);
+
+/**
+ * @brief Libera as slabs antigas, depois que nada mais aponta para elas
+ */
+void memEndEvacuation(void);
+#endif
+
 /**
  * @brief Libera um objeto da memória
  * @param[in] object Objeto sendo liberado
@@ -13,7 +13,10 @@
 #include "object.h"
 #include "value.h"
 
-/** Erro retornado por uma função nativa */
+/**
+ * @brief Erro retornado por uma função nativa. A função reporta a mensagem
+ * (com errFatal) antes de retornar, e a VM mostra onde foi
+ */
 #define ERROR_TYPE (CREATE_EMPTY())
 
 /**
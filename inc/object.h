@@ -29,20 +29,59 @@ typedef enum {
 	OBJ_RANGE = 8,		  /**< Objeto representando uma faixa de valores */
 	OBJ_ARRAY = 9,		  /**< Objeto representando um array */
 	OBJ_TABLE = 10,		  /**< Objeto representando um hashmap */
+	OBJ_SHAPE = 11,		  /**< Objeto representando a forma de uma instância */
 } ObjType;
 
+/**
+ * @brief Quantidade máxima de campos de uma instância com forma
+ *
+ * Instâncias que passam deste limite são convertidas para o modo dicionário
+ */
+#define SHAPE_MAX_FIELDS 64
+
 /**
  * @brief Struct representando um objeto que vive na heap
  *
  * Este struct age como um "struct base" para os outros tipos de objeto
  * Quando um novo objeto é criado, seu primeiro membro precisa ser um Obj
+ *
+ * Com COMPACT_HEADER, o cabeçalho inteiro ocupa uma palavra de 8 bytes: o
+ * tipo e as marcas do GC em 4 bytes (cada marca no seu byte, para poder ser
+ * escrita atomicamente pelas threads do GC) e o próximo objeto como uma
+ * referência de 32 bits para a região dos objetos
  */
 struct Obj {
-	ObjType type;	  /**< O tipo deste objeto */
-	bool isMarked;	  /**< Se este objeto foi marcado pelo GC */
+#ifdef COMPACT_HEADER
+	uint8_t type; /**< O tipo deste objeto (ObjType) */
+#else
+	ObjType type; /**< O tipo deste objeto */
+#endif
+	bool isMarked;	   /**< Se este objeto foi marcado pelo GC */
+	bool isRemembered; /**< Se este objeto está no conjunto lembrado do GC
+						  geracional */
+	bool isScanned;	   /**< Se as referências deste objeto já foram
+						  percorridas no ciclo do GC concorrente */
+#ifdef COMPACT_HEADER
+	ObjRef next; /**< Próximo objeto (em uma lista linkada de objetos) */
+#else
 	struct Obj *next; /**< Próximo objeto (em uma lista linkada de objetos) */
+#endif
 };
 
+#ifdef COMPACT_HEADER
+/** Próximo objeto da lista */
+#define OBJ_NEXT(OBJECT) (REF_TO_OBJ((OBJECT)->next))
+
+/** Muda o próximo objeto da lista */
+#define OBJ_SET_NEXT(OBJECT, NEXT) ((OBJECT)->next = OBJ_TO_REF(NEXT))
+#else
+/** Próximo objeto da lista */
+#define OBJ_NEXT(OBJECT) ((OBJECT)->next)
+
+/** Muda o próximo objeto da lista */
+#define OBJ_SET_NEXT(OBJECT, NEXT) ((OBJECT)->next = (NEXT))
+#endif
+
 /**
  * @brief Struct representando uma string
  */
@@ -75,6 +114,12 @@ typedef struct ObjFunction {
 
 	Chunk chunk;	 /**< Chunk de código dentro da função */
 	ObjString *name; /**< O nome da função */
+
+	uint32_t calls;	 /**< Quantidade de chamadas (contador de calor) */
+	uint32_t *loops; /**< Voltas de cada loop, pelo offset do começo (NULL
+						até a primeira volta contada) */
+	struct JitCode *jit;	 /**< Código nativo, se a função já foi compilada */
+	struct JitTrace *traces; /**< Traces dos loops desta função */
 } ObjFunction;
 
 /** Typedef para uma função nativa */
@@ -100,6 +145,20 @@ typedef struct ObjClosure {
 	size_t upvalueSize;	   /**< Tamanho do array de upvalues (pro GC) */
 } ObjClosure;
 
+/**
+ * @brief Struct representando a forma (classe oculta) de uma instância
+ *
+ * Instâncias que recebem os mesmos campos na mesma ordem compartilham a
+ * mesma forma. A forma guarda o índice de cada campo, e a instância guarda
+ * só os valores, em um array denso
+ */
+typedef struct ObjShape {
+	Obj obj;			 /**< Objeto base */
+	uint32_t slotCount;	 /**< Quantidade de campos desta forma */
+	Table slots;		 /**< Índices dos campos (nome -> índice) */
+	Table transitions;	 /**< Formas seguintes (nome do novo campo -> forma) */
+} ObjShape;
+
 /**
  * @brief Struct representando uma classe
  */
@@ -108,15 +167,23 @@ typedef struct ObjClass {
 	ObjString *name;   /**< Nome da classe */
 	Value constructor; /**< Método construtor da classe */
 	Table methods;	   /**< Métodos da classe */
+	ObjShape *shape;   /**< Forma inicial (vazia) das instâncias */
+	uint32_t slotHint; /**< Maior quantidade de campos vista em uma instância */
 } ObjClass;
 
 /**
  * @brief Struct representando uma instância de uma classe
+ *
+ * Enquanto @a shape não for NULL, os campos moram em @a slots. No modo
+ * dicionário (muitos campos, ou campos apagados), moram em @a fields
  */
 typedef struct ObjInstance {
-	Obj obj;		 /**< Objeto base */
-	ObjClass *klass; /**< Classe sendo instanciada */
-	Table fields;	 /**< Campos da instância */
+	Obj obj;		  /**< Objeto base */
+	ObjClass *klass;  /**< Classe sendo instanciada */
+	ObjShape *shape;  /**< Forma da instância (NULL no modo dicionário) */
+	uint32_t slotSize; /**< Capacidade do array de campos */
+	Value *slots;	  /**< Valores dos campos, na ordem da forma */
+	Table *fields;	  /**< Campos no modo dicionário */
 } ObjInstance;
 
 /**
@@ -189,6 +256,9 @@ typedef struct ObjTable {
 /** Verifica se um objeto é um hashmap */
 #define IS_TABLE(VALUE) _isObjectOfType(VALUE, OBJ_TABLE)
 
+/** Verifica se um objeto é uma forma */
+#define IS_SHAPE(VALUE) _isObjectOfType(VALUE, OBJ_SHAPE)
+
 /** Trata um objeto como sendo do tipo ObjString */
 #define AS_STRING(VALUE) ((ObjString *)AS_OBJECT(VALUE))
 
@@ -231,6 +301,9 @@ typedef struct ObjTable {
 /** Trata um objeto como sendo do tipo ObjTable */
 #define AS_TABLE(VALUE) ((ObjTable *)AS_OBJECT(VALUE))
 
+/** Trata um objeto como sendo do tipo ObjShape */
+#define AS_SHAPE(VALUE) ((ObjShape *)AS_OBJECT(VALUE))
+
 /**
  * @brief Verifica se um objeto é de um dado tipo
  *
@@ -331,6 +404,74 @@ ObjArray *objMakeArray(void);
  */
 ObjTable *objMakeTable(void);
 
+/**
+ * @brief Cria uma forma vazia
+ * @return A forma criada
+ */
+ObjShape *objMakeShape(void);
+
+/**
+ * @brief Procura o índice de um campo em uma forma
+ *
+ * @param[in] shape Forma onde o campo será procurado
+ * @param[in] name Nome do campo
+ *
+ * @return O índice do campo, ou -1 se a forma não possui o campo
+ */
+int32_t objShapeFind(ObjShape *shape, ObjString *name);
+
+/**
+ * @brief Obtém a forma resultante de adicionar um campo a uma forma
+ *
+ * Se a transição ainda não existir, ela é criada e guardada
+ *
+ * @param[in] shape Forma atual
+ * @param[in] name Nome do novo campo
+ *
+ * @return A forma seguinte
+ */
+ObjShape *objShapeTransition(ObjShape *shape, ObjString *name);
+
+/**
+ * @brief Muda a forma de uma instância, aumentando seus campos se preciso
+ *
+ * @param[out] instance Instância que mudará de forma
+ * @param[in] shape Nova forma
+ */
+void objInstanceSetShape(ObjInstance *instance, ObjShape *shape);
+
+/**
+ * @brief Obtém um campo de uma instância
+ *
+ * @param[in] instance Instância sendo acessada
+ * @param[in] name Nome do campo
+ * @param[out] value Valor do campo
+ *
+ * @return Se o campo existe
+ */
+bool objInstanceGet(ObjInstance *instance, ObjString *name, Value *value);
+
+/**
+ * @brief Muda (ou cria) um campo de uma instância
+ *
+ * @param[out] instance Instância sendo modificada
+ * @param[in] name Nome do campo
+ * @param[in] VALUE Novo valor do campo
+ */
+void objInstanceSet(ObjInstance *instance, ObjString *name, const Value VALUE);
+
+/**
+ * @brief Apaga um campo de uma instância
+ *
+ * A instância passa para o modo dicionário
+ *
+ * @param[out] instance Instância sendo modificada
+ * @param[in] name Nome do campo
+ *
+ * @return Se o campo existia
+ */
+bool objInstanceDelete(ObjInstance *instance, ObjString *name);
+
 /**
  * @brief Obtém a hash de uma string
  *
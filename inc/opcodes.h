@@ -9,6 +9,8 @@
 #ifndef GUARD_LOXIE_OPCODES_H
 #define GUARD_LOXIE_OPCODES_H
 
+#include "superinstructions.h"
+
 /**
  * @brief Enum representando todos os OpCodes possíveis
  *
@@ -112,6 +114,94 @@ typedef enum {
 		64, /**< Muda um valor de um array/hashmap/string/etc... */
 
 	OP_RETURN = 65, /**< Retorna de uma função */
+
+	/*
+	 * Instruções especializadas em números. O compilador nunca as emite: a
+	 * VM reescreve a instrução genérica no lugar depois de ver operandos
+	 * numéricos, e desfaz a troca se a guarda de tipo falhar
+	 */
+	OP_EQUAL_NUM = 66,		   /**< Igual a (números) */
+	OP_GREATER_NUM = 67,	   /**< Maior que (números) */
+	OP_GREATER_EQUAL_NUM = 68, /**< Maior ou igual a (números) */
+	OP_LESS_NUM = 69,		   /**< Menor que (números) */
+	OP_LESS_EQUAL_NUM = 70,	   /**< Menor ou igual a (números) */
+	OP_ADD_NUM = 71,		   /**< Adiciona dois números */
+	OP_SUB_NUM = 72,		   /**< Subtrai dois números */
+	OP_MUL_NUM = 73,		   /**< Multiplica dois números */
+	OP_DIV_NUM = 74,		   /**< Divide dois números */
+	OP_MOD_NUM = 75,		   /**< Módulo de dois números */
+	OP_NEGATE_NUM = 76,		   /**< Inverte o sinal de um número */
+
+	/*
+	 * Instruções de registradores. Leem as variáveis locais direto de
+	 * frame->slots (R) e as constantes direto da chunk (K). As formas com
+	 * três operandos escrevem o resultado em uma local, sem usar a pilha
+	 */
+	OP_ADD_RR = 77,			  /**< Empilha R[A] + R[B] */
+	OP_SUB_RR = 78,			  /**< Empilha R[A] - R[B] */
+	OP_MUL_RR = 79,			  /**< Empilha R[A] * R[B] */
+	OP_DIV_RR = 80,			  /**< Empilha R[A] / R[B] */
+	OP_MOD_RR = 81,			  /**< Empilha R[A] % R[B] */
+	OP_EQUAL_RR = 82,		  /**< Empilha R[A] == R[B] */
+	OP_GREATER_RR = 83,		  /**< Empilha R[A] > R[B] */
+	OP_GREATER_EQUAL_RR = 84, /**< Empilha R[A] >= R[B] */
+	OP_LESS_RR = 85,		  /**< Empilha R[A] < R[B] */
+	OP_LESS_EQUAL_RR = 86,	  /**< Empilha R[A] <= R[B] */
+
+	OP_ADD_RK = 87,			  /**< Empilha R[A] + K[B] */
+	OP_SUB_RK = 88,			  /**< Empilha R[A] - K[B] */
+	OP_MUL_RK = 89,			  /**< Empilha R[A] * K[B] */
+	OP_DIV_RK = 90,			  /**< Empilha R[A] / K[B] */
+	OP_MOD_RK = 91,			  /**< Empilha R[A] % K[B] */
+	OP_EQUAL_RK = 92,		  /**< Empilha R[A] == K[B] */
+	OP_GREATER_RK = 93,		  /**< Empilha R[A] > K[B] */
+	OP_GREATER_EQUAL_RK = 94, /**< Empilha R[A] >= K[B] */
+	OP_LESS_RK = 95,		  /**< Empilha R[A] < K[B] */
+	OP_LESS_EQUAL_RK = 96,	  /**< Empilha R[A] <= K[B] */
+
+	OP_ADD_RRR = 97,  /**< R[A] = R[B] + R[C] */
+	OP_SUB_RRR = 98,  /**< R[A] = R[B] - R[C] */
+	OP_MUL_RRR = 99,  /**< R[A] = R[B] * R[C] */
+	OP_DIV_RRR = 100, /**< R[A] = R[B] / R[C] */
+	OP_MOD_RRR = 101, /**< R[A] = R[B] % R[C] */
+
+	OP_ADD_RRK = 102, /**< R[A] = R[B] + K[C] */
+	OP_SUB_RRK = 103, /**< R[A] = R[B] - K[C] */
+	OP_MUL_RRK = 104, /**< R[A] = R[B] * K[C] */
+	OP_DIV_RRK = 105, /**< R[A] = R[B] / K[C] */
+	OP_MOD_RRK = 106, /**< R[A] = R[B] % K[C] */
+
+	/*
+	 * Instruções que só o otimizador emite
+	 */
+	OP_JUMP_IF_TRUE = 107, /**< Pulo condicional (se verdadeiro) */
+
+	/*
+	 * Superinstruções, geradas a partir de um perfil em superinstructions.h.
+	 * Cada uma faz o mesmo que a sequência de instruções que ela junta, com
+	 * os operandos delas em ordem
+	 */
+#define OP_SUPER_ENUM(NAME, LENGTH, COUNT, ...) NAME,
+	SUPERINSTRUCTIONS(OP_SUPER_ENUM)
+#undef OP_SUPER_ENUM
 } OpCode;
 
+/** Quantidade de OpCodes (precisa acompanhar o último do enum) */
+#define OP_COUNT (OP_JUMP_IF_TRUE + 1 + SUPERINSTRUCTION_COUNT)
+
+/**
+ * @brief Aplica @a F em cada instrução de uma superinstrução
+ *
+ * @param F Macro que recebe um OpCode
+ * @param COUNT Quantidade de instruções (até PROFILE_MAX_GRAM)
+ */
+#define SUPER_EACH(F, COUNT, ...) SUPER_EACH_##COUNT(F, __VA_ARGS__)
+
+/** Maior quantidade de instruções em uma superinstrução */
+#define SUPER_MAX_COUNT 4
+
+#define SUPER_EACH_2(F, A, B) F(A) F(B)
+#define SUPER_EACH_3(F, A, B, C) F(A) F(B) F(C)
+#define SUPER_EACH_4(F, A, B, C, D) F(A) F(B) F(C) F(D)
+
 #endif	// GUARD_LOXIE_OPCODES_H
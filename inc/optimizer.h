@@ -0,0 +1,57 @@
+/**
+ * @file optimizer.h
+ * @author Pedro B.
+ * @date 2026.10.16
+ *
+ * @brief Otimizador <i>peephole</i> do bytecode
+ *
+ * Roda sobre a chunk de cada função logo depois que o compilador termina
+ * ela, e limpa as sequências ingênuas que um compilador de passada única
+ * emite: pulos para pulos, OP_NOT antes de um pulo condicional, valores
+ * empilhados só para serem retirados e código que nunca é alcançado
+ */
+
+#ifndef GUARD_LOXIE_OPTIMIZER_H
+#define GUARD_LOXIE_OPTIMIZER_H
+
+#include "chunk.h"
+#include "common.h"
+
+/** Nível de otimização usado se nenhum for escolhido */
+#define OPT_LEVEL_DEFAULT 1
+
+/** Maior nível de otimização */
+#define OPT_LEVEL_MAX 1
+
+/**
+ * @brief Se o otimizador junta sequências de instruções em superinstruções
+ *
+ * O JIT não conhece as superinstruções, e o perfil das instruções precisa
+ * ver as sequências originais para escolhê-las
+ */
+#if !defined(JIT) && !defined(DEBUG_PROFILE_OPS)
+#define OPT_SUPERINSTRUCTIONS
+#endif
+
+/**
+ * @brief Nível de otimização (0 desliga o otimizador). Escolhido pela linha
+ * de comando com -O0, -O1...
+ */
+extern uint8_t optLevel;
+
+/**
+ * @brief Otimiza a chunk de uma função recém-compilada
+ *
+ * Faz o <i>threading</i> dos pulos, troca OP_NOT + OP_JUMP_IF_FALSE por
+ * OP_JUMP_IF_TRUE, remove pares de OP_DUP (ou valores sem efeito) e OP_POP,
+ * pulos para a instrução seguinte e o código inalcançável. No fim, junta as
+ * sequências que têm uma superinstrução (com OPT_SUPERINSTRUCTIONS). Os
+ * offsets dos pulos e a tabela de linhas são refeitos para o código novo
+ *
+ * Se a chunk tiver algo que o otimizador não entende, ela fica como está
+ *
+ * @param[out] chunk Ponteiro pra chunk alvo
+ */
+void optChunk(Chunk *chunk);
+
+#endif	// GUARD_LOXIE_OPTIMIZER_H
@@ -0,0 +1,44 @@
+/**
+ * @file profile.h
+ * @author Pedro B.
+ * @date 2026.10.16
+ *
+ * @brief Perfil das sequências de instruções executadas
+ *
+ * Com DEBUG_PROFILE_OPS, a VM conta quantas vezes cada sequência de 1 a
+ * PROFILE_MAX_GRAM instruções seguidas (n-gramas) foi executada. Só contam
+ * as instruções que vêm uma depois da outra no código: um pulo, uma chamada
+ * ou um retorno começam uma sequência nova
+ *
+ * As contagens são escritas no fim do programa, no arquivo em
+ * $LOXIE_PROFILE (ou na saída de erro), e são a entrada de
+ * dev/superinstrucoes.py, que escolhe as superinstruções
+ */
+
+#ifndef GUARD_LOXIE_PROFILE_H
+#define GUARD_LOXIE_PROFILE_H
+
+#include "chunk.h"
+#include "common.h"
+
+#ifdef DEBUG_PROFILE_OPS
+
+/** Tamanho da maior sequência contada */
+#define PROFILE_MAX_GRAM 4
+
+/**
+ * @brief Começa o perfil. As contagens são escritas quando o programa sai
+ */
+void profInit(void);
+
+/**
+ * @brief Conta a instrução que está prestes a ser executada
+ *
+ * @param[in] chunk Chunk da instrução
+ * @param[in] IP Ponteiro pra instrução
+ */
+void profInstruction(Chunk *chunk, const uint8_t *IP);
+
+#endif
+
+#endif	// GUARD_LOXIE_PROFILE_H
@@ -0,0 +1,45 @@
+/**
+ * @file superinstructions.h
+ *
+ * @brief Superinstruções escolhidas a partir de um perfil das instruções
+ *
+ * GERADO por dev/superinstrucoes.py. Não edite à mão: gere um perfil novo
+ * e rode o script de novo (veja o README)
+ *
+ * Perfil com 719261039 instruções executadas. Cada superinstrução
+ * mostra quantos despachos ela economizaria nele
+ */
+
+#ifndef GUARD_LOXIE_SUPERINSTRUCTIONS_H
+#define GUARD_LOXIE_SUPERINSTRUCTIONS_H
+
+/** Identifica o conjunto de superinstruções (muda o bytecode) */
+#define SUPERINSTRUCTIONS_ID 0xec57
+
+/** Quantidade de superinstruções */
+#define SUPERINSTRUCTION_COUNT 8
+
+/**
+ * @brief Lista as superinstruções, das maiores para as menores
+ *
+ * X(nome, tamanho com os operandos, quantidade de instruções, instruções...)
+ */
+#define SUPERINSTRUCTIONS(X) \
+	/* 8.49% */ \
+	X(OP_SUPER_LESS_JUMP_IF_FALSE_POP_JUMP, 5, 4, OP_LESS, OP_JUMP_IF_FALSE, OP_POP, OP_JUMP) \
+	/* 8.49% */ \
+	X(OP_SUPER_ADD_SET_LOCAL_POP_LOOP, 4, 4, OP_ADD, OP_SET_LOCAL_16, OP_POP, OP_LOOP) \
+	/* 2.78% */ \
+	X(OP_SUPER_MUL_ADD_GET_LOCAL_CONST, 3, 4, OP_MUL, OP_ADD, OP_GET_LOCAL_16, OP_CONST_16) \
+	/* 2.71% */ \
+	X(OP_SUPER_JUMP_IF_FALSE_POP_GET_LOCAL_CONST, 5, 4, OP_JUMP_IF_FALSE, OP_POP, OP_GET_LOCAL_16, OP_CONST_16) \
+	/* 2.36% */ \
+	X(OP_SUPER_ADD_SET_GLOBAL_POP_LOOP, 4, 4, OP_ADD, OP_SET_GLOBAL_16, OP_POP, OP_LOOP) \
+	/* 5.49% */ \
+	X(OP_SUPER_SUB_SET_LOCAL_POP, 2, 3, OP_SUB, OP_SET_LOCAL_16, OP_POP) \
+	/* 12.29% */ \
+	X(OP_SUPER_GET_LOCAL_CONST, 3, 2, OP_GET_LOCAL_16, OP_CONST_16) \
+	/* 1.52% */ \
+	X(OP_SUPER_GET_GLOBAL_GET_GLOBAL, 3, 2, OP_GET_GLOBAL_16, OP_GET_GLOBAL_16)
+
+#endif	// GUARD_LOXIE_SUPERINSTRUCTIONS_H
@@ -0,0 +1,116 @@
+/**
+ * @file tier.h
+ * @author Pedro B.
+ * @date 2026.10.16
+ *
+ * @brief Níveis de execução: contadores de calor e ganchos para subir de
+ * nível
+ *
+ * A VM conta as chamadas de cada função e as voltas de cada loop. Quando um
+ * contador passa do limite de um nível registrado, o gancho do nível é
+ * chamado, e pode trocar a forma como o código roda dali em diante (por
+ * exemplo, compilando a função e continuando no código nativo no meio do
+ * loop, o que é a substituição na pilha, ou OSR)
+ */
+
+#ifndef GUARD_LOXIE_TIER_H
+#define GUARD_LOXIE_TIER_H
+
+#include "common.h"
+#include "object.h"
+#include "vm.h"
+
+/** Quantidade máxima de níveis registrados */
+#define TIER_MAX 8
+
+/**
+ * @brief Eventos contados pela VM
+ */
+typedef enum {
+	TIER_EVENT_CALL = 0, /**< Uma função foi chamada */
+	TIER_EVENT_LOOP = 1, /**< Um loop voltou pro começo */
+	TIER_EVENT_COUNT,	 /**< Quantidade de eventos */
+} TierEvent;
+
+/**
+ * @brief Gancho de um nível de execução
+ *
+ * É chamado a cada evento depois que o contador passa do limite do nível
+ *
+ * @param[in] frame Frame atual (para chamadas, o frame recém-criado)
+ * @param[in] fp Começo da função ou do loop
+ * @param[in] COUNT Valor do contador
+ *
+ * @return A instrução onde o interpretador deve continuar, no frame que
+ * estiver no topo (@a fp se nada mudou), ou NULL se ocorreu um erro
+ */
+typedef uint8_t *(*TierHook)(CallFrame *frame, uint8_t *fp,
+							 const uint32_t COUNT);
+
+/**
+ * @brief Menor limite entre os níveis de cada evento (UINT32_MAX se o
+ * evento não tem níveis)
+ */
+extern uint32_t tierThresholds[TIER_EVENT_COUNT];
+
+/**
+ * @brief Verifica se um contador já interessa a algum nível
+ *
+ * @param[in] EVENT Evento contado
+ * @param[in] COUNT Valor do contador
+ */
+static inline bool tierIsHot(const TierEvent EVENT, const uint32_t COUNT) {
+	return COUNT >= tierThresholds[EVENT];
+}
+
+/**
+ * @brief Verifica se algum nível observa um evento
+ *
+ * @param[in] EVENT Evento
+ */
+static inline bool tierIsObserved(const TierEvent EVENT) {
+	return tierThresholds[EVENT] != UINT32_MAX;
+}
+
+/**
+ * @brief Registra um nível de execução
+ *
+ * Os níveis são consultados na ordem em que foram registrados. Registrar o
+ * mesmo gancho de novo não faz nada
+ *
+ * @param[in] EVENT Evento que o nível observa
+ * @param[in] THRESHOLD Valor do contador a partir do qual o gancho é chamado
+ * @param[in] hook Gancho
+ */
+void tierRegister(const TierEvent EVENT, const uint32_t THRESHOLD,
+				  TierHook hook);
+
+/**
+ * @brief Avisa os níveis de que a função do frame atual está quente
+ *
+ * @param[in] frame Frame recém-criado
+ *
+ * @return Igual a @ref TierHook
+ */
+uint8_t *tierCall(CallFrame *frame);
+
+/**
+ * @brief Conta uma volta de um loop e avisa os níveis, se ele estiver quente
+ *
+ * Só é preciso chamá-la se houver níveis de loop (veja @ref tierIsObserved)
+ *
+ * @param[in] frame Frame atual
+ * @param[in] header Começo do loop (alvo do OP_LOOP)
+ *
+ * @return Igual a @ref TierHook
+ */
+uint8_t *tierLoop(CallFrame *frame, uint8_t *header);
+
+/**
+ * @brief Libera os contadores de uma função
+ *
+ * @param[out] function Função
+ */
+void tierFreeCounters(ObjFunction *function);
+
+#endif	// GUARD_LOXIE_TIER_H
@@ -19,17 +19,59 @@ typedef struct Obj Obj;
 /** Forward-declaration do struct ObjString */
 typedef struct ObjString ObjString;
 
+#ifdef COMPACT_HEADER
+/** Começo da região onde moram todos os objetos (reservada em memory.c) */
+extern uint8_t *memHeapBase;
+
+/** Bits de baixo descartados de um endereço (os objetos são alinhados a 16) */
+#define HEAP_SHIFT 4
+
+/**
+ * @brief Referência comprimida para um objeto: a distância até
+ * @a memHeapBase, em blocos de 16 bytes. 0 é o NULL
+ */
+typedef uint32_t ObjRef;
+
+static inline ObjRef _objToRef(const void *OBJECT) {
+	if( OBJECT == NULL ) {
+		return 0;
+	}
+
+	return (ObjRef)(((const uint8_t *)OBJECT - memHeapBase) >> HEAP_SHIFT);
+}
+
+static inline Obj *_refToObj(const ObjRef REF) {
+	if( REF == 0 ) {
+		return NULL;
+	}
+
+	return (Obj *)(memHeapBase + ((uintptr_t)REF << HEAP_SHIFT));
+}
+
+/** Comprime um ponteiro para objeto */
+#define OBJ_TO_REF(OBJECT) (_objToRef(OBJECT))
+
+/** Descomprime uma referência */
+#define REF_TO_OBJ(REF) (_refToObj(REF))
+#endif
+
 #ifdef NAN_BOXING
 
-/** Bit do sinal */
+/*
+ * Com NAN_BOXING, um Value ocupa 8 bytes: números são guardados como o
+ * próprio double, e os outros valores ficam escondidos dentro de um quiet
+ * NaN, que nenhuma operação aritmética produz:
+ *
+ *   objeto:  1 11111111111 11 [ endereço (48 bits) ]
+ *   outros:  0 11111111111 11 [        tag         ]
+ */
+
+/** Bit do sinal (marca os objetos) */
 #define SIGN_BIT ((uint64_t)0x8000000000000000)
 
 /** Quiet NaN */
 #define QNAN ((uint64_t)0x7ffc000000000000)
 
-/** Valor constante */
-#define TAG_CONST ((uint64_t)0x4000000000000)
-
 /** Valor verdadeiro */
 #define TAG_TRUE 3
 
@@ -44,27 +86,51 @@ typedef struct ObjString ObjString;
 
 typedef uint64_t Value;
 
+/** Cria um valor numérico */
 #define CREATE_NUMBER(NUMBER) (_numToValue(NUMBER))
+
+/** Cria o valor verdadeiro */
 #define CREATE_TRUE() ((Value)(uint64_t)(QNAN | TAG_TRUE))
+
+/** Cria o valor falso */
 #define CREATE_FALSE() ((Value)(uint64_t)(QNAN | TAG_FALSE))
+
+/** Cria um valor nulo */
 #define CREATE_NIL() ((Value)(uint64_t)(QNAN | TAG_NIL))
+
+/** Cria um valor vazio */
 #define CREATE_EMPTY() ((Value)(uint64_t)(QNAN | TAG_EMPTY))
+
+/** Cria um valor booleano */
 #define CREATE_BOOL(BOOL) ((BOOL) ? CREATE_TRUE() : CREATE_FALSE())
+
+/** Cria um objeto */
 #define CREATE_OBJECT(OBJECT) \
 	(Value)(SIGN_BIT | QNAN | (uint64_t)(uintptr_t)(OBJECT))
 
+/** Trata um valor como um LOXIE_NUMBER */
 #define AS_NUMBER(VALUE) (_valueToNum(VALUE))
+
+/** Trata um valor como um bool */
 #define AS_BOOL(VALUE) ((VALUE) == CREATE_TRUE())
+
+/** Trata um valor como um objeto */
 #define AS_OBJECT(VALUE) ((Obj *)(uintptr_t)((VALUE) & ~(SIGN_BIT | QNAN)))
 
+/** Verifica se um valor é numérico */
 #define IS_NUMBER(VALUE) (((VALUE) & QNAN) != QNAN)
+
+/** Verifica se um valor é booleano */
 #define IS_BOOL(VALUE) (((VALUE) | 1) == CREATE_TRUE())
-#define IS_NIL(VALUE) ((VALUE) == TAG_NIL)
-#define IS_EMPTY(VALUE) ((VALUE) == TAG_EMPTY)
-#define IS_OBJECT(VALUE) (((VALUE) & (QNAN | SIGN_BIT)) == (QNAN | SIGN_BIT))
-#define IS_CONSTANT(VALUE) (((VALUE) & TAG_CONST) == TAG_CONST)
 
-#define SET_TO_CONSTANT(VALUE) (VALUE |= TAG_CONST)
+/** Verifica se um valor é nulo */
+#define IS_NIL(VALUE) ((VALUE) == CREATE_NIL())
+
+/** Verifica se um valor é vazio */
+#define IS_EMPTY(VALUE) ((VALUE) == CREATE_EMPTY())
+
+/** Verifica se um valor é um objeto */
+#define IS_OBJECT(VALUE) (((VALUE) & (QNAN | SIGN_BIT)) == (QNAN | SIGN_BIT))
 
 static inline Value _numToValue(const double NUMBER) {
 	Value value;
@@ -97,23 +163,23 @@ typedef enum {
 typedef struct Value {
 	uint8_t props; /**< Propriedades do valor:
 					* 7 6 5 4 3 2 1 0
-					*         | |   |
-					*         | ValueType do valor
-					*         Se este valor é constante
+					*           |   |
+					*           ValueType do valor
 					*/
 	union {
 		bool vBool;			  /**< Valor booleano */
 		LOXIE_NUMBER vNumber; /**< Valor numérico */
-		Obj *vObject;		  /**< Objeto */
+#ifdef COMPRESSED_HEAP
+		ObjRef vObject; /**< Objeto (referência comprimida) */
+#else
+		Obj *vObject; /**< Objeto */
+#endif
 	};
 } Value;
 
 /** Retorna o tipo do valor */
 #define GET_TYPE(VALUE) ((VALUE).props & 7)
 
-/** Retorna se o valor é constante */
-#define IS_CONSTANT(VALUE) (((VALUE).props >> 3) & 1)
-
 /** Verifica se um valor é nulo */
 #define IS_NIL(VALUE) (GET_TYPE(VALUE) == VALUE_NIL)
 
@@ -136,7 +202,11 @@ typedef struct Value {
 #define AS_NUMBER(VALUE) ((VALUE).vNumber)
 
 /** Trata um valor como um objeto */
+#ifdef COMPRESSED_HEAP
+#define AS_OBJECT(VALUE) (REF_TO_OBJ((VALUE).vObject))
+#else
 #define AS_OBJECT(VALUE) ((VALUE).vObject)
+#endif
 
 /** Cria um valor nulo */
 #define CREATE_NIL() ((Value){.props = VALUE_NIL, .vNumber = 0})
@@ -157,14 +227,17 @@ typedef struct Value {
  * @brief Cria um objeto
  * @param[in] VALUE Objeto inicial
  */
+#ifdef COMPRESSED_HEAP
+#define CREATE_OBJECT(VALUE) \
+	((Value){.props = VALUE_OBJECT, .vObject = OBJ_TO_REF(VALUE)})
+#else
 #define CREATE_OBJECT(VALUE) \
 	((Value){.props = VALUE_OBJECT, .vObject = (Obj *)VALUE})
+#endif
 
 /** Cria um valor vazio */
 #define CREATE_EMPTY() ((Value){.props = VALUE_EMPTY, .vNumber = 0})
 
-#define SET_TO_CONSTANT(VALUE) (VALUE.props |= 0x08)
-
 #endif
 
 /**
@@ -16,9 +16,11 @@
  * @brief Struct representando um array de valores
  */
 typedef struct ValueArray {
-	size_t count;  /**< Ocupação atual do array de valores */
-	size_t size;   /**< Tamanho atual do array de valores */
-	Value *values; /**< Array de valores */
+	size_t count;	 /**< Ocupação atual do array de valores */
+	size_t size;	 /**< Tamanho atual do array de valores */
+	Value *values;	 /**< Array de valores */
+	bool hasObjects; /**< Se algum objeto já foi guardado no array (senão o
+						GC não precisa percorrê-lo) */
 } ValueArray;
 
 /**
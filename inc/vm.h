@@ -57,6 +57,10 @@ typedef struct VM {
 
 	Table globalNames;		 /**< Hashmap com os nomes das variáveis globais */
 	ValueArray globalValues; /**< Array com os valores das variáveis globais */
+	Table globalConsts; /**< Índices (números) das variáveis globais que são
+						   constantes */
+	Table globalSets; /**< Índices (números) das variáveis globais que algum
+						 código já compilado muda */
 
 	Table strings;			  /**< Hashmap de strings */
 	ObjUpvalue *openUpvalues; /**< Lista de upvalues abertos */
@@ -69,6 +73,30 @@ typedef struct VM {
 	size_t grayCount; /**< Quantidade de objetos na pilha de objetos marcados*/
 	size_t graySize;  /**< Tamanho da pilha de objetos marcados*/
 	Obj **grayStack;  /**< Pilha de objetos marcados */
+
+#ifdef GC_GENERATIONAL
+	Obj *oldObjects;	/**< Primeiro objeto velho de @a objects (os novos
+						   ficam antes dele, no começo da lista) */
+	size_t nextMajorGC; /**< Limite de bytes até a próxima coleta completa */
+
+	size_t rememberedCount; /**< Quantidade de objetos lembrados */
+	size_t rememberedSize;	/**< Tamanho do conjunto lembrado */
+	Obj **remembered; /**< Objetos velhos que apontam para objetos novos */
+#endif
+
+#ifdef GC_PHASES
+	uint8_t gcPhase; /**< Fase do ciclo atual do GC (GcPhase) */
+#endif
+#if defined(GC_PHASES) || defined(GC_LAZY_SWEEP)
+	Obj *sweepObjects; /**< Objetos que ainda serão varridos neste ciclo */
+#endif
+#ifdef GC_LAZY_SWEEP
+	bool markColor; /**< Valor de isMarked que significa "marcado" */
+#endif
+#ifdef GC_COMPACT
+	bool compactPending; /**< Se o heap deve ser compactado no próximo ponto
+							seguro */
+#endif
 } VM;
 
 extern VM vm; /**< Instância global da VM, para acesso externo */
@@ -92,7 +120,7 @@ void vmFree(void);
  * @brief Retorna a linha em que a VM está atualmente
  *
  * @param[in] FRAME_IDX Índice pro frame onde o código atual está
- * @return A linha atual
+ * @return A linha atual, ou 0 se nenhuma função está rodando
  */
 size_t vmGetLine(const uint8_t FRAME_IDX);
 
@@ -105,6 +133,16 @@ size_t vmGetLine(const uint8_t FRAME_IDX);
  */
 Result vmInterpret(const char *SOURCE);
 
+/**
+ * @brief Roda uma função de script já compilada (de um arquivo .loxc, por
+ * exemplo)
+ *
+ * @param[in] function Função do script
+ *
+ * @return Enum indicando se a operação ocorreu com sucesso
+ */
+Result vmInterpretFunction(ObjFunction *function);
+
 /**
  * @brief Empurra um valor para a pilha
  *
@@ -119,4 +157,24 @@ void vmPush(Value value);
  */
 Value vmPop(void);
 
+/**
+ * @brief Troca a instância no topo da pilha pela sua propriedade @a name
+ *
+ * @param[in] name Nome da propriedade
+ * @param[out] cache Cache em linha deste acesso
+ *
+ * @return Se a operação foi bem-sucedida. Se não, o erro já foi reportado
+ */
+bool vmGetProperty(ObjString *name, InlineCache *cache);
+
+/**
+ * @brief Muda a propriedade @a name da instância logo abaixo do topo da pilha
+ *
+ * @param[in] name Nome da propriedade
+ * @param[out] cache Cache em linha deste acesso
+ *
+ * @return Se a operação foi bem-sucedida. Se não, o erro já foi reportado
+ */
+bool vmSetProperty(ObjString *name, InlineCache *cache);
+
 #endif	// GUARD_LOXIE_VM_H
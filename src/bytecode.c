@@ -0,0 +1,1389 @@
+/**
+ * @file bytecode.c
+ * @author Pedro B.
+ * @date 2026.10.16
+ *
+ * @brief Arquivos de bytecode pré-compilado (.loxc)
+ *
+ * Formato (tudo na ordem de bytes da máquina que gravou):
+ *
+ * @code{.unparsed}
+ * LoxcHeader
+ * globais:   [u32 tamanho][nome] (uma por índice, de 0 a globalCount - 1)
+ * função:    (alinhada a 8) LoxcFunction
+ *            [nome][código]
+ *            (alinhado a 8) [LineStart * lineCount]
+ *            constantes: [u8 tipo][número (double) | string | função]
+ * string:    [u32 tamanho][caracteres]
+ * @endcode
+ *
+ * A função do script vem logo depois das globais, e as outras funções
+ * aparecem dentro das constantes de quem as declarou
+ *
+ * O arquivo pode estar truncado ou ser de outro build: depois de lidas as
+ * constantes de uma função, o código dela é conferido instrução por
+ * instrução antes de chegar na VM. A conferência não acompanha a pilha nem
+ * os tipos, então não protege contra um arquivo adulterado de propósito
+ */
+
+#include "bytecode.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/** Se o arquivo é mapeado com mmap (se não, é lido para um buffer) */
+#define LOXC_MMAP
+#endif
+
+#include "chunk.h"
+#include "error.h"
+#include "gc.h"
+#include "memory.h"
+#include "native.h"
+#include "opcodes.h"
+#include "optimizer.h"
+#include "table.h"
+#include "vm.h"
+
+/** Assinatura no começo de todo .loxc */
+#define LOXC_MAGIC "LOXC"
+
+/** Alinhamento das partes usadas direto do arquivo */
+#define LOXC_ALIGN 8
+
+/** Tamanho de nome que indica uma função sem nome (o script) */
+#define LOXC_NO_NAME UINT32_MAX
+
+/** Tamanho da hash do código-fonte (SHA-256) */
+#define LOXC_HASH_SIZE 32
+
+/**
+ * @brief Opções de compilação que mudam o bytecode (ou o layout das linhas,
+ * que são usadas direto do arquivo)
+ */
+#ifdef REGISTER_VM
+#define LOXC_REGISTER_VM 0x100
+#else
+#define LOXC_REGISTER_VM 0
+#endif
+
+/**
+ * @brief Conjunto de superinstruções do bytecode. Gerar outro conjunto muda
+ * os OpCodes, e um build sem elas (o JIT) não consegue ler o bytecode
+ */
+#ifdef OPT_SUPERINSTRUCTIONS
+#define LOXC_SUPERINSTRUCTIONS ((uint32_t)SUPERINSTRUCTIONS_ID << 16)
+#else
+#define LOXC_SUPERINSTRUCTIONS 0
+#endif
+
+#define LOXC_CONFIG \
+	((uint32_t)sizeof(size_t) | LOXC_REGISTER_VM | LOXC_SUPERINSTRUCTIONS)
+
+/**
+ * @brief Código-fonte de onde o arquivo foi compilado. Só os arquivos do
+ * cache guardam (os gravados com --compile deixam zerado)
+ */
+typedef struct LoxcSource {
+	uint64_t length;			  /**< Tamanho do código-fonte */
+	uint8_t hash[LOXC_HASH_SIZE]; /**< SHA-256 do código-fonte */
+} LoxcSource;
+
+/**
+ * @brief Cabeçalho de um .loxc
+ */
+typedef struct LoxcHeader {
+	char magic[4];		  /**< LOXC_MAGIC */
+	uint16_t version;	  /**< LOXC_VERSION de quem gravou */
+	uint16_t opCount;	  /**< OP_COUNT de quem gravou */
+	uint32_t config;	  /**< LOXC_CONFIG de quem gravou */
+	uint32_t size;		  /**< Tamanho do arquivo inteiro */
+	uint32_t globalCount; /**< Quantidade de variáveis globais */
+	uint32_t stackMax;	  /**< Tamanho da pilha pedido pelo compilador */
+	LoxcSource source;	  /**< Código-fonte (só no cache) */
+} LoxcHeader;
+
+/**
+ * @brief Cabeçalho de uma função
+ */
+typedef struct LoxcFunction {
+	uint32_t nameLength;   /**< Tamanho do nome (LOXC_NO_NAME se não tem) */
+	uint32_t arity;		   /**< Quantidade de argumentos */
+	uint32_t upvalueCount; /**< Quantidade de upvalues */
+	uint32_t codeCount;	   /**< Tamanho do código */
+	uint32_t lineCount;	   /**< Quantidade de LineStarts */
+	uint32_t cacheCount;   /**< Quantidade de caches em linha */
+	uint32_t constCount;   /**< Quantidade de constantes */
+	uint32_t padding;	   /**< Mantém o tamanho múltiplo de 8 */
+} LoxcFunction;
+
+/**
+ * @brief Tipos de constante
+ */
+typedef enum {
+	LOXC_CONST_NUMBER = 0,	 /**< Número (guardado como double) */
+	LOXC_CONST_STRING = 1,	 /**< String */
+	LOXC_CONST_FUNCTION = 2, /**< Função */
+} LoxcConst;
+
+/**
+ * @brief Arquivo carregado, mantido até o fim da VM
+ */
+typedef struct LoxcFile {
+	uint8_t *data; /**< Conteúdo do arquivo */
+	size_t size;   /**< Tamanho do arquivo */
+} LoxcFile;
+
+/** Arquivos carregados */
+static LoxcFile *_files = NULL;
+
+/** Quantidade de arquivos carregados */
+static size_t _fileCount = 0;
+
+/** Tamanho do array de arquivos carregados */
+static size_t _fileSize = 0;
+
+/**
+ * @brief Struct usado para gravar um .loxc
+ */
+typedef struct Writer {
+	FILE *file;	   /**< Arquivo sendo gravado */
+	size_t offset; /**< Bytes gravados até agora */
+	bool hadError; /**< Se alguma constante não pôde ser gravada */
+} Writer;
+
+/**
+ * @brief Struct usado para ler um .loxc
+ */
+typedef struct Reader {
+	uint8_t *start;		  /**< Começo do arquivo */
+	size_t size;		  /**< Tamanho do arquivo */
+	size_t offset;		  /**< Posição atual */
+	uint32_t globalCount; /**< Quantidade de variáveis globais */
+} Reader;
+
+/** Marca de um offset onde começa uma instrução */
+#define VERIFY_START 1
+
+/** Marca de um offset para onde algum pulo vai */
+#define VERIFY_TARGET 2
+
+/**
+ * @brief Struct usado para conferir o código de uma função lida
+ */
+typedef struct Verifier {
+	const ObjFunction *function; /**< Função sendo conferida */
+	uint32_t globalCount;		 /**< Quantidade de variáveis globais */
+	uint8_t *marks;				 /**< Marcas (VERIFY_*) de cada offset */
+	size_t at;					 /**< Próximo byte a ser lido */
+} Verifier;
+
+static void _write(Writer *writer, const void *DATA, const size_t SIZE) {
+	fwrite(DATA, 1, SIZE, writer->file);
+	writer->offset += SIZE;
+}
+
+static void _writeU32(Writer *writer, const uint32_t VALUE) {
+	_write(writer, &VALUE, sizeof(uint32_t));
+}
+
+/**
+ * @brief Completa o arquivo com zeros até o próximo múltiplo de LOXC_ALIGN
+ */
+static void _writePadding(Writer *writer) {
+	static const uint8_t ZEROS[LOXC_ALIGN] = {0};
+
+	const size_t REST = writer->offset % LOXC_ALIGN;
+	if( REST != 0 ) {
+		_write(writer, ZEROS, LOXC_ALIGN - REST);
+	}
+}
+
+static void _writeString(Writer *writer, ObjString *string) {
+	_writeU32(writer, (uint32_t)string->length);
+	_write(writer, string->str, string->length);
+}
+
+static void _writeFunction(Writer *writer, ObjFunction *function) {
+	Chunk *chunk = &function->chunk;
+
+	_writePadding(writer);
+
+	const LoxcFunction HEADER = {
+		.nameLength = function->name != NULL ? (uint32_t)function->name->length
+											 : LOXC_NO_NAME,
+		.arity = function->arity,
+		.upvalueCount = (uint32_t)function->upvalueCount,
+		.codeCount = (uint32_t)chunk->count,
+		.lineCount = (uint32_t)chunk->lineCount,
+		.cacheCount = (uint32_t)chunk->cacheCount,
+		.constCount = (uint32_t)chunk->consts.count,
+		.padding = 0,
+	};
+	_write(writer, &HEADER, sizeof(LoxcFunction));
+
+	if( function->name != NULL ) {
+		_write(writer, function->name->str, function->name->length);
+	}
+
+	_write(writer, chunk->code, chunk->count);
+
+	_writePadding(writer);
+	_write(writer, chunk->lines, sizeof(LineStart) * chunk->lineCount);
+
+	for( size_t i = 0; i < chunk->consts.count; ++i ) {
+		const Value VALUE = chunk->consts.values[i];
+
+		if( IS_NUMBER(VALUE) ) {
+			const uint8_t TYPE = LOXC_CONST_NUMBER;
+			const double NUMBER = AS_NUMBER(VALUE);
+			_write(writer, &TYPE, sizeof(uint8_t));
+			_write(writer, &NUMBER, sizeof(double));
+		} else if( IS_STRING(VALUE) ) {
+			const uint8_t TYPE = LOXC_CONST_STRING;
+			_write(writer, &TYPE, sizeof(uint8_t));
+			_writeString(writer, AS_STRING(VALUE));
+		} else if( IS_FUNCTION(VALUE) ) {
+			const uint8_t TYPE = LOXC_CONST_FUNCTION;
+			_write(writer, &TYPE, sizeof(uint8_t));
+			_writeFunction(writer, AS_FUNCTION(VALUE));
+		} else {
+			/* O compilador só gera números, strings e funções */
+			writer->hadError = true;
+		}
+	}
+}
+
+/**
+ * @brief Reporta um erro sobre o arquivo @a PATH, a não ser que @a QUIET
+ * (quando o arquivo vem do cache, e um erro só significa compilar de novo)
+ */
+static void _error(const bool QUIET, const char *MSG, const char *PATH) {
+	if( !QUIET ) {
+		errFatal(0, MSG, PATH);
+	}
+}
+
+/**
+ * @brief Grava o script em @a PATH
+ *
+ * @param[in] SOURCE Código-fonte do script (NULL fora do cache)
+ */
+static bool _save(ObjFunction *script, const char *PATH, const bool QUIET,
+				  const LoxcSource *SOURCE) {
+	FILE *file = fopen(PATH, "wb");
+	if( file == NULL ) {
+		_error(QUIET, "Nao foi possivel criar o arquivo '%s'", PATH);
+		return false;
+	}
+
+	Writer writer = {.file = file, .offset = 0, .hadError = false};
+
+	/* O tamanho do arquivo só é conhecido no final */
+	LoxcHeader header = {
+		.magic = LOXC_MAGIC,
+		.version = LOXC_VERSION,
+		.opCount = OP_COUNT,
+		.config = LOXC_CONFIG,
+		.size = 0,
+		.globalCount = (uint32_t)vm.globalValues.count,
+		.stackMax = vm.stackMax,
+		.source = {0},
+	};
+	if( SOURCE != NULL ) {
+		header.source = *SOURCE;
+	}
+	_write(&writer, &header, sizeof(LoxcHeader));
+
+	/* O script ainda não está em uma raiz */
+	const bool WAS_LOCKED = vm.isLocked;
+	vm.isLocked = true;
+
+	/* Os nomes das globais, na ordem dos seus índices */
+	ObjString **names = MEM_ALLOC(ObjString *, header.globalCount);
+	memset(names, 0, sizeof(ObjString *) * header.globalCount);
+
+	for( size_t i = 0; i < vm.globalNames.size; ++i ) {
+		Entry *entry = &vm.globalNames.entries[i];
+		if( IS_STRING(entry->key) ) {
+			names[(size_t)AS_NUMBER(entry->value)] = AS_STRING(entry->key);
+		}
+	}
+
+	for( size_t i = 0; i < header.globalCount; ++i ) {
+		if( names[i] == NULL ) {
+			writer.hadError = true;
+			_writeU32(&writer, 0);
+		} else {
+			_writeString(&writer, names[i]);
+		}
+	}
+
+	MEM_FREE_ARRAY(ObjString *, names, header.globalCount);
+	vm.isLocked = WAS_LOCKED;
+
+	_writeFunction(&writer, script);
+
+	header.size = (uint32_t)writer.offset;
+	if( writer.offset > UINT32_MAX ) {
+		writer.hadError = true;
+	}
+
+	rewind(file);
+	fwrite(&header, sizeof(LoxcHeader), 1, file);
+
+	const bool FAILED = writer.hadError || ferror(file);
+	if( fclose(file) != 0 || FAILED ) {
+		_error(QUIET, "Nao foi possivel gravar o arquivo '%s'", PATH);
+		remove(PATH);
+		return false;
+	}
+
+	return true;
+}
+
+bool bcWrite(ObjFunction *script, const char *PATH) {
+	return _save(script, PATH, false, NULL);
+}
+
+/**
+ * @brief Avança @a SIZE bytes no arquivo
+ *
+ * @return Os bytes lidos (NULL se o arquivo acabou antes)
+ */
+static uint8_t *_read(Reader *reader, const size_t SIZE) {
+	if( reader->offset > reader->size ||
+		SIZE > reader->size - reader->offset ) {
+		return NULL;
+	}
+
+	uint8_t *data = reader->start + reader->offset;
+	reader->offset += SIZE;
+	return data;
+}
+
+static bool _readU32(Reader *reader, uint32_t *value) {
+	const uint8_t *DATA = _read(reader, sizeof(uint32_t));
+	if( DATA == NULL ) {
+		return false;
+	}
+
+	memcpy(value, DATA, sizeof(uint32_t));
+	return true;
+}
+
+/**
+ * @brief Pula o preenchimento até o próximo múltiplo de LOXC_ALIGN
+ */
+static void _skipPadding(Reader *reader) {
+	reader->offset = (reader->offset + LOXC_ALIGN - 1) & ~(LOXC_ALIGN - 1);
+}
+
+static ObjString *_readString(Reader *reader) {
+	uint32_t length;
+	if( !_readU32(reader, &length) ) {
+		return NULL;
+	}
+
+	const uint8_t *CHARS = _read(reader, length);
+	if( CHARS == NULL ) {
+		return NULL;
+	}
+
+	return objCopyString((const char *)CHARS, length);
+}
+
+/**
+ * @brief Lê um operando de @a SIZE bytes do jeito que a VM lê: 1 byte, 2
+ * bytes big-endian (pulos e caches) ou 3 bytes little-endian
+ *
+ * @return Se o operando cabe no código
+ */
+static bool _verifyRead(Verifier *v, const size_t SIZE, uint32_t *value) {
+	const Chunk *CHUNK = &v->function->chunk;
+	if( SIZE > CHUNK->count - v->at ) {
+		return false;
+	}
+
+	const uint8_t *BYTES = CHUNK->code + v->at;
+	v->at += SIZE;
+
+	if( SIZE == 1 ) {
+		*value = BYTES[0];
+	} else if( SIZE == 2 ) {
+		*value = (uint32_t)(BYTES[0] << 8) | BYTES[1];
+	} else {
+		*value = BYTES[0] | (BYTES[1] << 8) | ((uint32_t)BYTES[2] << 16);
+	}
+
+	return true;
+}
+
+/**
+ * @brief Confere um índice de @a SIZE bytes, que precisa ser menor que
+ * @a LIMIT
+ */
+static bool _verifyIndex(Verifier *v, const size_t SIZE, const size_t LIMIT) {
+	uint32_t index;
+	return _verifyRead(v, SIZE, &index) && index < LIMIT;
+}
+
+/**
+ * @brief Confere o índice de uma constante
+ *
+ * @param[in] IS_NAME Se a constante precisa ser uma string (nome de
+ * propriedade, método ou classe)
+ */
+static bool _verifyConst(Verifier *v, const size_t SIZE, const bool IS_NAME) {
+	const ValueArray *CONSTS = &v->function->chunk.consts;
+
+	uint32_t index;
+	if( !_verifyRead(v, SIZE, &index) || index >= CONSTS->count ) {
+		return false;
+	}
+
+	return !IS_NAME || IS_STRING(CONSTS->values[index]);
+}
+
+/**
+ * @brief Confere o offset de um pulo e marca o destino dele
+ *
+ * @param[in] IS_LOOP Se o pulo volta (OP_LOOP)
+ */
+static bool _verifyJump(Verifier *v, const bool IS_LOOP) {
+	uint32_t offset;
+	if( !_verifyRead(v, 2, &offset) || (IS_LOOP && offset > v->at) ) {
+		return false;
+	}
+
+	/* O pulo parte do fim do próprio operando */
+	const size_t TARGET = IS_LOOP ? v->at - offset : v->at + offset;
+	if( TARGET >= v->function->chunk.count ) {
+		return false;
+	}
+
+	v->marks[TARGET] |= VERIFY_TARGET;
+	return true;
+}
+
+/**
+ * @brief Confere uma closure: a função e de onde vem cada upvalue dela
+ */
+static bool _verifyClosure(Verifier *v, const size_t SIZE) {
+	const ValueArray *CONSTS = &v->function->chunk.consts;
+
+	uint32_t index;
+	if( !_verifyRead(v, SIZE, &index) || index >= CONSTS->count ||
+		!IS_FUNCTION(CONSTS->values[index]) ) {
+		return false;
+	}
+
+	const ObjFunction *INNER = AS_FUNCTION(CONSTS->values[index]);
+	for( size_t i = 0; i < INNER->upvalueCount; ++i ) {
+		uint32_t isLocal;
+		uint32_t slot;
+		if( !_verifyRead(v, 1, &isLocal) || !_verifyRead(v, 3, &slot) ) {
+			return false;
+		}
+
+		/* Um upvalue que não é uma local vem dos upvalues da própria função */
+		if( isLocal > 1 ||
+			(isLocal == 0 && slot >= v->function->upvalueCount) ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief Confere os operandos de @a OP, que começam em v->at
+ *
+ * Os índices das locais e as quantidades de argumentos não são
+ * conferidos, já que o arquivo não guarda o tamanho da frame de cada função
+ *
+ * @return Se a instrução existe e os operandos são válidos
+ */
+static bool _verifyOperands(Verifier *v, const uint8_t OP) {
+	const Chunk *CHUNK = &v->function->chunk;
+
+	switch( OP ) {
+		case OP_CONST_16:
+			return _verifyConst(v, 1, false);
+		case OP_CONST_32:
+			return _verifyConst(v, 3, false);
+
+		case OP_DEF_GLOBAL_16:
+		case OP_DEF_CONST_16:
+		case OP_GET_GLOBAL_16:
+		case OP_SET_GLOBAL_16:
+			return _verifyIndex(v, 1, v->globalCount);
+		case OP_DEF_GLOBAL_32:
+		case OP_DEF_CONST_32:
+		case OP_GET_GLOBAL_32:
+		case OP_SET_GLOBAL_32:
+			return _verifyIndex(v, 3, v->globalCount);
+
+		case OP_GET_LOCAL_16:
+		case OP_SET_LOCAL_16:
+		case OP_CALL:
+			return _verifyIndex(v, 1, SIZE_MAX);
+		case OP_GET_LOCAL_32:
+		case OP_SET_LOCAL_32:
+			return _verifyIndex(v, 3, SIZE_MAX);
+
+		case OP_GET_UPVALUE_16:
+		case OP_SET_UPVALUE_16:
+			return _verifyIndex(v, 1, v->function->upvalueCount);
+		case OP_GET_UPVALUE_32:
+		case OP_SET_UPVALUE_32:
+			return _verifyIndex(v, 3, v->function->upvalueCount);
+
+		case OP_JUMP:
+		case OP_JUMP_IF_FALSE:
+		case OP_JUMP_IF_TRUE:
+			return _verifyJump(v, false);
+		case OP_LOOP:
+			return _verifyJump(v, true);
+
+		case OP_CLOSURE_16:
+			return _verifyClosure(v, 1);
+		case OP_CLOSURE_32:
+			return _verifyClosure(v, 3);
+
+		case OP_CLASS_16:
+		case OP_METHOD_16:
+		case OP_GET_SUPER_16:
+			return _verifyConst(v, 1, true);
+		case OP_CLASS_32:
+		case OP_METHOD_32:
+		case OP_GET_SUPER_32:
+			return _verifyConst(v, 3, true);
+
+		case OP_GET_PROPERTY_16:
+		case OP_SET_PROPERTY_16:
+			return _verifyConst(v, 1, true) &&
+				   _verifyIndex(v, 2, CHUNK->cacheCount);
+		case OP_GET_PROPERTY_32:
+		case OP_SET_PROPERTY_32:
+			return _verifyConst(v, 3, true) &&
+				   _verifyIndex(v, 2, CHUNK->cacheCount);
+
+		case OP_INVOKE_16:
+			return _verifyConst(v, 1, true) && _verifyIndex(v, 1, SIZE_MAX) &&
+				   _verifyIndex(v, 2, CHUNK->cacheCount);
+		case OP_INVOKE_32:
+			return _verifyConst(v, 3, true) && _verifyIndex(v, 1, SIZE_MAX) &&
+				   _verifyIndex(v, 2, CHUNK->cacheCount);
+
+		case OP_SUPER_INVOKE_16:
+			return _verifyConst(v, 1, true) && _verifyIndex(v, 1, SIZE_MAX);
+		case OP_SUPER_INVOKE_32:
+			return _verifyConst(v, 3, true) && _verifyIndex(v, 1, SIZE_MAX);
+
+		/* O compilador troca todo OP_BREAK por um OP_JUMP */
+		case OP_BREAK:
+			return false;
+
+		default:
+			break;
+	}
+
+	if( OP <= OP_RETURN || (OP >= OP_EQUAL_NUM && OP <= OP_NEGATE_NUM) ) {
+		return true;
+	}
+
+	/* Registradores: R é uma local, K uma constante */
+	if( OP >= OP_ADD_RR && OP <= OP_LESS_EQUAL_RR ) {
+		return _verifyIndex(v, 2, SIZE_MAX);
+	}
+
+	if( OP >= OP_ADD_RK && OP <= OP_LESS_EQUAL_RK ) {
+		return _verifyIndex(v, 1, SIZE_MAX) && _verifyConst(v, 1, false);
+	}
+
+	if( OP >= OP_ADD_RRR && OP <= OP_MOD_RRR ) {
+		return _verifyIndex(v, 3, SIZE_MAX);
+	}
+
+	if( OP >= OP_ADD_RRK && OP <= OP_MOD_RRK ) {
+		return _verifyIndex(v, 2, SIZE_MAX) && _verifyConst(v, 1, false);
+	}
+
+	return false;
+}
+
+/**
+ * @brief Confere o código e a tabela de linhas de uma função lida, com as
+ * constantes já lidas
+ *
+ * Toda instrução precisa existir e ter os operandos inteiros no código,
+ * todo índice precisa cair dentro do que indexa, todo pulo precisa chegar
+ * no começo de uma instrução, e o código não pode acabar no meio (a última
+ * instrução retorna ou pula)
+ *
+ * A altura da pilha não é conferida: um arquivo adulterado de propósito
+ * ainda pode desequilibrar a pilha da VM
+ *
+ * @return Se a função pode ser entregue à VM
+ */
+static bool _verifyFunction(const ObjFunction *FUNCTION,
+							const uint32_t GLOBAL_COUNT) {
+	const Chunk *CHUNK = &FUNCTION->chunk;
+
+	/* chunkGetLine procura na tabela de linhas, que começa no offset 0 */
+	if( CHUNK->count == 0 || CHUNK->lineCount == 0 ||
+		CHUNK->lines[0].offset != 0 ) {
+		return false;
+	}
+
+	for( size_t i = 1; i < CHUNK->lineCount; ++i ) {
+		if( CHUNK->lines[i].offset < CHUNK->lines[i - 1].offset ||
+			CHUNK->lines[i].offset >= CHUNK->count ) {
+			return false;
+		}
+	}
+
+	Verifier v = {
+		.function = FUNCTION,
+		.globalCount = GLOBAL_COUNT,
+		.marks = calloc(CHUNK->count, sizeof(uint8_t)),
+		.at = 0,
+	};
+
+	if( v.marks == NULL ) {
+		return false;
+	}
+
+	bool valid = true;
+	uint8_t last = OP_RETURN;
+
+	while( valid && v.at < CHUNK->count ) {
+		v.marks[v.at] |= VERIFY_START;
+		const uint8_t OP = CHUNK->code[v.at++];
+
+		/* Uma superinstrução tem os operandos de cada instrução que junta */
+		uint8_t count;
+		const uint8_t *OPS = chunkSuperOps(OP, &count);
+		if( OPS == NULL ) {
+			OPS = &OP;
+			count = 1;
+		}
+
+		for( uint8_t i = 0; valid && i < count; ++i ) {
+			valid = _verifyOperands(&v, OPS[i]);
+			last = OPS[i];
+		}
+	}
+
+	valid = valid && (last == OP_RETURN || last == OP_JUMP || last == OP_LOOP);
+
+	for( size_t i = 0; valid && i < CHUNK->count; ++i ) {
+		valid = !(v.marks[i] & VERIFY_TARGET) || (v.marks[i] & VERIFY_START);
+	}
+
+	free(v.marks);
+	return valid;
+}
+
+static ObjFunction *_readFunction(Reader *reader) {
+	_skipPadding(reader);
+
+	const uint8_t *DATA = _read(reader, sizeof(LoxcFunction));
+	if( DATA == NULL ) {
+		return NULL;
+	}
+
+	LoxcFunction header;
+	memcpy(&header, DATA, sizeof(LoxcFunction));
+
+	ObjFunction *function = objMakeFunction();
+	function->arity = (uint8_t)header.arity;
+	function->upvalueCount = header.upvalueCount;
+
+	if( header.nameLength != LOXC_NO_NAME ) {
+		const uint8_t *NAME = _read(reader, header.nameLength);
+		if( NAME == NULL ) {
+			return NULL;
+		}
+
+		function->name = objCopyString((const char *)NAME, header.nameLength);
+	}
+
+	/* O código e as linhas ficam no arquivo */
+	Chunk *chunk = &function->chunk;
+	chunk->code = _read(reader, header.codeCount);
+
+	_skipPadding(reader);
+	chunk->lines =
+		(LineStart *)_read(reader, sizeof(LineStart) * header.lineCount);
+
+	if( chunk->code == NULL || chunk->lines == NULL ) {
+		return NULL;
+	}
+
+	chunk->count = chunk->size = header.codeCount;
+	chunk->lineCount = chunk->lineSize = header.lineCount;
+	chunk->isMapped = true;
+
+	/* Toda instrução com cache ocupa mais de um byte */
+	if( header.cacheCount > INLINE_CACHE_MAX ||
+		header.cacheCount > header.codeCount ) {
+		return NULL;
+	}
+
+	for( uint32_t i = 0; i < header.cacheCount; ++i ) {
+		chunkAddCache(chunk);
+	}
+
+	for( uint32_t i = 0; i < header.constCount; ++i ) {
+		const uint8_t *TYPE = _read(reader, sizeof(uint8_t));
+		if( TYPE == NULL ) {
+			return NULL;
+		}
+
+		Value value;
+		switch( *TYPE ) {
+			case LOXC_CONST_NUMBER: {
+				const uint8_t *NUMBER = _read(reader, sizeof(double));
+				if( NUMBER == NULL ) {
+					return NULL;
+				}
+
+				double number;
+				memcpy(&number, NUMBER, sizeof(double));
+				value = CREATE_NUMBER(number);
+			} break;
+
+			case LOXC_CONST_STRING: {
+				ObjString *string = _readString(reader);
+				if( string == NULL ) {
+					return NULL;
+				}
+
+				value = CREATE_OBJECT(string);
+			} break;
+
+			case LOXC_CONST_FUNCTION: {
+				ObjFunction *inner = _readFunction(reader);
+				if( inner == NULL ) {
+					return NULL;
+				}
+
+				value = CREATE_OBJECT(inner);
+			} break;
+
+			default:
+				return NULL;
+		}
+
+		gcPreBarrier((Obj *)function);
+		gcBarrier((Obj *)function, value);
+		chunkAddConst(chunk, value);
+	}
+
+	if( !_verifyFunction(function, reader->globalCount) ) {
+		return NULL;
+	}
+
+	return function;
+}
+
+/**
+ * @brief Registra as variáveis globais do arquivo nos mesmos índices que o
+ * compilador usou
+ *
+ * @return Se os índices batem com os das globais que já existem (as nativas)
+ */
+static bool _readGlobals(Reader *reader, const uint32_t COUNT) {
+	for( uint32_t i = 0; i < COUNT; ++i ) {
+		ObjString *string = _readString(reader);
+		if( string == NULL ) {
+			return false;
+		}
+
+		const Value NAME = CREATE_OBJECT(string);
+		Value index;
+		if( tableGet(&vm.globalNames, NAME, &index) ) {
+			if( (uint32_t)AS_NUMBER(index) != i ) {
+				return false;
+			}
+
+			continue;
+		}
+
+		if( vm.globalValues.count != i ) {
+			return false;
+		}
+
+		valueArrayWrite(&vm.globalValues, CREATE_EMPTY());
+		tableSet(&vm.globalNames, NAME, CREATE_NUMBER((double)i));
+	}
+
+	return true;
+}
+
+/**
+ * @brief Lê o arquivo inteiro para a memória
+ *
+ * @param[out] file Conteúdo e tamanho do arquivo
+ *
+ * @return Se o arquivo foi lido
+ */
+static bool _openFile(const char *PATH, LoxcFile *file) {
+#ifdef LOXC_MMAP
+	const int FD = open(PATH, O_RDONLY);
+	if( FD < 0 ) {
+		return false;
+	}
+
+	struct stat info;
+	if( fstat(FD, &info) != 0 || info.st_size == 0 ) {
+		close(FD);
+		return false;
+	}
+
+	/* Privado: se a VM reescrever o código, só a cópia desta página muda */
+	void *data = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE,
+					  MAP_PRIVATE, FD, 0);
+	close(FD);
+
+	if( data == MAP_FAILED ) {
+		return false;
+	}
+
+	file->data = data;
+	file->size = (size_t)info.st_size;
+	return true;
+#else
+	FILE *stream = fopen(PATH, "rb");
+	if( stream == NULL ) {
+		return false;
+	}
+
+	fseek(stream, 0L, SEEK_END);
+	const long SIZE = ftell(stream);
+	rewind(stream);
+
+	file->data = SIZE > 0 ? malloc((size_t)SIZE) : NULL;
+	file->size = (size_t)SIZE;
+
+	const bool READ = file->data != NULL &&
+					  fread(file->data, 1, file->size, stream) == file->size;
+	fclose(stream);
+
+	if( !READ ) {
+		free(file->data);
+	}
+
+	return READ;
+#endif
+}
+
+static void _closeFile(LoxcFile *file) {
+#ifdef LOXC_MMAP
+	munmap(file->data, file->size);
+#else
+	free(file->data);
+#endif
+}
+
+/**
+ * @brief Carrega o script de @a PATH
+ *
+ * @param[in] SOURCE Código-fonte que o arquivo precisa ter compilado (NULL
+ * fora do cache)
+ */
+static ObjFunction *_load(const char *PATH, const bool QUIET,
+						  const LoxcSource *SOURCE) {
+	LoxcFile file;
+	if( !_openFile(PATH, &file) ) {
+		_error(QUIET, "Nao foi possivel abrir o arquivo '%s'", PATH);
+		return NULL;
+	}
+
+	Reader reader = {
+		.start = file.data, .size = file.size, .offset = 0, .globalCount = 0};
+
+	LoxcHeader header;
+	const uint8_t *HEADER = _read(&reader, sizeof(LoxcHeader));
+	if( HEADER == NULL ||
+		memcmp(HEADER, LOXC_MAGIC, sizeof(header.magic)) != 0 ) {
+		_error(QUIET, "O arquivo '%s' nao e um .loxc", PATH);
+		_closeFile(&file);
+		return NULL;
+	}
+
+	memcpy(&header, HEADER, sizeof(LoxcHeader));
+	if( header.version != LOXC_VERSION || header.opCount != OP_COUNT ||
+		header.config != LOXC_CONFIG ) {
+		_error(QUIET,
+			   "O arquivo '%s' foi gerado por outra versao do Loxie. "
+			   "Compile o script de novo",
+			   PATH);
+		_closeFile(&file);
+		return NULL;
+	}
+
+	if( header.size != file.size ) {
+		_error(QUIET, "O arquivo '%s' esta incompleto", PATH);
+		_closeFile(&file);
+		return NULL;
+	}
+
+	if( SOURCE != NULL &&
+		memcmp(&header.source, SOURCE, sizeof(LoxcSource)) != 0 ) {
+		_error(QUIET, "O arquivo '%s' e de outro codigo-fonte", PATH);
+		_closeFile(&file);
+		return NULL;
+	}
+
+	reader.globalCount = header.globalCount;
+
+	nativeInit();
+
+	/* Nada do que foi criado está em uma raiz até o script começar */
+	const bool WAS_LOCKED = vm.isLocked;
+	vm.isLocked = true;
+
+	ObjFunction *script = NULL;
+	if( !_readGlobals(&reader, header.globalCount) ) {
+		_error(QUIET, "As variaveis globais de '%s' nao batem com as nativas",
+			   PATH);
+	} else if( (script = _readFunction(&reader)) == NULL ||
+			   script->arity != 0 || script->upvalueCount != 0 ||
+			   header.stackMax > UINT16_MAX ) {
+		script = NULL;
+		_error(QUIET, "O arquivo '%s' esta corrompido", PATH);
+	}
+
+	/* Mesmo com erro, funções já lidas apontam para o arquivo até serem
+	 * coletadas, então ele só é liberado no fim
+	 */
+	if( _fileSize < _fileCount + 1 ) {
+		const size_t OLD_SIZE = _fileSize;
+		_fileSize = MEM_GROW_SIZE(OLD_SIZE);
+		_files = MEM_GROW_ARRAY(LoxcFile, _files, OLD_SIZE, _fileSize);
+	}
+
+	_files[_fileCount++] = file;
+
+	if( script != NULL ) {
+		if( header.stackMax > vm.stackMax ) {
+			vm.stackMax = (uint16_t)header.stackMax;
+		}
+
+		vmInitStack();
+	}
+
+	vm.isLocked = WAS_LOCKED;
+	return script;
+}
+
+ObjFunction *bcLoad(const char *PATH) {
+	return _load(PATH, false, NULL);
+}
+
+#ifdef COMPILE_CACHE
+/** Tamanho máximo do caminho de um arquivo no cache */
+#define CACHE_PATH_MAX 4096
+
+/** Valor inicial do FNV-1a de 64 bits */
+#define CACHE_HASH_OFFSET 14695981039346656037ull
+
+/** Primo do FNV-1a de 64 bits */
+#define CACHE_HASH_PRIME 1099511628211ull
+
+/** Onde começa a hash do build no nome de um arquivo do cache */
+#define CACHE_BUILD_START 17
+
+/** Tamanho do nome de um arquivo do cache: [fonte]-[build].loxc */
+#define CACHE_NAME_LENGTH (CACHE_BUILD_START + 16 + sizeof(LOXC_EXTENSION) - 1)
+
+/** Idade, em segundos, a partir da qual um temporário é de quem morreu */
+#define CACHE_TMP_AGE (60 * 60)
+
+/**
+ * @brief Arquivo do cache, lembrado durante a limpeza
+ */
+typedef struct CacheEntry {
+	char name[CACHE_NAME_LENGTH + 1]; /**< Nome do arquivo */
+	uint64_t size;					  /**< Tamanho do arquivo */
+	time_t time;					  /**< Último uso (a modificação) */
+} CacheEntry;
+
+/** Constantes das rodadas do SHA-256 */
+static const uint32_t SHA256_K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+	0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+	0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+	0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+	0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+	0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+/** Rotação para a direita de 32 bits */
+#define SHA256_ROTR(X, N) (((X) >> (N)) | ((X) << (32 - (N))))
+
+/**
+ * @brief Continua a hash FNV-1a de 64 bits @a hash com mais @a SIZE bytes
+ */
+static uint64_t _hash(uint64_t hash, const void *DATA, const size_t SIZE) {
+	const uint8_t *BYTES = DATA;
+
+	for( size_t i = 0; i < SIZE; ++i ) {
+		hash ^= BYTES[i];
+		hash *= CACHE_HASH_PRIME;
+	}
+
+	return hash;
+}
+
+/**
+ * @brief Processa um bloco de 64 bytes do SHA-256
+ */
+static void _sha256Block(uint32_t state[8], const uint8_t *BLOCK) {
+	uint32_t w[64];
+	for( size_t i = 0; i < 16; ++i ) {
+		w[i] = (uint32_t)BLOCK[4 * i] << 24 | (uint32_t)BLOCK[4 * i + 1] << 16 |
+			   (uint32_t)BLOCK[4 * i + 2] << 8 | BLOCK[4 * i + 3];
+	}
+
+	for( size_t i = 16; i < 64; ++i ) {
+		const uint32_t S0 = SHA256_ROTR(w[i - 15], 7) ^
+							SHA256_ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		const uint32_t S1 = SHA256_ROTR(w[i - 2], 17) ^
+							SHA256_ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + S0 + w[i - 7] + S1;
+	}
+
+	uint32_t s[8];
+	memcpy(s, state, sizeof(s));
+
+	for( size_t i = 0; i < 64; ++i ) {
+		const uint32_t S1 =
+			SHA256_ROTR(s[4], 6) ^ SHA256_ROTR(s[4], 11) ^ SHA256_ROTR(s[4], 25);
+		const uint32_t CH = (s[4] & s[5]) ^ (~s[4] & s[6]);
+		const uint32_t T1 = s[7] + S1 + CH + SHA256_K[i] + w[i];
+		const uint32_t S0 =
+			SHA256_ROTR(s[0], 2) ^ SHA256_ROTR(s[0], 13) ^ SHA256_ROTR(s[0], 22);
+		const uint32_t MAJ = (s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]);
+
+		memmove(s + 1, s, sizeof(uint32_t) * 7);
+		s[4] += T1;
+		s[0] = T1 + S0 + MAJ;
+	}
+
+	for( size_t i = 0; i < 8; ++i ) {
+		state[i] += s[i];
+	}
+}
+
+/**
+ * @brief Calcula o SHA-256 de @a SIZE bytes
+ */
+static void _sha256(const void *DATA, const size_t SIZE,
+					uint8_t hash[LOXC_HASH_SIZE]) {
+	uint32_t state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+						 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+	const uint8_t *BYTES = DATA;
+	size_t done = 0;
+	for( ; SIZE - done >= 64; done += 64 ) {
+		_sha256Block(state, BYTES + done);
+	}
+
+	/* O resto, o bit 1, e o tamanho em bits no fim de um ou dois blocos */
+	uint8_t last[128] = {0};
+	const size_t REST = SIZE - done;
+	const size_t LAST_SIZE = REST < 56 ? 64 : 128;
+	const uint64_t BITS = (uint64_t)SIZE * 8;
+
+	memcpy(last, BYTES + done, REST);
+	last[REST] = 0x80;
+	for( size_t i = 0; i < 8; ++i ) {
+		last[LAST_SIZE - 1 - i] = (uint8_t)(BITS >> (8 * i));
+	}
+
+	for( size_t i = 0; i < LAST_SIZE; i += 64 ) {
+		_sha256Block(state, last + i);
+	}
+
+	for( size_t i = 0; i < LOXC_HASH_SIZE; ++i ) {
+		hash[i] = (uint8_t)(state[i / 4] >> (24 - 8 * (i % 4)));
+	}
+}
+
+/**
+ * @brief Monta o caminho de @a SOURCE no cache
+ *
+ * O nome do arquivo junta o começo do SHA-256 do código-fonte com a hash do
+ * build, feita com a versão do formato, as opções de compilação, o nível de
+ * otimização e o executável (tamanho, inode e hora da última modificação).
+ * Qualquer build novo usa arquivos novos. O SHA-256 inteiro e o tamanho do
+ * código-fonte vão no cabeçalho do arquivo
+ *
+ * @param[out] path Caminho do arquivo
+ * @param[out] dirLength Tamanho da parte do diretório em @a path
+ * @param[out] source Tamanho e SHA-256 de @a SOURCE
+ *
+ * @return Se o cache está ligado (LOXIE_CACHE não é "", e o caminho cabe
+ * em CACHE_PATH_MAX)
+ */
+static bool _cachePath(const char *SOURCE, char *path, size_t *dirLength,
+					   LoxcSource *source) {
+	const char *LOXIE_CACHE = getenv("LOXIE_CACHE");
+	const char *XDG_CACHE = getenv("XDG_CACHE_HOME");
+	const char *HOME = getenv("HOME");
+
+	int length;
+	if( LOXIE_CACHE != NULL ) {
+		length = snprintf(path, CACHE_PATH_MAX, "%s", LOXIE_CACHE);
+	} else if( XDG_CACHE != NULL && *XDG_CACHE != '\0' ) {
+		length = snprintf(path, CACHE_PATH_MAX, "%s/loxie", XDG_CACHE);
+	} else if( HOME != NULL && *HOME != '\0' ) {
+		length = snprintf(path, CACHE_PATH_MAX, "%s/.cache/loxie", HOME);
+	} else {
+		return false;
+	}
+
+	if( length <= 0 || length >= CACHE_PATH_MAX ) {
+		return false;
+	}
+
+	struct stat exe;
+	if( stat("/proc/self/exe", &exe) != 0 ) {
+		return false;
+	}
+
+	const uint32_t FORMAT[] = {LOXC_VERSION, OP_COUNT, LOXC_CONFIG, optLevel};
+	uint64_t build = _hash(CACHE_HASH_OFFSET, FORMAT, sizeof(FORMAT));
+	build = _hash(build, &exe.st_size, sizeof(exe.st_size));
+	build = _hash(build, &exe.st_ino, sizeof(exe.st_ino));
+	build = _hash(build, &exe.st_mtim, sizeof(exe.st_mtim));
+
+	source->length = strlen(SOURCE);
+	_sha256(SOURCE, source->length, source->hash);
+
+	uint64_t prefix = 0;
+	for( size_t i = 0; i < sizeof(uint64_t); ++i ) {
+		prefix = (prefix << 8) | source->hash[i];
+	}
+
+	*dirLength = (size_t)length;
+	length += snprintf(path + length, CACHE_PATH_MAX - length,
+					   "/%016llx-%016llx" LOXC_EXTENSION,
+					   (unsigned long long)prefix, (unsigned long long)build);
+
+	return length < CACHE_PATH_MAX;
+}
+
+/**
+ * @brief Cria o diretório @a dir e os que faltarem no caminho até ele
+ *
+ * @return Se o diretório existe
+ */
+static bool _makeDirs(char *dir) {
+	for( char *c = dir + 1; *c != '\0'; ++c ) {
+		if( *c == '/' ) {
+			*c = '\0';
+			mkdir(dir, 0700);
+			*c = '/';
+		}
+	}
+
+	return mkdir(dir, 0700) == 0 || errno == EEXIST;
+}
+
+/**
+ * @brief Se @a NAME começa com o nome de um arquivo do cache (um
+ * temporário tem o nome do arquivo e mais um sufixo)
+ */
+static bool _isCacheName(const char *NAME) {
+	for( size_t i = 0; i < CACHE_NAME_LENGTH - sizeof(LOXC_EXTENSION) + 1;
+		 ++i ) {
+		const bool IS_HEX = (NAME[i] >= '0' && NAME[i] <= '9') ||
+							(NAME[i] >= 'a' && NAME[i] <= 'f');
+
+		if( i == CACHE_BUILD_START - 1 ? NAME[i] != '-' : !IS_HEX ) {
+			return false;
+		}
+	}
+
+	return strncmp(NAME + CACHE_BUILD_START + 16, LOXC_EXTENSION,
+				   sizeof(LOXC_EXTENSION) - 1) == 0;
+}
+
+/**
+ * @brief Ordena os arquivos do cache do usado há mais tempo para o mais
+ * recente
+ */
+static int _compareAge(const void *A, const void *B) {
+	const time_t TIME_A = ((const CacheEntry *)A)->time;
+	const time_t TIME_B = ((const CacheEntry *)B)->time;
+	return (TIME_A > TIME_B) - (TIME_A < TIME_B);
+}
+
+/**
+ * @brief Limpa o diretório do cache depois de gravar @a NAME nele
+ *
+ * Só mexe nos arquivos com nome de arquivo do cache. Falhas são ignoradas
+ *
+ * @param[in] DIR_PATH Diretório do cache
+ * @param[in] NAME Nome do arquivo que acabou de ser gravado
+ */
+static void _prune(const char *DIR_PATH, const char *NAME) {
+	DIR *dir = opendir(DIR_PATH);
+	if( dir == NULL ) {
+		return;
+	}
+
+	const int FD = dirfd(dir);
+	const time_t NOW = time(NULL);
+
+	CacheEntry *entries = NULL;
+	size_t count = 0;
+	size_t size = 0;
+	uint64_t total = 0;
+
+	struct dirent *file;
+	while( (file = readdir(dir)) != NULL ) {
+		struct stat info;
+		if( !_isCacheName(file->d_name) ||
+			fstatat(FD, file->d_name, &info, AT_SYMLINK_NOFOLLOW) != 0 ||
+			!S_ISREG(info.st_mode) ) {
+			continue;
+		}
+
+		const time_t AGE = NOW - info.st_mtime;
+		const bool SAME_BUILD =
+			memcmp(file->d_name + CACHE_BUILD_START, NAME + CACHE_BUILD_START,
+				   16) == 0;
+
+		if( file->d_name[CACHE_NAME_LENGTH] != '\0' ) {
+			/* Temporário: só é velho se o processo que gravava morreu */
+			if( AGE > CACHE_TMP_AGE ) {
+				unlinkat(FD, file->d_name, 0);
+			}
+			continue;
+		}
+
+		if( !SAME_BUILD && AGE > CACHE_MAX_AGE ) {
+			unlinkat(FD, file->d_name, 0);
+			continue;
+		}
+
+		if( count == size ) {
+			const size_t NEW_SIZE = size < 64 ? 64 : size * 2;
+			CacheEntry *grown = realloc(entries, sizeof(CacheEntry) * NEW_SIZE);
+			if( grown == NULL ) {
+				break;
+			}
+
+			entries = grown;
+			size = NEW_SIZE;
+		}
+
+		CacheEntry *entry = &entries[count++];
+		memcpy(entry->name, file->d_name, sizeof(entry->name));
+		entry->size = (uint64_t)info.st_size;
+		entry->time = info.st_mtime;
+		total += entry->size;
+	}
+
+	if( total > CACHE_MAX_SIZE ) {
+		qsort(entries, count, sizeof(CacheEntry), _compareAge);
+
+		for( size_t i = 0; i < count && total > CACHE_MAX_SIZE; ++i ) {
+			if( strcmp(entries[i].name, NAME) != 0 &&
+				unlinkat(FD, entries[i].name, 0) == 0 ) {
+				total -= entries[i].size;
+			}
+		}
+	}
+
+	free(entries);
+	closedir(dir);
+}
+
+ObjFunction *bcCacheLoad(const char *SOURCE) {
+	char path[CACHE_PATH_MAX];
+	size_t dirLength;
+	LoxcSource source;
+	if( !_cachePath(SOURCE, path, &dirLength, &source) ) {
+		return NULL;
+	}
+
+	ObjFunction *script = _load(path, true, &source);
+
+	/* A hora da modificação marca o último uso, que decide quem sai
+	 * primeiro quando o cache fica grande demais
+	 */
+	if( script != NULL ) {
+		utimensat(AT_FDCWD, path, NULL, 0);
+	}
+
+	return script;
+}
+
+void bcCacheStore(ObjFunction *script, const char *SOURCE) {
+	char path[CACHE_PATH_MAX];
+	size_t dirLength;
+	LoxcSource source;
+	if( !_cachePath(SOURCE, path, &dirLength, &source) ) {
+		return;
+	}
+
+	path[dirLength] = '\0';
+	const bool HAS_DIR = _makeDirs(path);
+	path[dirLength] = '/';
+
+	/* Grava em um arquivo só deste processo e troca pelo nome final de uma
+	 * vez, então quem ler o cache ao mesmo tempo vê o arquivo inteiro ou
+	 * nenhum arquivo
+	 */
+	char temporary[CACHE_PATH_MAX];
+	if( !HAS_DIR || snprintf(temporary, CACHE_PATH_MAX, "%s.%ld.tmp", path,
+							 (long)getpid()) >= CACHE_PATH_MAX ) {
+		return;
+	}
+
+	if( !_save(script, temporary, true, &source) ) {
+		return;
+	}
+
+	if( rename(temporary, path) != 0 ) {
+		remove(temporary);
+		return;
+	}
+
+	path[dirLength] = '\0';
+	_prune(path, path + dirLength + 1);
+}
+#endif
+
+void bcFree(void) {
+	for( size_t i = 0; i < _fileCount; ++i ) {
+		_closeFile(&_files[i]);
+	}
+
+	MEM_FREE_ARRAY(LoxcFile, _files, _fileSize);
+	_files = NULL;
+	_fileCount = 0;
+	_fileSize = 0;
+}
@@ -8,6 +8,7 @@
 
 #include "chunk.h"
 
+#include <math.h>
 #include <stdio.h>
 
 #include "memory.h"
@@ -23,12 +24,23 @@ void chunkInit(Chunk* chunk) {
 	chunk->lineSize = 0;
 	chunk->lines = NULL;
 
+	chunk->cacheCount = 0;
+	chunk->cacheSize = 0;
+	chunk->caches = NULL;
+
+	chunk->isMapped = false;
+
 	valueArrayInit(&chunk->consts);
+	chunk->constIndex = NULL;
 }
 
 void chunkFree(Chunk* chunk) {
-	MEM_FREE_ARRAY(uint8_t, chunk->code, chunk->size);
-	MEM_FREE_ARRAY(LineStart, chunk->lines, chunk->lineSize);
+	/* O código de um .loxc pertence ao mapeamento do arquivo */
+	if( !chunk->isMapped ) {
+		MEM_FREE_ARRAY(uint8_t, chunk->code, chunk->size);
+		MEM_FREE_ARRAY(LineStart, chunk->lines, chunk->lineSize);
+	}
+	MEM_FREE_ARRAY(InlineCache, chunk->caches, chunk->cacheSize);
 	valueArrayFree(&chunk->consts);
 
 	chunkInit(chunk);
@@ -72,13 +84,63 @@ void chunkWrite(Chunk* chunk, const uint8_t BYTE, const size_t LINE) {
 	line->line = LINE;
 }
 
+void chunkTruncate(Chunk* chunk, const size_t COUNT) {
+	chunk->count = COUNT;
+
+	/* Linhas que começavam no código descartado também somem */
+	while( chunk->lineCount > 0 &&
+		   chunk->lines[chunk->lineCount - 1].offset >= COUNT ) {
+		--chunk->lineCount;
+	}
+}
+
+/**
+ * @brief Vê se uma constante pode ser reaproveitada pelo índice de constantes
+ *
+ * Só números e strings (que são internadas) entram no índice, já que os
+ * outros objetos nunca se repetem. NaN não é igual a si mesmo e -0 é igual a
+ * 0, então os dois também ficam de fora
+ *
+ * @param[in] VALUE Valor da constante
+ * @return Se a constante entra no índice
+ */
+static bool _isIndexable(const Value VALUE) {
+	if( IS_NUMBER(VALUE) ) {
+		const LOXIE_NUMBER NUMBER = AS_NUMBER(VALUE);
+		return NUMBER == NUMBER && !(NUMBER == 0 && signbit(NUMBER));
+	}
+
+	return IS_STRING(VALUE);
+}
+
 size_t chunkAddConst(Chunk* chunk, Value value) {
+	const bool IS_INDEXED =
+		chunk->constIndex != NULL && _isIndexable(value);
+
+	Value index;
+	if( IS_INDEXED && tableGet(chunk->constIndex, value, &index) ) {
+		return (size_t)AS_NUMBER(index);
+	}
+
+	const bool WAS_LOCKED = vm.isLocked;
 	vm.isLocked = true;
 	valueArrayWrite(&chunk->consts, value);
-	vm.isLocked = false;
+	if( IS_INDEXED ) {
+		tableSet(chunk->constIndex, value,
+				 CREATE_NUMBER((double)(chunk->consts.count - 1)));
+	}
+	vm.isLocked = WAS_LOCKED;
 	return chunk->consts.count - 1;
 }
 
+void chunkPopConst(Chunk* chunk) {
+	const Value VALUE = chunk->consts.values[--chunk->consts.count];
+
+	if( chunk->constIndex != NULL && _isIndexable(VALUE) ) {
+		tableDelete(chunk->constIndex, VALUE);
+	}
+}
+
 size_t chunkWriteConst(Chunk* chunk, Value value, const size_t LINE) {
 	const size_t INDEX = chunkAddConst(chunk, value);
 
@@ -102,6 +164,22 @@ size_t chunkWriteConst(Chunk* chunk, Value value, const size_t LINE) {
 	return INDEX;
 }
 
+size_t chunkAddCache(Chunk* chunk) {
+	if( chunk->cacheSize < chunk->cacheCount + 1 ) {
+		const size_t OLD_SIZE = chunk->cacheSize;
+		chunk->cacheSize = MEM_GROW_SIZE(OLD_SIZE);
+
+		chunk->caches = MEM_GROW_ARRAY(InlineCache, chunk->caches, OLD_SIZE,
+									   chunk->cacheSize);
+	}
+
+	InlineCache* cache = &chunk->caches[chunk->cacheCount];
+	cache->count = 0;
+	cache->next = 0;
+
+	return chunk->cacheCount++;
+}
+
 size_t chunkGetLine(Chunk* chunk, const size_t OFFSET) {
 	const size_t CURRENT_LINE = chunk->lineCount - 1;
 
@@ -125,3 +203,113 @@ size_t chunkGetLine(Chunk* chunk, const size_t OFFSET) {
 		}
 	}
 }
+
+size_t chunkInstructionLength(Chunk* chunk, const size_t OFFSET) {
+	const uint8_t OP = chunk->code[OFFSET];
+
+	switch( OP ) {
+		case OP_CONST_16:
+		case OP_DEF_GLOBAL_16:
+		case OP_DEF_CONST_16:
+		case OP_GET_GLOBAL_16:
+		case OP_GET_LOCAL_16:
+		case OP_GET_UPVALUE_16:
+		case OP_SET_GLOBAL_16:
+		case OP_SET_LOCAL_16:
+		case OP_SET_UPVALUE_16:
+		case OP_CALL:
+		case OP_CLASS_16:
+		case OP_METHOD_16:
+		case OP_GET_SUPER_16:
+			return 2;
+
+		case OP_JUMP:
+		case OP_JUMP_IF_FALSE:
+		case OP_JUMP_IF_TRUE:
+		case OP_LOOP:
+		case OP_BREAK:
+		case OP_SUPER_INVOKE_16:
+			return 3;
+
+		case OP_CONST_32:
+		case OP_DEF_GLOBAL_32:
+		case OP_DEF_CONST_32:
+		case OP_GET_GLOBAL_32:
+		case OP_GET_LOCAL_32:
+		case OP_GET_UPVALUE_32:
+		case OP_SET_GLOBAL_32:
+		case OP_SET_LOCAL_32:
+		case OP_SET_UPVALUE_32:
+		case OP_CLASS_32:
+		case OP_METHOD_32:
+		case OP_GET_SUPER_32:
+		case OP_GET_PROPERTY_16:
+		case OP_SET_PROPERTY_16:
+			return 4;
+
+		case OP_SUPER_INVOKE_32:
+		case OP_INVOKE_16:
+			return 5;
+
+		case OP_GET_PROPERTY_32:
+		case OP_SET_PROPERTY_32:
+			return 6;
+
+		case OP_INVOKE_32:
+			return 7;
+
+		case OP_CLOSURE_16: {
+			ObjFunction *function =
+				AS_FUNCTION(chunk->consts.values[chunk->code[OFFSET + 1]]);
+			return 2 + function->upvalueCount * 4;
+		}
+
+		case OP_CLOSURE_32: {
+			const uint32_t INDEX = chunk->code[OFFSET + 1] |
+								   (chunk->code[OFFSET + 2] << 8) |
+								   (chunk->code[OFFSET + 3] << 16);
+			ObjFunction *function = AS_FUNCTION(chunk->consts.values[INDEX]);
+			return 4 + function->upvalueCount * 4;
+		}
+
+#define SUPER_LENGTH(NAME, LENGTH, COUNT, ...) \
+	case NAME:                                 \
+		return LENGTH;
+			SUPERINSTRUCTIONS(SUPER_LENGTH)
+#undef SUPER_LENGTH
+
+		default:
+			break;
+	}
+
+	if( OP <= OP_RETURN || (OP >= OP_EQUAL_NUM && OP <= OP_NEGATE_NUM) ) {
+		return 1;
+	}
+
+	if( OP >= OP_ADD_RR && OP <= OP_LESS_EQUAL_RK ) {
+		return 3;
+	}
+
+	if( OP >= OP_ADD_RRR && OP <= OP_MOD_RRK ) {
+		return 4;
+	}
+
+	return 0;
+}
+
+const uint8_t *chunkSuperOps(const uint8_t OP, uint8_t *count) {
+	switch( OP ) {
+#define SUPER_OPS(NAME, LENGTH, COUNT, ...)         \
+	case NAME: {                                    \
+		static const uint8_t OPS[] = {__VA_ARGS__}; \
+		*count = COUNT;                             \
+		return OPS;                                 \
+	}
+		SUPERINSTRUCTIONS(SUPER_OPS)
+#undef SUPER_OPS
+
+		default:
+			*count = 0;
+			return NULL;
+	}
+}
@@ -8,6 +8,7 @@
 
 #include "compiler.h"
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,6 +19,7 @@
 #include "native.h"
 #include "object.h"
 #include "opcodes.h"
+#include "optimizer.h"
 #include "parser.h"
 #include "scanner.h"
 #include "token.h"
@@ -30,6 +32,9 @@
 /** Número máximo de casos em um escolha-caso */
 #define MAX_CASES 256
 
+/** Quantidade de instruções lembradas para serem fundidas */
+#define FUSE_HISTORY 2
+
 /**
  * @brief Struct representando uma variável local
  */
@@ -38,6 +43,8 @@ typedef struct Local {
 	int16_t depth;	 /**< Escopo da variável */
 	bool isCaptured; /**< Se esta variável foi capturada */
 	bool isConst;	 /**< Se esta variável é constante */
+	bool isKnown;	 /**< Se o valor da constante é conhecido na compilação */
+	Value value;	 /**< Valor da constante (se @a isKnown) */
 } Local;
 
 /**
@@ -49,6 +56,24 @@ typedef struct Upvalue {
 	bool isConst;  /**< Se esta variável é constante */
 } Upvalue;
 
+/**
+ * @brief Struct representando uma instrução recém-emitida
+ *
+ * As últimas instruções que leem/escrevem locais ou constantes são
+ * lembradas, para que operações sobre constantes possam ser calculadas
+ * durante a compilação e, com REGISTER_VM, fundidas em uma instrução de
+ * registradores
+ */
+typedef struct EmittedOp {
+	int32_t start; /**< Posição da instrução na chunk */
+	int32_t end;   /**< Posição logo depois da instrução */
+	uint8_t op;	   /**< OpCode da instrução */
+	uint8_t a;	   /**< Primeiro operando */
+	uint8_t b;	   /**< Segundo operando */
+	bool isNewConst; /**< Se a constante usada foi adicionada ao array por
+						esta instrução (e não reaproveitada) */
+} EmittedOp;
+
 /**
  * @brief Enum representando os tipos de função existentes
  */
@@ -76,6 +101,11 @@ typedef struct Compiler {
 	size_t upvalueSize; /**< Tamanho do array de upvalues */
 
 	int16_t scope; /**< Escopo das variáveis */
+
+	int32_t lastLabel; /**< Último alvo de um pulo na chunk */
+	EmittedOp emitted[FUSE_HISTORY]; /**< Últimas instruções emitidas */
+
+	Table constIndex; /**< Índice das constantes da chunk, pelo valor */
 } Compiler;
 
 /**
@@ -88,12 +118,20 @@ typedef struct ClassCompiler {
 
 uint16_t stackMax = 0;		 /**< Máximo de valores que estarão na pilha */
 int16_t innerLoopStart = -1; /**< Começo do loop mais interno */
+int32_t loopBreaks[UINT8_COUNT]; /**< Saltos dos 'saia' a serem corrigidos */
+uint16_t loopBreakCount = 0;	 /**< Quantidade de 'saia' pendentes */
 int16_t innerLoopScope = 0;	 /**< Profundidade do loop mais interno */
 
 Parser parser = {0};				/**< Instância global do Parser */
 Compiler* current = NULL;			/**< Ponteiro pro compilador atual */
 ClassCompiler* currentClass = NULL; /**< Ponteiro pro compilador de classe */
 
+/**
+ * @brief Constantes globais definidas nesta compilação (pelo índice), com o
+ * valor delas se ele é conhecido (ou vazio)
+ */
+Table constGlobals;
+
 static Chunk* _chunk() {
 	return &current->function->chunk;
 }
@@ -108,6 +146,8 @@ static void _precedence(const Precedence PRECEDENCE);
 static void _errorAtCurr(const char* MSG);
 static void _errorAtPrev(const char* MSG);
 
+static void _emitValue(const Value VALUE);
+
 static void _increaseStackMax(void) {
 	++stackMax;
 	if( stackMax >= vm.stackMax ) {
@@ -218,11 +258,450 @@ static void _emitBytes(const uint8_t BYTE1, const uint8_t BYTE2) {
 	_emitByte(BYTE2);
 }
 
+/**
+ * @brief Marca a posição atual da chunk como alvo de um pulo
+ *
+ * Instruções antes de um alvo nunca são fundidas com as que vêm depois
+ */
+static void _markLabel(void) {
+	current->lastLabel = _chunk()->count;
+}
+
+/**
+ * @brief Lembra da instrução que acabou de ser emitida
+ *
+ * @param[in] START Posição da instrução na chunk
+ * @param[in] OP OpCode da instrução
+ * @param[in] A Primeiro operando
+ * @param[in] B Segundo operando
+ */
+static void _recordOp(const int32_t START, const uint8_t OP, const uint8_t A,
+					  const uint8_t B) {
+	for( uint8_t i = 0; i < FUSE_HISTORY - 1; ++i ) {
+		current->emitted[i] = current->emitted[i + 1];
+	}
+
+	EmittedOp* last = &current->emitted[FUSE_HISTORY - 1];
+	last->start = START;
+	last->end = _chunk()->count;
+	last->op = OP;
+	last->a = A;
+	last->b = B;
+	last->isNewConst = false;
+}
+
+/**
+ * @brief Pega as últimas @a COUNT instruções lembradas
+ *
+ * Só retorna as instruções se elas forem seguidas, terminarem exatamente no
+ * fim da chunk e não houver nenhum alvo de pulo no meio delas
+ *
+ * @param[in] COUNT Quantidade de instruções
+ * @return A primeira das instruções, ou NULL
+ */
+static EmittedOp* _lastOps(const uint8_t COUNT) {
+	int32_t end = _chunk()->count;
+
+	for( uint8_t i = FUSE_HISTORY; i > FUSE_HISTORY - COUNT; --i ) {
+		EmittedOp* op = &current->emitted[i - 1];
+		if( op->end != end || op->start < current->lastLabel ) {
+			return NULL;
+		}
+
+		end = op->start;
+	}
+
+	return &current->emitted[FUSE_HISTORY - COUNT];
+}
+
+/**
+ * @brief Descarta o código a partir de @a START, junto com as instruções
+ * lembradas que estavam nele
+ *
+ * @param[in] START Posição a partir da qual o código é descartado
+ */
+static void _discardFrom(const int32_t START) {
+	chunkTruncate(_chunk(), START);
+
+	/* As instruções descartadas são as últimas lembradas. Elas saem do
+	 * histórico, para que as anteriores continuem sendo as últimas
+	 */
+	uint8_t kept = FUSE_HISTORY;
+	while( kept > 0 && current->emitted[kept - 1].end > START ) {
+		--kept;
+	}
+
+	const uint8_t SHIFT = FUSE_HISTORY - kept;
+	for( uint8_t i = FUSE_HISTORY; i > SHIFT; --i ) {
+		current->emitted[i - 1] = current->emitted[i - 1 - SHIFT];
+	}
+
+	for( uint8_t i = 0; i < SHIFT; ++i ) {
+		current->emitted[i].start = -1;
+		current->emitted[i].end = -1;
+	}
+
+	if( current->lastLabel > START ) {
+		current->lastLabel = START;
+	}
+}
+
+/**
+ * @brief Pega o valor empilhado por uma instrução lembrada, se ela só empilha
+ * uma constante
+ *
+ * @param[in] OP Instrução lembrada
+ * @param[out] value Valor da constante
+ * @return Se a instrução empilha uma constante
+ */
+static bool _constantOf(const EmittedOp* OP, Value* value) {
+	const uint8_t* CODE = _chunk()->code + OP->start;
+
+	switch( OP->op ) {
+		case OP_CONST_16:
+			*value = _chunk()->consts.values[CODE[1]];
+			return true;
+		case OP_CONST_32:
+			*value = _chunk()->consts.values[CODE[1] | (CODE[2] << 8) |
+											 (CODE[3] << 16)];
+			return true;
+		case OP_TRUE:
+			*value = CREATE_BOOL(true);
+			return true;
+		case OP_FALSE:
+			*value = CREATE_BOOL(false);
+			return true;
+		case OP_NIL:
+			*value = CREATE_NIL();
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+ * @brief Tira do array de constantes a constante empilhada por @a OP, se ela
+ * foi adicionada por @a OP e é a última do array (e então só é usada por
+ * @a OP, ou por instruções depois dela que também estão sendo descartadas)
+ *
+ * @param[in] OP Instrução lembrada, prestes a ser descartada
+ */
+static void _dropConstant(const EmittedOp* OP) {
+	const uint8_t* CODE = _chunk()->code + OP->start;
+
+	size_t index;
+	if( OP->op == OP_CONST_16 ) {
+		index = CODE[1];
+	} else if( OP->op == OP_CONST_32 ) {
+		index = CODE[1] | (CODE[2] << 8) | (CODE[3] << 16);
+	} else {
+		return;
+	}
+
+	if( OP->isNewConst && index + 1 == _chunk()->consts.count ) {
+		chunkPopConst(_chunk());
+	}
+}
+
+#ifdef REGISTER_VM
+/**
+ * @brief Troca as últimas instruções por uma instrução de registradores
+ *
+ * @param[in] START Posição da primeira instrução substituída
+ * @param[in] OP OpCode da nova instrução
+ * @param[in] OPERANDS Operandos da nova instrução
+ * @param[in] COUNT Quantidade de operandos
+ */
+static void _emitFused(const int32_t START, const uint8_t OP,
+					   const uint8_t* OPERANDS, const uint8_t COUNT) {
+	_discardFrom(START);
+
+	_emitByte(OP);
+	for( uint8_t i = 0; i < COUNT; ++i ) {
+		_emitByte(OPERANDS[i]);
+	}
+
+	_recordOp(START, OP, OPERANDS[0], OPERANDS[1]);
+}
+
+/**
+ * @brief Índice de uma operação binária nos grupos de instruções de
+ * registradores
+ *
+ * @param[in] OP Operação binária genérica
+ * @return O índice (OP_ADD_RR + índice), ou -1 se não existe versão de
+ * registradores
+ */
+static int8_t _registerIndex(const OpCode OP) {
+	switch( OP ) {
+		case OP_ADD:
+			return 0;
+		case OP_SUB:
+			return 1;
+		case OP_MUL:
+			return 2;
+		case OP_DIV:
+			return 3;
+		case OP_MOD:
+			return 4;
+		case OP_EQUAL:
+			return 5;
+		case OP_GREATER:
+			return 6;
+		case OP_GREATER_EQUAL:
+			return 7;
+		case OP_LESS:
+			return 8;
+		case OP_LESS_EQUAL:
+			return 9;
+		default:
+			return -1;
+	}
+}
+#endif
+
+static bool _isFalsey(const Value VALUE) {
+	return IS_NIL(VALUE) || (IS_BOOL(VALUE) && !AS_BOOL(VALUE));
+}
+
+/**
+ * @brief Calcula uma operação binária entre duas constantes, do mesmo jeito
+ * que a VM calcularia
+ *
+ * @param[in] OP Operação binária
+ * @param[in] A Primeiro operando
+ * @param[in] B Segundo operando
+ * @param[out] result Resultado da operação
+ *
+ * @return Se a operação foi calculada. Operandos que a VM rejeitaria ficam
+ * para dar erro durante a execução
+ */
+static bool _evalBinary(const OpCode OP, const Value A, const Value B,
+						Value* result) {
+	if( OP == OP_EQUAL ) {
+		*result = CREATE_BOOL(valueEquals(A, B));
+		return true;
+	}
+
+	if( OP == OP_ADD && IS_STRING(A) && IS_STRING(B) ) {
+		ObjString* strA = AS_STRING(A);
+		ObjString* strB = AS_STRING(B);
+		const size_t LENGTH = strA->length + strB->length;
+
+		char* buffer = malloc(LENGTH + 1);
+		if( buffer == NULL ) {
+			return false;
+		}
+
+		memcpy(buffer, strA->str, strA->length);
+		memcpy(buffer + strA->length, strB->str, strB->length);
+		*result = CREATE_OBJECT(objCopyString(buffer, LENGTH));
+
+		free(buffer);
+		return true;
+	}
+
+	if( !IS_NUMBER(A) || !IS_NUMBER(B) ) {
+		return false;
+	}
+
+	const LOXIE_NUMBER X = AS_NUMBER(A);
+	const LOXIE_NUMBER Y = AS_NUMBER(B);
+
+	switch( OP ) {
+		case OP_ADD:
+			*result = CREATE_NUMBER(X + Y);
+			return true;
+		case OP_SUB:
+			*result = CREATE_NUMBER(X - Y);
+			return true;
+		case OP_MUL:
+			*result = CREATE_NUMBER(X * Y);
+			return true;
+		case OP_DIV:
+			*result = CREATE_NUMBER(X / Y);
+			return true;
+		case OP_MOD:
+			*result = CREATE_NUMBER(fmod(X, Y));
+			return true;
+		case OP_GREATER:
+			*result = CREATE_BOOL(X > Y);
+			return true;
+		case OP_GREATER_EQUAL:
+			*result = CREATE_BOOL(X >= Y);
+			return true;
+		case OP_LESS:
+			*result = CREATE_BOOL(X < Y);
+			return true;
+		case OP_LESS_EQUAL:
+			*result = CREATE_BOOL(X <= Y);
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+ * @brief Calcula uma operação unária sobre uma constante
+ *
+ * @param[in] OP Operação unária
+ * @param[in] A Operando
+ * @param[out] result Resultado da operação
+ *
+ * @return Se a operação foi calculada
+ */
+static bool _evalUnary(const OpCode OP, const Value A, Value* result) {
+	if( OP == OP_NOT ) {
+		*result = CREATE_BOOL(_isFalsey(A));
+		return true;
+	}
+
+	if( OP == OP_NEGATE && IS_NUMBER(A) ) {
+		*result = CREATE_NUMBER(-AS_NUMBER(A));
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * @brief Troca as últimas instruções lembradas, que empilham constantes, pelo
+ * resultado da operação sobre elas
+ *
+ * @param[in] ops Primeira das instruções
+ * @param[in] COUNT Quantidade de instruções
+ * @param[in] RESULT Valor que as substitui
+ */
+static void _replaceConstants(EmittedOp* ops, const uint8_t COUNT,
+							  const Value RESULT) {
+	const int32_t START = ops[0].start;
+
+	for( uint8_t i = COUNT; i > 0; --i ) {
+		_dropConstant(&ops[i - 1]);
+	}
+	_discardFrom(START);
+
+	/* Os operandos já foram contados na pilha */
+	_emitValue(RESULT);
+	_decreaseStackMax();
+}
+
+/**
+ * @brief Calcula uma operação binária durante a compilação, se os dois
+ * operandos acabaram de ser empilhados como constantes
+ *
+ * @param[in] OP Operação binária
+ * @return Se a operação foi calculada (e não precisa ser emitida)
+ */
+static bool _foldBinary(const OpCode OP) {
+	EmittedOp* ops = _lastOps(2);
+	Value a, b, result;
+
+	if( optLevel == 0 || ops == NULL || !_constantOf(&ops[0], &a) ||
+		!_constantOf(&ops[1], &b) || !_evalBinary(OP, a, b, &result) ) {
+		return false;
+	}
+
+	_replaceConstants(ops, 2, result);
+	return true;
+}
+
+/**
+ * @brief Emite uma operação unária, calculando-a durante a compilação se o
+ * operando for uma constante
+ *
+ * @param[in] OP Operação unária
+ */
+static void _emitUnary(const OpCode OP) {
+	EmittedOp* ops = _lastOps(1);
+	Value a, result;
+
+	if( optLevel > 0 && ops != NULL && _constantOf(ops, &a) &&
+		_evalUnary(OP, a, &result) ) {
+		_replaceConstants(ops, 1, result);
+		return;
+	}
+
+	_emitByte(OP);
+}
+
+/**
+ * @brief Emite uma operação binária
+ *
+ * Se os dois operandos forem constantes, a operação é calculada durante a
+ * compilação. Com REGISTER_VM, se os dois operandos acabaram de ser
+ * empilhados por OP_GET_LOCAL/OP_CONST, eles são fundidos junto da operação
+ * em uma só instrução que lê os operandos direto dos slots (e constantes)
+ *
+ * @param[in] OP Operação binária
+ */
+static void _emitBinary(const OpCode OP) {
+	if( _foldBinary(OP) ) {
+		return;
+	}
+
+#ifdef REGISTER_VM
+	const int8_t INDEX = _registerIndex(OP);
+	EmittedOp* ops = _lastOps(2);
+
+	if( INDEX >= 0 && ops != NULL && ops[0].op == OP_GET_LOCAL_16 ) {
+		const uint8_t OPERANDS[] = {ops[0].a, ops[1].a};
+
+		if( ops[1].op == OP_GET_LOCAL_16 ) {
+			_emitFused(ops[0].start, OP_ADD_RR + INDEX, OPERANDS, 2);
+			return;
+		}
+
+		if( ops[1].op == OP_CONST_16 ) {
+			_emitFused(ops[0].start, OP_ADD_RK + INDEX, OPERANDS, 2);
+			return;
+		}
+	}
+#endif
+
+	_emitByte(OP);
+}
+
+/**
+ * @brief Funde "operação, OP_SET_LOCAL, OP_POP" em uma instrução que guarda o
+ * resultado direto na local
+ *
+ * @return Se as instruções foram fundidas (e o pop não é mais necessário)
+ */
+static bool _fuseStore(void) {
+#ifdef REGISTER_VM
+	EmittedOp* ops = _lastOps(2);
+	if( ops == NULL || ops[1].op != OP_SET_LOCAL_16 ) {
+		return false;
+	}
+
+	const uint8_t OP = ops[0].op;
+	const uint8_t OPERANDS[] = {ops[1].a, ops[0].a, ops[0].b};
+
+	if( OP >= OP_ADD_RR && OP <= OP_MOD_RR ) {
+		_emitFused(ops[0].start, OP_ADD_RRR + (OP - OP_ADD_RR), OPERANDS, 3);
+		return true;
+	}
+
+	if( OP >= OP_ADD_RK && OP <= OP_MOD_RK ) {
+		_emitFused(ops[0].start, OP_ADD_RRK + (OP - OP_ADD_RK), OPERANDS, 3);
+		return true;
+	}
+#endif
+
+	return false;
+}
+
 /**
  * @brief Emite uma instrução pop
  */
 static void _emitPop(void) {
 	_decreaseStackMax();
+
+	if( _fuseStore() ) {
+		return;
+	}
+
 	_emitByte(OP_POP);
 }
 
@@ -240,6 +719,19 @@ static void _emitConstantWithOp(const OpCode TYPE_SHORT, const OpCode TYPE_LONG,
 	_emitByte((uint8_t)INDEX);
 }
 
+/**
+ * @brief Reserva um cache em linha na chunk e escreve seu índice (16-bit)
+ */
+static void _emitCache(void) {
+	const size_t INDEX = chunkAddCache(_chunk());
+	if( INDEX > INLINE_CACHE_MAX ) {
+		_errorAtPrev("Acessos a propriedades demais em uma so funcao");
+	}
+
+	_emitByte((INDEX >> 8) & 0xff);
+	_emitByte(INDEX & 0xff);
+}
+
 /**
  * @brief Emite uma instrução de retorno
  */
@@ -262,6 +754,14 @@ static ObjFunction* _end(void) {
 	_emitReturn();
 	ObjFunction* function = current->function;
 
+	if( !parser.hadError ) {
+		optChunk(_chunk());
+	}
+
+	/* O índice só serve enquanto a chunk é compilada */
+	tableFree(&current->constIndex);
+	_chunk()->constIndex = NULL;
+
 #ifdef DEBUG_PRINT_CODE
 	if( !parser.hadError ) {
 		debugDisassembleChunk(_chunk(), function->name != NULL
@@ -285,6 +785,8 @@ static ObjFunction* _end(void) {
  */
 static size_t _makeConstant(Value value) {
 	_increaseStackMax();
+	gcPreBarrier((Obj*)current->function);
+	gcBarrier((Obj*)current->function, value);
 	return chunkAddConst(_chunk(), value);
 }
 
@@ -296,7 +798,38 @@ static size_t _makeConstant(Value value) {
  */
 static void _emitConstant(Value value) {
 	_increaseStackMax();
-	chunkWriteConst(_chunk(), value, parser.previous.line);
+
+	const int32_t START = _chunk()->count;
+	gcPreBarrier((Obj*)current->function);
+	gcBarrier((Obj*)current->function, value);
+	const size_t COUNT = _chunk()->consts.count;
+	const size_t INDEX = chunkWriteConst(_chunk(), value, parser.previous.line);
+	_recordOp(START, INDEX <= UINT8_MAX ? OP_CONST_16 : OP_CONST_32,
+			  (uint8_t)INDEX, 0);
+	current->emitted[FUSE_HISTORY - 1].isNewConst =
+		_chunk()->consts.count > COUNT;
+}
+
+/**
+ * @brief Empilha um valor conhecido durante a compilação, usando OP_TRUE,
+ * OP_FALSE e OP_NIL quando possível
+ *
+ * @param[in] VALUE Valor que será empilhado
+ */
+static void _emitValue(const Value VALUE) {
+	if( !IS_BOOL(VALUE) && !IS_NIL(VALUE) ) {
+		_emitConstant(VALUE);
+		return;
+	}
+
+	const uint8_t OP = IS_NIL(VALUE)	   ? OP_NIL
+					   : AS_BOOL(VALUE) ? OP_TRUE
+										: OP_FALSE;
+	const int32_t START = _chunk()->count;
+
+	_increaseStackMax();
+	_emitByte(OP);
+	_recordOp(START, OP, 0, 0);
 }
 
 static void _emitLoop(const int32_t LOOP_START) {
@@ -320,6 +853,8 @@ static void _patchJump(const int32_t OFFSET) {
 
 	_chunk()->code[OFFSET] = (JUMP >> 8) & 0xff;
 	_chunk()->code[OFFSET + 1] = JUMP & 0xff;
+
+	_markLabel();
 }
 
 static int32_t _emitJump(const OpCode INSTRUCTION) {
@@ -345,12 +880,24 @@ static void _initCompiler(Compiler* compiler, const FunctionType TYPE) {
 
 	compiler->scope = 0;
 
+	compiler->lastLabel = 0;
+	for( uint8_t i = 0; i < FUSE_HISTORY; ++i ) {
+		compiler->emitted[i].start = -1;
+		compiler->emitted[i].end = -1;
+	}
+
 	compiler->function = objMakeFunction();
+	tableInit(&compiler->constIndex);
+	compiler->function->chunk.constIndex = &compiler->constIndex;
 
 	current = compiler;
 	if( TYPE != TYPE_SCRIPT ) {
-		current->function->name =
+		ObjString* name =
 			objCopyString(parser.previous.START, parser.previous.length);
+		gcPreBarrier((Obj*)current->function);
+		current->function->name = name;
+		gcBarrier((Obj*)current->function,
+				  CREATE_OBJECT(current->function->name));
 	}
 
 	/* Dedicamos o primeiro slot do array de variáveis locais
@@ -360,6 +907,7 @@ static void _initCompiler(Compiler* compiler, const FunctionType TYPE) {
 	local->depth = 0;
 	local->isCaptured = false;
 	local->isConst = false;
+	local->isKnown = false;
 
 	local->name.type = TOKEN_NIL;
 
@@ -446,10 +994,11 @@ static size_t _identifierConstant(Token* name) {
 
 	const size_t INDEX = vm.globalValues.count;
 
+	const bool WAS_LOCKED = vm.isLocked;
 	vm.isLocked = true;
 	valueArrayWrite(&vm.globalValues, CREATE_EMPTY());
 	tableSet(&vm.globalNames, string, CREATE_NUMBER((double)INDEX));
-	vm.isLocked = false;
+	vm.isLocked = WAS_LOCKED;
 
 	return INDEX;
 }
@@ -485,6 +1034,7 @@ static void _addLocal(Token name) {
 	local->depth = -1;
 	local->isCaptured = false;
 	local->isConst = false;
+	local->isKnown = false;
 }
 
 static ssize_t _resolveLocal(Compiler* compiler, Token* name) {
@@ -580,12 +1130,82 @@ static size_t _parseVariable(const char* MSG) {
 	return _identifierConstant(&parser.previous);
 }
 
+/**
+ * @brief Vê se a global é uma constante definida antes nesta compilação
+ *
+ * @param[in] GLOBAL Índice da variável global
+ * @return Se a global é uma constante
+ */
+static bool _isConstGlobal(const size_t GLOBAL) {
+	Value value;
+	return tableGet(&constGlobals, CREATE_NUMBER((double)GLOBAL), &value);
+}
+
+/**
+ * @brief Procura o valor de uma constante global definida antes nesta
+ * compilação
+ *
+ * @param[in] GLOBAL Índice da variável global
+ * @param[out] value Valor da constante
+ * @return Se a global é uma constante de valor conhecido
+ */
+static bool _isKnownGlobal(const size_t GLOBAL, Value* value) {
+	return tableGet(&constGlobals, CREATE_NUMBER((double)GLOBAL), value) &&
+		   !IS_EMPTY(*value);
+}
+
+/**
+ * @brief Procura o valor conhecido da variável @a name, olhando as locais de
+ * cada função (de dentro pra fora) e depois as globais
+ *
+ * @param[in] name Nome da variável
+ * @param[out] value Valor da constante
+ * @return Se a variável é uma constante de valor conhecido
+ */
+static bool _knownValue(Token* name, Value* value) {
+	for( Compiler* compiler = current; compiler != NULL;
+		 compiler = compiler->enclosing ) {
+		for( int32_t i = compiler->localCount - 1; i >= 0; --i ) {
+			Local* local = &compiler->locals[i];
+
+			if( _identifiersEqual(name, &local->name) ) {
+				*value = local->value;
+				return local->isKnown;
+			}
+		}
+	}
+
+	return _isKnownGlobal(_identifierConstant(name), value);
+}
+
+/**
+ * @brief Lembra da constante recém-definida e do valor dela, para que os usos
+ * da constante sejam trocados pelo valor
+ *
+ * @param[in] GLOBAL Índice da constante (se ela for global)
+ * @param[in] VALUE Valor da constante (vazio se não é conhecido)
+ */
+static void _rememberConst(const size_t GLOBAL, const Value VALUE) {
+	if( current->scope > 0 ) {
+		Local* local = &current->locals[current->localCount - 1];
+		local->isKnown = !IS_EMPTY(VALUE);
+		local->value = VALUE;
+		return;
+	}
+
+	tableSet(&constGlobals, CREATE_NUMBER((double)GLOBAL), VALUE);
+}
+
 static void _defineVariable(const uint32_t GLOBAL) {
 	if( current->scope > 0 ) {
 		_markInitialized(false);
 		return;
 	}
 
+	if( _isConstGlobal(GLOBAL) ) {
+		_errorAtPrev("Nao e possivel redefinir uma constante");
+	}
+
 	_emitConstantWithOp(OP_DEF_GLOBAL_16, OP_DEF_GLOBAL_32, GLOBAL);
 }
 
@@ -595,13 +1215,60 @@ static void _defineConst(const uint32_t GLOBAL) {
 		return;
 	}
 
+	if( _isConstGlobal(GLOBAL) ) {
+		_errorAtPrev("Nao e possivel redefinir uma constante");
+	}
+
 	_decreaseStackMax();
 	_emitConstantWithOp(OP_DEF_CONST_16, OP_DEF_CONST_32, GLOBAL);
 }
 
+/**
+ * @brief Compila o lado direito de um 'e'/'ou' cujo lado esquerdo acabou de
+ * ser empilhado como constante, sem emitir nenhum pulo
+ *
+ * O lado direito é sempre compilado (para que os erros dele sejam
+ * reportados), mas só fica na chunk se for ele o resultado
+ *
+ * @param[in] PRECEDENCE Precedência do lado direito
+ * @param[in] RIGHT_IF_FALSEY Se o lado direito é o resultado quando o
+ * esquerdo é falso ('ou') em vez de quando é verdadeiro ('e')
+ *
+ * @return Se a expressão foi compilada (e os pulos não são mais necessários)
+ */
+static bool _foldLogical(const Precedence PRECEDENCE,
+						 const bool RIGHT_IF_FALSEY) {
+	EmittedOp* left = _lastOps(1);
+	Value value;
+
+	if( optLevel == 0 || left == NULL || !_constantOf(left, &value) ) {
+		return false;
+	}
+
+	if( _isFalsey(value) == RIGHT_IF_FALSEY ) {
+		_dropConstant(left);
+		_discardFrom(left->start);
+		_decreaseStackMax();
+
+		_precedence(PRECEDENCE);
+		return true;
+	}
+
+	const int32_t START = _chunk()->count;
+	_precedence(PRECEDENCE);
+	_discardFrom(START);
+	_decreaseStackMax();
+
+	return true;
+}
+
 static void _and(const bool CAN_ASSIGN) {
 	INTENTIONALLY_UNUSED(CAN_ASSIGN);
 
+	if( _foldLogical(PREC_AND, false) ) {
+		return;
+	}
+
 	const int32_t END_JUMP = _emitJump(OP_JUMP_IF_FALSE);
 
 	_emitPop();
@@ -613,6 +1280,10 @@ static void _and(const bool CAN_ASSIGN) {
 static void _or(const bool CAN_ASSIGN) {
 	INTENTIONALLY_UNUSED(CAN_ASSIGN);
 
+	if( _foldLogical(PREC_OR, true) ) {
+		return;
+	}
+
 	const int32_t ELSE_JUMP = _emitJump(OP_JUMP_IF_FALSE);
 	const int32_t END_JUMP = _emitJump(OP_JUMP);
 
@@ -675,6 +1346,7 @@ static void _varDeclaration(void) {
 
 static void _constDeclaration(void) {
 	const size_t GLOBAL = _parseVariable("Esperava o nome da variável.");
+	const int32_t START = _chunk()->count;
 
 	if( _match(TOKEN_EQUAL) ) {
 		_expression();
@@ -684,7 +1356,22 @@ static void _constDeclaration(void) {
 
 	_consume(TOKEN_SEMICOLON, "Esperava ';' depois de declaração de variável.");
 
+	/* Se o valor é uma constante só, os usos da constante viram o valor. Uma
+	 * global que código compilado antes muda (uma função declarada antes da
+	 * constante, por exemplo) não tem valor conhecido: a VM não impede a
+	 * mudança
+	 */
+	EmittedOp* last = _lastOps(1);
+	Value value;
+	Value isSet;
+	const bool IS_KNOWN =
+		optLevel > 0 && last != NULL && last->start == START &&
+		_constantOf(last, &value) &&
+		(current->scope > 0 ||
+		 !tableGet(&vm.globalSets, CREATE_NUMBER((double)GLOBAL), &isSet));
+
 	_defineConst(GLOBAL);
+	_rememberConst(GLOBAL, IS_KNOWN ? value : CREATE_EMPTY());
 }
 
 static void _funcDeclaration(void) {
@@ -713,7 +1400,10 @@ static void _checkCanAssign(const ssize_t ARG, const uint8_t OP) {
 			break;
 
 		case OP_SET_GLOBAL_16: {
-			if( IS_CONSTANT(vm.globalValues.values[ARG]) ) {
+			Value isConst;
+			if( tableGet(&vm.globalConsts, CREATE_NUMBER((double)ARG),
+						 &isConst) ||
+				_isConstGlobal(ARG) ) {
 				_errorAtPrev("Tentou mudar o valor de uma constante");
 			}
 		} break;
@@ -724,6 +1414,13 @@ static void _checkCanAssign(const ssize_t ARG, const uint8_t OP) {
 }
 
 static void _namedVariable(Token name, const bool CAN_ASSIGN) {
+	Value known;
+	if( optLevel > 0 && !(CAN_ASSIGN && _check(TOKEN_EQUAL)) &&
+		_knownValue(&name, &known) ) {
+		_emitValue(known);
+		return;
+	}
+
 	uint8_t getOp, setOp;
 	ssize_t arg = _resolveLocal(current, &name);
 
@@ -739,13 +1436,26 @@ static void _namedVariable(Token name, const bool CAN_ASSIGN) {
 		setOp = OP_SET_GLOBAL_16;
 	}
 
-	if( CAN_ASSIGN && _match(TOKEN_EQUAL) ) {
+	const bool IS_SET = CAN_ASSIGN && _match(TOKEN_EQUAL);
+	if( IS_SET ) {
 		_checkCanAssign(arg, setOp);
+
+		if( setOp == OP_SET_GLOBAL_16 ) {
+			tableSet(&vm.globalSets, CREATE_NUMBER((double)arg),
+					 CREATE_BOOL(true));
+		}
+
 		_expression();
-		_emitConstantWithOp(setOp, setOp + 1, arg);
 	} else {
 		_increaseStackMax();
-		_emitConstantWithOp(getOp, getOp + 1, arg);
+	}
+
+	const uint8_t OP = IS_SET ? setOp : getOp;
+	const int32_t START = _chunk()->count;
+	_emitConstantWithOp(OP, OP + 1, arg);
+
+	if( arg <= UINT8_MAX ) {
+		_recordOp(START, OP, arg, 0);
 	}
 }
 
@@ -963,26 +1673,34 @@ static void _returnStatement() {
 	}
 }
 
-static void _fixUpBreaks(void) {
-	size_t offset = (size_t)innerLoopStart;
+/**
+ * @brief Corrige os 'saia' emitidos desde o começo do loop atual, para que
+ * pulem pro fim dele
+ *
+ * Os saltos são guardados em @ref loopBreaks quando emitidos, já que procurar
+ * por OP_BREAK nos bytes da chunk confundiria operandos com instruções
+ *
+ * @param[in] FIRST Índice do primeiro 'saia' do loop em @ref loopBreaks
+ */
+static void _fixUpBreaks(const uint16_t FIRST) {
 	Chunk* chunk = _chunk();
 
-	while( offset < chunk->count ) {
-		if( chunk->code[offset] == OP_BREAK ) {
-			chunk->code[offset] = OP_JUMP;
-			_patchJump(offset + 1);
-		} else {
-			++offset;
-		}
+	for( uint16_t i = FIRST; i < loopBreakCount; i++ ) {
+		chunk->code[loopBreaks[i] - 1] = OP_JUMP;
+		_patchJump(loopBreaks[i]);
 	}
+
+	loopBreakCount = FIRST;
 }
 
 static void _whileStatement(void) {
 	/* Variáveis necessárias pro 'continue' e 'saia' */
 	int16_t topLoopStart = innerLoopStart;
 	int16_t topLoopScope = innerLoopScope;
+	uint16_t topLoopBreak = loopBreakCount;
 	innerLoopStart = _chunk()->count;
 	innerLoopScope = current->scope;
+	_markLabel();
 
 	_consume(TOKEN_LPAREN, "Esperava '(' depois do 'while'");
 	_expression();
@@ -997,7 +1715,7 @@ static void _whileStatement(void) {
 	_patchJump(loopEnd);
 	_emitPop();
 
-	_fixUpBreaks();
+	_fixUpBreaks(topLoopBreak);
 
 	innerLoopStart = topLoopStart;
 	innerLoopScope = topLoopScope;
@@ -1018,8 +1736,10 @@ static void _forStatement(void) {
 	/* Variáveis necessárias pro 'continue' e 'saia' */
 	int16_t topLoopStart = innerLoopStart;
 	int16_t topLoopScope = innerLoopScope;
+	uint16_t topLoopBreak = loopBreakCount;
 	innerLoopStart = _chunk()->count;
 	innerLoopScope = current->scope;
+	_markLabel();
 
 	int32_t loopEnd = -1;
 	if( !_match(TOKEN_SEMICOLON) ) {
@@ -1033,9 +1753,12 @@ static void _forStatement(void) {
 	if( !_match(TOKEN_RPAREN) ) {
 		const int32_t BODY_JUMP = _emitJump(OP_JUMP);
 		const int32_t INCREMENT = _chunk()->count;
+		_markLabel();
 
 		_expression();
-		_emitByte(OP_POP);
+		if( !_fuseStore() ) {
+			_emitByte(OP_POP);
+		}
 		_consume(TOKEN_RPAREN, "Esperava ')' depois das clausulas.");
 
 		_emitLoop(innerLoopStart);
@@ -1049,9 +1772,10 @@ static void _forStatement(void) {
 	if( loopEnd != -1 ) {
 		_patchJump(loopEnd);
 		_emitByte(OP_POP); /* Condicao */
-		_fixUpBreaks();
 	}
 
+	_fixUpBreaks(topLoopBreak);
+
 	innerLoopStart = topLoopStart;
 	innerLoopScope = topLoopScope;
 
@@ -1074,7 +1798,11 @@ static void _breakStatement(void) {
 
 	_discardLocals();
 
-	_emitJump(OP_BREAK);
+	if( loopBreakCount == UINT8_COUNT ) {
+		_errorAtPrev("Muitos 'saia' no mesmo loop");
+		return;
+	}
+	loopBreaks[loopBreakCount++] = _emitJump(OP_BREAK);
 }
 
 static void _continueStatement(void) {
@@ -1237,13 +1965,13 @@ static void _literal(const bool CAN_ASSIGN) {
 
 	switch( parser.previous.type ) {
 		case TOKEN_TRUE:
-			_emitByte(OP_TRUE);
+			_emitValue(CREATE_BOOL(true));
 			break;
 		case TOKEN_FALSE:
-			_emitByte(OP_FALSE);
+			_emitValue(CREATE_BOOL(false));
 			break;
 		case TOKEN_NIL:
-			_emitByte(OP_NIL);
+			_emitValue(CREATE_NIL());
 			break;
 		default:
 			return;
@@ -1329,10 +2057,10 @@ static void _unary(const bool CAN_ASSIGN) {
 	/* ...e processamos o operador! */
 	switch( OP_TYPE ) {
 		case TOKEN_MINUS:
-			_emitByte(OP_NEGATE);
+			_emitUnary(OP_NEGATE);
 			return;
 		case TOKEN_BANG:
-			_emitByte(OP_NOT);
+			_emitUnary(OP_NOT);
 			return;
 		default:
 			return;
@@ -1353,37 +2081,38 @@ static void _binary(const bool CAN_ASSIGN) {
 
 	switch( OP_TYPE ) {
 		case TOKEN_PLUS:
-			_emitByte(OP_ADD);
+			_emitBinary(OP_ADD);
 			break;
 		case TOKEN_MINUS:
-			_emitByte(OP_SUB);
+			_emitBinary(OP_SUB);
 			break;
 		case TOKEN_STAR:
-			_emitByte(OP_MUL);
+			_emitBinary(OP_MUL);
 			break;
 		case TOKEN_SLASH:
-			_emitByte(OP_DIV);
+			_emitBinary(OP_DIV);
 			break;
 		case TOKEN_PERCENT:
-			_emitByte(OP_MOD);
+			_emitBinary(OP_MOD);
 			break;
 		case TOKEN_BANG_EQUAL:
-			_emitBytes(OP_EQUAL, OP_NOT);
+			_emitBinary(OP_EQUAL);
+			_emitUnary(OP_NOT);
 			break;
 		case TOKEN_EQUAL_EQUAL:
-			_emitByte(OP_EQUAL);
+			_emitBinary(OP_EQUAL);
 			break;
 		case TOKEN_GREATER:
-			_emitByte(OP_GREATER);
+			_emitBinary(OP_GREATER);
 			break;
 		case TOKEN_GREATER_EQUAL:
-			_emitByte(OP_GREATER_EQUAL);
+			_emitBinary(OP_GREATER_EQUAL);
 			break;
 		case TOKEN_LESS:
-			_emitByte(OP_LESS);
+			_emitBinary(OP_LESS);
 			break;
 		case TOKEN_LESS_EQUAL:
-			_emitByte(OP_LESS_EQUAL);
+			_emitBinary(OP_LESS_EQUAL);
 			break;
 		default:
 			return;
@@ -1407,12 +2136,15 @@ static void _dot(const bool CAN_ASSIGN) {
 	if( CAN_ASSIGN && _match(TOKEN_EQUAL) ) {
 		_expression();
 		_emitConstantWithOp(OP_SET_PROPERTY_16, OP_SET_PROPERTY_32, NAME);
+		_emitCache();
 	} else if( _match(TOKEN_LPAREN) ) {
 		const uint8_t ARG_COUNT = _argumentList();
 		_emitConstantWithOp(OP_INVOKE_16, OP_INVOKE_32, NAME);
 		_emitByte(ARG_COUNT);
+		_emitCache();
 	} else {
 		_emitConstantWithOp(OP_GET_PROPERTY_16, OP_GET_PROPERTY_32, NAME);
+		_emitCache();
 	}
 }
 
@@ -1597,6 +2329,8 @@ ObjFunction* compCompile(const char* SOURCE) {
 	parser.hadError = parser.panicked = false;
 
 	stackMax = 1; /* Local reservada */
+	loopBreakCount = 0;
+	tableInit(&constGlobals);
 
 	nativeInit();
 
@@ -1606,6 +2340,8 @@ ObjFunction* compCompile(const char* SOURCE) {
 	}
 
 	ObjFunction* func = _end();
+	tableFree(&constGlobals);
+
 	if( parser.hadError ) {
 		return NULL;
 	}
@@ -1617,8 +2353,11 @@ void compMarkRoots(void) {
 	Compiler* compiler = current;
 
 	while( compiler != NULL ) {
-		printf("in compiler roots\n");
 		gcMarkObject((Obj*)compiler->function);
 		compiler = compiler->enclosing;
 	}
+
+	for( size_t i = 0; i < constGlobals.size; ++i ) {
+		gcMarkValue(constGlobals.entries[i].value);
+	}
 }
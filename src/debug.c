@@ -104,6 +104,52 @@ static size_t _closureOp(const char* NAME, Chunk* chunk, size_t offset,
 static size_t _invoke16Op(const char* NAME, Chunk* chunk, size_t offset);
 static size_t _invoke32Op(const char* NAME, Chunk* chunk, size_t offset);
 
+/**
+ * @brief Imprime uma operação com um índice 8- ou 24-bit no array de
+ * constantes, (opcionalmente) uma quantidade de argumentos e o índice 16-bit
+ * do seu cache em linha
+ *
+ * @param[in] NAME Nome da operação
+ * @param[in] chunk Ponteiro pra chunk
+ * @param[in] offset Índice no array de bytes
+ * @param[in] IS_24_BIT Se o índice da constante é 24-bit
+ * @param[in] HAS_ARGS Se a operação possui uma quantidade de argumentos
+ *
+ * @return O próximo índice
+ */
+static size_t _cachedOp(const char* NAME, Chunk* chunk, size_t offset,
+						const bool IS_24_BIT, const bool HAS_ARGS);
+
+/**
+ * @brief Imprime uma operação de registradores, cujos operandos são índices
+ * 8-bit de slots do frame e, opcionalmente, um último índice de constante
+ *
+ * @param[in] NAME Nome da operação
+ * @param[in] chunk Ponteiro pra chunk
+ * @param[in] offset Índice no array de bytes
+ * @param[in] COUNT Quantidade de operandos
+ * @param[in] LAST_IS_CONST Se o último operando é uma constante
+ *
+ * @return O próximo índice
+ */
+static size_t _registerOp(const char* NAME, Chunk* chunk, size_t offset,
+						  const int COUNT, const bool LAST_IS_CONST);
+
+/**
+ * @brief Imprime uma superinstrução e os operandos de cada instrução que ela
+ * junta
+ *
+ * @param[in] NAME Nome da operação
+ * @param[in] chunk Ponteiro pra chunk
+ * @param[in] offset Índice no array de bytes
+ * @param[in] OPS Instruções juntadas
+ * @param[in] COUNT Quantidade de instruções
+ *
+ * @return O próximo índice
+ */
+static size_t _superOp(const char* NAME, Chunk* chunk, size_t offset,
+					   const uint8_t* OPS, const int COUNT);
+
 void debugDisassembleChunk(Chunk* chunk, const char* NAME) {
 	printf("=== %s ===\n", NAME);
 
@@ -201,6 +247,8 @@ size_t debugDisassembleInstruction(Chunk* chunk, size_t offset) {
 			return _jumpOp("OP_JUMP", 1, chunk, offset);
 		case OP_JUMP_IF_FALSE:
 			return _jumpOp("OP_JUMP_IF_FALSE", 1, chunk, offset);
+		case OP_JUMP_IF_TRUE:
+			return _jumpOp("OP_JUMP_IF_TRUE", 1, chunk, offset);
 		case OP_LOOP:
 			return _jumpOp("OP_LOOP", -1, chunk, offset);
 		case OP_BREAK:
@@ -220,21 +268,21 @@ size_t debugDisassembleInstruction(Chunk* chunk, size_t offset) {
 		case OP_CLASS_32:
 			return _const32Op("OP_CLASS_32", chunk, offset);
 		case OP_SET_PROPERTY_16:
-			return _const16Op("OP_SET_PROPERTY_16", chunk, offset);
+			return _cachedOp("OP_SET_PROPERTY_16", chunk, offset, false, false);
 		case OP_SET_PROPERTY_32:
-			return _const32Op("OP_SET_PROPERTY_32", chunk, offset);
+			return _cachedOp("OP_SET_PROPERTY_32", chunk, offset, true, false);
 		case OP_GET_PROPERTY_16:
-			return _const16Op("OP_GET_PROPERTY_16", chunk, offset);
+			return _cachedOp("OP_GET_PROPERTY_16", chunk, offset, false, false);
 		case OP_GET_PROPERTY_32:
-			return _const32Op("OP_GET_PROPERTY_32", chunk, offset);
+			return _cachedOp("OP_GET_PROPERTY_32", chunk, offset, true, false);
 		case OP_METHOD_16:
 			return _const16Op("OP_METHOD_16", chunk, offset);
 		case OP_METHOD_32:
 			return _const32Op("OP_METHOD_32", chunk, offset);
 		case OP_INVOKE_16:
-			return _invoke16Op("OP_INVOKE_16", chunk, offset);
+			return _cachedOp("OP_INVOKE_16", chunk, offset, false, true);
 		case OP_INVOKE_32:
-			return _invoke32Op("OP_INVOKE_32", chunk, offset);
+			return _cachedOp("OP_INVOKE_32", chunk, offset, true, true);
 		case OP_INHERIT:
 			return _simpleOp("OP_INHERIT", offset);
 		case OP_GET_SUPER_16:
@@ -257,8 +305,99 @@ size_t debugDisassembleInstruction(Chunk* chunk, size_t offset) {
 			return _simpleOp("OP_GET_SUBSCRIPT", offset);
 		case OP_SET_SUBSCRIPT:
 			return _simpleOp("OP_SET_SUBSCRIPT", offset);
+		case OP_EQUAL_NUM:
+			return _simpleOp("OP_EQUAL_NUM", offset);
+		case OP_GREATER_NUM:
+			return _simpleOp("OP_GREATER_NUM", offset);
+		case OP_GREATER_EQUAL_NUM:
+			return _simpleOp("OP_GREATER_EQUAL_NUM", offset);
+		case OP_LESS_NUM:
+			return _simpleOp("OP_LESS_NUM", offset);
+		case OP_LESS_EQUAL_NUM:
+			return _simpleOp("OP_LESS_EQUAL_NUM", offset);
+		case OP_ADD_NUM:
+			return _simpleOp("OP_ADD_NUM", offset);
+		case OP_SUB_NUM:
+			return _simpleOp("OP_SUB_NUM", offset);
+		case OP_MUL_NUM:
+			return _simpleOp("OP_MUL_NUM", offset);
+		case OP_DIV_NUM:
+			return _simpleOp("OP_DIV_NUM", offset);
+		case OP_MOD_NUM:
+			return _simpleOp("OP_MOD_NUM", offset);
+		case OP_NEGATE_NUM:
+			return _simpleOp("OP_NEGATE_NUM", offset);
+		case OP_ADD_RR:
+			return _registerOp("OP_ADD_RR", chunk, offset, 2, false);
+		case OP_SUB_RR:
+			return _registerOp("OP_SUB_RR", chunk, offset, 2, false);
+		case OP_MUL_RR:
+			return _registerOp("OP_MUL_RR", chunk, offset, 2, false);
+		case OP_DIV_RR:
+			return _registerOp("OP_DIV_RR", chunk, offset, 2, false);
+		case OP_MOD_RR:
+			return _registerOp("OP_MOD_RR", chunk, offset, 2, false);
+		case OP_EQUAL_RR:
+			return _registerOp("OP_EQUAL_RR", chunk, offset, 2, false);
+		case OP_GREATER_RR:
+			return _registerOp("OP_GREATER_RR", chunk, offset, 2, false);
+		case OP_GREATER_EQUAL_RR:
+			return _registerOp("OP_GREATER_EQUAL_RR", chunk, offset, 2, false);
+		case OP_LESS_RR:
+			return _registerOp("OP_LESS_RR", chunk, offset, 2, false);
+		case OP_LESS_EQUAL_RR:
+			return _registerOp("OP_LESS_EQUAL_RR", chunk, offset, 2, false);
+		case OP_ADD_RK:
+			return _registerOp("OP_ADD_RK", chunk, offset, 2, true);
+		case OP_SUB_RK:
+			return _registerOp("OP_SUB_RK", chunk, offset, 2, true);
+		case OP_MUL_RK:
+			return _registerOp("OP_MUL_RK", chunk, offset, 2, true);
+		case OP_DIV_RK:
+			return _registerOp("OP_DIV_RK", chunk, offset, 2, true);
+		case OP_MOD_RK:
+			return _registerOp("OP_MOD_RK", chunk, offset, 2, true);
+		case OP_EQUAL_RK:
+			return _registerOp("OP_EQUAL_RK", chunk, offset, 2, true);
+		case OP_GREATER_RK:
+			return _registerOp("OP_GREATER_RK", chunk, offset, 2, true);
+		case OP_GREATER_EQUAL_RK:
+			return _registerOp("OP_GREATER_EQUAL_RK", chunk, offset, 2, true);
+		case OP_LESS_RK:
+			return _registerOp("OP_LESS_RK", chunk, offset, 2, true);
+		case OP_LESS_EQUAL_RK:
+			return _registerOp("OP_LESS_EQUAL_RK", chunk, offset, 2, true);
+		case OP_ADD_RRR:
+			return _registerOp("OP_ADD_RRR", chunk, offset, 3, false);
+		case OP_SUB_RRR:
+			return _registerOp("OP_SUB_RRR", chunk, offset, 3, false);
+		case OP_MUL_RRR:
+			return _registerOp("OP_MUL_RRR", chunk, offset, 3, false);
+		case OP_DIV_RRR:
+			return _registerOp("OP_DIV_RRR", chunk, offset, 3, false);
+		case OP_MOD_RRR:
+			return _registerOp("OP_MOD_RRR", chunk, offset, 3, false);
+		case OP_ADD_RRK:
+			return _registerOp("OP_ADD_RRK", chunk, offset, 3, true);
+		case OP_SUB_RRK:
+			return _registerOp("OP_SUB_RRK", chunk, offset, 3, true);
+		case OP_MUL_RRK:
+			return _registerOp("OP_MUL_RRK", chunk, offset, 3, true);
+		case OP_DIV_RRK:
+			return _registerOp("OP_DIV_RRK", chunk, offset, 3, true);
+		case OP_MOD_RRK:
+			return _registerOp("OP_MOD_RRK", chunk, offset, 3, true);
 		case OP_RETURN:
 			return _simpleOp("OP_RETURN", offset);
+
+#define SUPER_DISASSEMBLE(NAME, LENGTH, COUNT, ...)        \
+	case NAME: {                                           \
+		static const uint8_t OPS[] = {__VA_ARGS__};        \
+		return _superOp(#NAME, chunk, offset, OPS, COUNT); \
+	}
+			SUPERINSTRUCTIONS(SUPER_DISASSEMBLE)
+#undef SUPER_DISASSEMBLE
+
 		default:
 			errWarn(LINE, "Instrucao desconhecida '%02x'", OP);
 			return offset + 1;
@@ -407,3 +546,92 @@ static size_t _invoke32Op(const char* NAME, Chunk* chunk, size_t offset) {
 
 	return offset + 1;
 }
+
+static size_t _cachedOp(const char* NAME, Chunk* chunk, size_t offset,
+						const bool IS_24_BIT, const bool HAS_ARGS) {
+	size_t constant = chunk->code[++offset];
+	if( IS_24_BIT ) {
+		constant |= chunk->code[++offset] << 8;
+		constant |= chunk->code[++offset] << 16;
+	}
+
+	printf("%-20s %4zu '", NAME, constant);
+	valuePrint(chunk->consts.values[constant]);
+	printf("'");
+
+	if( HAS_ARGS ) {
+		printf(" (%u argumentos)", chunk->code[++offset]);
+	}
+
+	uint16_t cache = (uint16_t)(chunk->code[++offset] << 8);
+	cache |= chunk->code[++offset];
+	printf(" [cache %u]\n", cache);
+
+	return offset + 1;
+}
+
+static size_t _registerOp(const char* NAME, Chunk* chunk, size_t offset,
+						  const int COUNT, const bool LAST_IS_CONST) {
+	printf("%-20s", NAME);
+
+	for( int i = 0; i < COUNT; i++ ) {
+		const uint8_t OPERAND = chunk->code[++offset];
+
+		if( LAST_IS_CONST && i == COUNT - 1 ) {
+			printf(" K%d '", OPERAND);
+			valuePrint(chunk->consts.values[OPERAND]);
+			printf("'");
+		} else {
+			printf(" R%d", OPERAND);
+		}
+	}
+	printf("\n");
+
+	return offset + 1;
+}
+
+static size_t _superOp(const char* NAME, Chunk* chunk, size_t offset,
+					   const uint8_t* OPS, const int COUNT) {
+	printf("%-20s", NAME);
+
+	for( int i = 0; i < COUNT; i++ ) {
+		switch( OPS[i] ) {
+			case OP_CONST_16: {
+				const uint8_t CONST = chunk->code[++offset];
+				printf(" K%d '", CONST);
+				valuePrint(chunk->consts.values[CONST]);
+				printf("'");
+			} break;
+
+			case OP_GET_LOCAL_16:
+			case OP_SET_LOCAL_16:
+				printf(" R%d", chunk->code[++offset]);
+				break;
+
+			case OP_GET_GLOBAL_16:
+			case OP_SET_GLOBAL_16:
+				printf(" G%d", chunk->code[++offset]);
+				break;
+
+			case OP_GET_UPVALUE_16:
+				printf(" U%d", chunk->code[++offset]);
+				break;
+
+			case OP_JUMP:
+			case OP_JUMP_IF_FALSE:
+			case OP_JUMP_IF_TRUE:
+			case OP_LOOP: {
+				uint16_t jump = (uint16_t)(chunk->code[++offset] << 8);
+				jump |= chunk->code[++offset];
+				const int SIGN = OPS[i] == OP_LOOP ? -1 : 1;
+				printf(" -> %d", (int)offset + 1 + SIGN * jump);
+			} break;
+
+			default:
+				break;
+		}
+	}
+	printf("\n");
+
+	return offset + 1;
+}
@@ -4,14 +4,63 @@
  * @date 2024.04.13
  *
  * @brief Coletor de lixo
+ *
+ * No modo geracional (GC_GENERATIONAL), a maioria das coletas é menor: só
+ * os objetos alocados desde a última coleta (a geração nova, que fica no
+ * começo de vm.objects) são varridos. Os sobreviventes mantêm a marca e
+ * passam a ser velhos, e a marcação para em qualquer objeto velho. Objetos
+ * velhos que receberam objetos novos depois da promoção são guardados pela
+ * barreira de escrita (gcBarrier) e tratados como raízes
+ *
+ * No modo incremental (GC_INCREMENTAL), um ciclo é dividido em passos
+ * pequenos, intercalados com as alocações: a marcação esvazia a pilha cinza
+ * aos poucos, e a varredura libera a lista de objetos aos poucos. Durante a
+ * marcação, a barreira de escrita pinta de cinza todo objeto branco
+ * guardado em um objeto já marcado (invariante tricolor forte). A pilha e as
+ * globais não têm barreira, então são marcadas de novo antes da varredura
+ *
+ * No modo concorrente (GC_CONCURRENT), as raízes são marcadas na thread
+ * principal, e o resto da marcação roda em uma thread separada enquanto o
+ * programa continua. A marcação segue a foto do heap no começo do ciclo
+ * (snapshot-at-the-beginning): antes de modificar um objeto que ainda não
+ * foi percorrido, a thread principal o percorre (gcPreBarrier), então os
+ * valores antigos são marcados e a outra thread nunca lê um objeto sendo
+ * modificado. Objetos novos já nascem pretos. A varredura é a mesma do modo
+ * incremental
+ *
+ * No modo paralelo (GC_PARALLEL), a pilha cinza é esvaziada por várias
+ * threads ao mesmo tempo. Cada thread tem a sua fila de objetos cinzas, e
+ * uma thread sem trabalho rouba objetos do começo da fila das outras. As
+ * marcas são trocadas atomicamente, então cada objeto é escurecido uma vez
+ *
+ * Com a varredura preguiçosa (GC_LAZY_SWEEP), a pausa só marca: a lista de
+ * objetos vai inteira para vm.sweepObjects, e cada alocação varre alguns
+ * objetos dela antes (gcSweep), liberando os mortos e devolvendo os vivos a
+ * vm.objects. O significado de isMarked inverte a cada ciclo (GC_MARK_COLOR),
+ * então os sobreviventes não são escritos pela varredura
+ *
+ * Com a compactação (GC_COMPACT), quando as slabs ficam vazias demais
+ * depois de uma coleta, os objetos vivos são copiados em ordem para slabs
+ * novas, e as antigas são devolvidas. Como funções em C guardam ponteiros
+ * para objetos, isso só acontece em um ponto seguro da VM (gcCompact)
  */
 
 #include "gc.h"
 
 #include <stdlib.h>
 
+#if defined(GC_CONCURRENT) || defined(GC_PARALLEL)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifdef GC_PARALLEL
+#include <unistd.h>
+#endif
+
 #include "compiler.h"
 #include "error.h"
+#include "jit.h"
 #include "memory.h"
 #include "table.h"
 #include "vm.h"
@@ -25,6 +74,150 @@
 #include "debug.h"
 #endif
 
+#ifdef GC_CONCURRENT
+/** Thread de marcação do ciclo atual */
+static pthread_t _marker;
+
+/** Se @a _marker foi criada e ainda não foi esperada */
+static bool _hasMarker = false;
+
+/** Se a thread de marcação esvaziou a pilha cinza */
+static bool _markDone = false;
+
+/** Trava da pilha cinza e das marcas, durante a marcação concorrente */
+static pthread_mutex_t _markLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Quantidade de vezes que a thread principal está esperando a trava */
+static int _waiting = 0;
+#endif
+
+#ifdef GC_PARALLEL
+/** Heaps menores que isso são marcados por uma thread só */
+#define GC_PARALLEL_MIN_BYTES (4 * 1024 * 1024)
+
+/**
+ * @brief Fila de objetos cinzas de uma thread de marcação
+ *
+ * A thread dona empurra e tira objetos do fim da fila. As outras roubam do
+ * começo
+ */
+typedef struct {
+	pthread_mutex_t lock; /**< Trava da fila */
+	size_t head;		  /**< Primeiro objeto da fila */
+	size_t count;		  /**< Fim da fila */
+	size_t size;		  /**< Tamanho de @a objects */
+	Obj **objects;		  /**< Objetos cinzas */
+} GrayDeque;
+
+/** Quantidade de threads que marcam (incluindo a principal) */
+static size_t _threadCount = 0;
+
+/** Filas de cada thread (a da principal é a primeira) */
+static GrayDeque *_deques = NULL;
+
+/** Threads de marcação auxiliares */
+static pthread_t *_workers = NULL;
+
+/** Trava das variáveis de controle das threads auxiliares */
+static pthread_mutex_t _poolLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Sinaliza que uma marcação começou (ou que as threads devem parar) */
+static pthread_cond_t _poolStart = PTHREAD_COND_INITIALIZER;
+
+/** Sinaliza que a última thread auxiliar terminou a marcação */
+static pthread_cond_t _poolDone = PTHREAD_COND_INITIALIZER;
+
+/** Número da marcação atual, para as threads saberem quando começar */
+static uint32_t _generation = 0;
+
+/** Threads auxiliares que ainda não terminaram a marcação atual */
+static size_t _running = 0;
+
+/** Se as threads auxiliares devem parar */
+static bool _stopping = false;
+
+/** Threads sem trabalho na marcação atual */
+static size_t _idle = 0;
+
+/** Fila da thread atual, ou NULL fora da marcação paralela */
+static _Thread_local GrayDeque *_localDeque = NULL;
+
+/**
+ * @brief Empurra um objeto para o fim de uma fila
+ */
+static void _dequePush(GrayDeque *deque, Obj *object) {
+	pthread_mutex_lock(&deque->lock);
+
+	if( deque->size < deque->count + 1 ) {
+		deque->size = MEM_GROW_SIZE(deque->size);
+		deque->objects =
+			(Obj **)realloc(deque->objects, sizeof(Obj *) * deque->size);
+
+		if( deque->objects == NULL ) {
+			errFatal(0,
+					 "Sem memoria o bastante para alocar a pilha de objetos");
+			exit(1);
+		}
+	}
+
+	deque->objects[deque->count++] = object;
+	pthread_mutex_unlock(&deque->lock);
+}
+
+/**
+ * @brief Tira um objeto da fila
+ *
+ * @param[out] deque Fila
+ * @param[in] STEAL Se o objeto é roubado do começo da fila (em vez de tirado
+ * do fim, pela dona)
+ *
+ * @return O objeto, ou NULL se a fila estava vazia
+ */
+static Obj *_dequeTake(GrayDeque *deque, const bool STEAL) {
+	Obj *object = NULL;
+	pthread_mutex_lock(&deque->lock);
+
+	if( deque->head < deque->count ) {
+		object = STEAL ? deque->objects[deque->head++]
+					   : deque->objects[--deque->count];
+
+		if( deque->head == deque->count ) {
+			deque->head = 0;
+			deque->count = 0;
+		}
+	}
+
+	pthread_mutex_unlock(&deque->lock);
+	return object;
+}
+#endif
+
+/**
+ * @brief Empurra um objeto (já marcado) para a pilha cinza
+ */
+static void _pushGray(Obj *object) {
+#ifdef GC_PARALLEL
+	if( _localDeque != NULL ) {
+		_dequePush(_localDeque, object);
+		return;
+	}
+#endif
+
+	if( vm.graySize < vm.grayCount + 1 ) {
+		vm.graySize = MEM_GROW_SIZE(vm.graySize);
+		vm.grayStack =
+			(Obj **)realloc(vm.grayStack, sizeof(Obj *) * vm.graySize);
+
+		if( vm.grayStack == NULL ) {
+			errFatal(0,
+					 "Sem memoria o bastante para alocar a pilha de objetos");
+			exit(1);
+		}
+	}
+
+	vm.grayStack[vm.grayCount++] = object;
+}
+
 static void _markTable(Table *table) {
 	for( size_t i = 0; i < table->size; ++i ) {
 		Entry *entry = &table->entries[i];
@@ -36,6 +229,10 @@ static void _markTable(Table *table) {
 }
 
 static void _markArray(ValueArray *array) {
+	if( !array->hasObjects ) {
+		return;
+	}
+
 	for( size_t i = 0; i < array->count; ++i ) {
 		gcMarkValue(array->values[i]);
 	}
@@ -66,9 +263,21 @@ static void _markRoots(void) {
 
 	/* Marcamos os valores no compilador */
 	compMarkRoots();
+
+#ifdef JIT
+	/* E os objetos do trace sendo gravado */
+	jitMarkRoots();
+#endif
 }
 
 static void _blackenObject(Obj *object) {
+#ifdef GC_CONCURRENT
+	/* A outra thread pode ter percorrido o objeto enquanto ele era cinza */
+	if( object->isScanned ) {
+		return;
+	}
+#endif
+
 #ifdef DEBUG_LOG_GC
 	printf("%p | Escureceu objeto ", (void *)object);
 	valuePrint(CREATE_OBJECT(object));
@@ -84,6 +293,24 @@ static void _blackenObject(Obj *object) {
 			ObjFunction *function = (ObjFunction *)object;
 			gcMarkObject((Obj *)function->name);
 			_markArray(&function->chunk.consts);
+
+			for( size_t i = 0; i < function->chunk.cacheCount; ++i ) {
+				InlineCache *cache = &function->chunk.caches[i];
+				for( uint8_t j = 0; j < cache->count; ++j ) {
+					gcMarkObject((Obj *)cache->entries[j].shape);
+					gcMarkValue(cache->entries[j].value);
+				}
+			}
+
+#ifdef JIT
+			/* Os traces embutem ponteiros para closures e formas */
+			for( JitTrace *trace = function->traces; trace != NULL;
+				 trace = trace->next ) {
+				for( size_t i = 0; i < trace->objectCount; ++i ) {
+					gcMarkObject(trace->objects[i]);
+				}
+			}
+#endif
 		} break;
 
 		case OBJ_CLOSURE: {
@@ -99,13 +326,23 @@ static void _blackenObject(Obj *object) {
 			ObjClass *klass = (ObjClass *)object;
 			gcMarkObject((Obj *)klass->name);
 			_markTable(&klass->methods);
+			gcMarkObject((Obj *)klass->shape);
 			break;
 		}
 
 		case OBJ_INSTANCE: {
 			ObjInstance *instance = (ObjInstance *)object;
 			gcMarkObject((Obj *)instance->klass);
-			_markTable(&instance->fields);
+
+			if( instance->shape == NULL ) {
+				_markTable(instance->fields);
+				break;
+			}
+
+			gcMarkObject((Obj *)instance->shape);
+			for( uint32_t i = 0; i < instance->shape->slotCount; ++i ) {
+				gcMarkValue(instance->slots[i]);
+			}
 		} break;
 
 		case OBJ_BOUND_METHOD: {
@@ -130,34 +367,294 @@ static void _blackenObject(Obj *object) {
 			_markTable(&table->table);
 		} break;
 
+		case OBJ_SHAPE: {
+			ObjShape *shape = (ObjShape *)object;
+			_markTable(&shape->slots);
+			_markTable(&shape->transitions);
+		} break;
+
 		case OBJ_NATIVE:
 		case OBJ_STRING:
 			/* Não possuem referências a outros objetos. Ignoramos */
 			break;
 	}
+
+#ifdef GC_CONCURRENT
+	/* Depois disso, a thread principal pode modificar o objeto sem travar */
+	__atomic_store_n(&object->isScanned, true, __ATOMIC_RELEASE);
+#endif
+}
+
+#ifdef GC_PARALLEL
+/**
+ * @brief Rouba um objeto da fila de outra thread
+ *
+ * @param[in] ID Índice da thread que está roubando
+ *
+ * @return O objeto, ou NULL se todas as filas estavam vazias
+ */
+static Obj *_steal(const size_t ID) {
+	for( size_t i = 1; i < _threadCount; ++i ) {
+		Obj *object = _dequeTake(&_deques[(ID + i) % _threadCount], true);
+		if( object != NULL ) {
+			return object;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Se alguma fila tem objetos para roubar
+ */
+static bool _hasWork(void) {
+	for( size_t i = 0; i < _threadCount; ++i ) {
+		pthread_mutex_lock(&_deques[i].lock);
+		const bool HAS_WORK = _deques[i].head < _deques[i].count;
+		pthread_mutex_unlock(&_deques[i].lock);
+
+		if( HAS_WORK ) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @brief Esvazia as filas cinzas, junto com as outras threads
+ *
+ * Uma thread sem trabalho só para quando todas estão sem trabalho: como só
+ * a dona empurra objetos na própria fila, todas as filas estão vazias
+ *
+ * @param[in] ID Índice da thread (0 é a principal)
+ */
+static void _markShare(const size_t ID) {
+	_localDeque = &_deques[ID];
+
+	while( true ) {
+		Obj *object = _dequeTake(_localDeque, false);
+		if( object == NULL ) {
+			object = _steal(ID);
+		}
+
+		if( object != NULL ) {
+			_blackenObject(object);
+			continue;
+		}
+
+		__atomic_add_fetch(&_idle, 1, __ATOMIC_ACQ_REL);
+
+		bool found = false;
+		while( __atomic_load_n(&_idle, __ATOMIC_ACQUIRE) < _threadCount ) {
+			if( _hasWork() ) {
+				found = true;
+				break;
+			}
+
+			sched_yield();
+		}
+
+		if( !found ) {
+			break;
+		}
+
+		__atomic_sub_fetch(&_idle, 1, __ATOMIC_ACQ_REL);
+	}
+
+	_localDeque = NULL;
+}
+
+/**
+ * @brief Corpo das threads auxiliares: participa de cada marcação
+ */
+static void *_workerMain(void *arg) {
+	const size_t ID = (size_t)(uintptr_t)arg;
+	uint32_t generation = 0;
+
+	while( true ) {
+		pthread_mutex_lock(&_poolLock);
+		while( generation == _generation && !_stopping ) {
+			pthread_cond_wait(&_poolStart, &_poolLock);
+		}
+
+		if( _stopping ) {
+			pthread_mutex_unlock(&_poolLock);
+			return NULL;
+		}
+
+		generation = _generation;
+		pthread_mutex_unlock(&_poolLock);
+
+		_markShare(ID);
+
+		pthread_mutex_lock(&_poolLock);
+		if( --_running == 0 ) {
+			pthread_cond_signal(&_poolDone);
+		}
+		pthread_mutex_unlock(&_poolLock);
+	}
+}
+
+/**
+ * @brief Lê a quantidade de threads de marcação e cria as auxiliares
+ *
+ * A quantidade vem da variável de ambiente LOXIE_GC_THREADS, de
+ * GC_THREADS, ou da quantidade de processadores
+ */
+static void _startWorkers(void) {
+#ifdef GC_THREADS
+	long count = GC_THREADS;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+	const char *ENV = getenv("LOXIE_GC_THREADS");
+	if( ENV != NULL ) {
+		count = strtol(ENV, NULL, 10);
+	}
+
+	_threadCount = count > 1 ? (size_t)count : 1;
+	_deques = (GrayDeque *)calloc(_threadCount, sizeof(GrayDeque));
+	_workers = (pthread_t *)calloc(_threadCount, sizeof(pthread_t));
+
+	if( _deques == NULL || _workers == NULL ) {
+		errFatal(0, "Sem memoria o bastante para as threads de marcacao");
+		exit(1);
+	}
+
+	for( size_t i = 0; i < _threadCount; ++i ) {
+		pthread_mutex_init(&_deques[i].lock, NULL);
+	}
+
+	for( size_t i = 1; i < _threadCount; ++i ) {
+		if( pthread_create(&_workers[i], NULL, _workerMain,
+						   (void *)(uintptr_t)i) != 0 ) {
+			/* Ficamos com as threads que já foram criadas */
+			_threadCount = i;
+			break;
+		}
+	}
 }
 
+void gcStopWorkers(void) {
+	pthread_mutex_lock(&_poolLock);
+	_stopping = true;
+	pthread_cond_broadcast(&_poolStart);
+	pthread_mutex_unlock(&_poolLock);
+
+	for( size_t i = 1; i < _threadCount; ++i ) {
+		pthread_join(_workers[i], NULL);
+	}
+
+	for( size_t i = 0; i < _threadCount; ++i ) {
+		pthread_mutex_destroy(&_deques[i].lock);
+		free(_deques[i].objects);
+	}
+
+	free(_deques);
+	free(_workers);
+	_deques = NULL;
+	_workers = NULL;
+	_threadCount = 0;
+}
+
+/**
+ * @brief Esvazia a pilha cinza com todas as threads de marcação
+ */
+static void _traceParallel(void) {
+	/* Divide os objetos cinzas entre as filas */
+	for( size_t i = 0; vm.grayCount > 0; ++i ) {
+		_dequePush(&_deques[i % _threadCount], vm.grayStack[--vm.grayCount]);
+	}
+
+	pthread_mutex_lock(&_poolLock);
+	_idle = 0;
+	_running = _threadCount - 1;
+	++_generation;
+	pthread_cond_broadcast(&_poolStart);
+	pthread_mutex_unlock(&_poolLock);
+
+	_markShare(0);
+
+	pthread_mutex_lock(&_poolLock);
+	while( _running > 0 ) {
+		pthread_cond_wait(&_poolDone, &_poolLock);
+	}
+	pthread_mutex_unlock(&_poolLock);
+}
+#endif
+
 static void _traceRefs(void) {
+#ifdef GC_PARALLEL
+	if( _threadCount == 0 && !_stopping ) {
+		_startWorkers();
+	}
+
+	if( _threadCount > 1 && vm.bytesAllocated >= GC_PARALLEL_MIN_BYTES ) {
+		_traceParallel();
+		return;
+	}
+#endif
+
 	while( vm.grayCount > 0 ) {
 		Obj *object = vm.grayStack[--vm.grayCount];
 		_blackenObject(object);
 	}
 }
 
-static void _sweep(void) {
+#ifdef GC_LAZY_SWEEP
+/**
+ * @brief Varre objetos pendentes até liberar @a bytes bytes ou varrer
+ * @a budget objetos
+ */
+static void _sweepLazy(const size_t BYTES, size_t budget) {
+	const size_t BEFORE = vm.bytesAllocated;
+
+	while( budget > 0 && vm.sweepObjects != NULL &&
+		   BEFORE - vm.bytesAllocated < BYTES ) {
+		Obj *object = vm.sweepObjects;
+		vm.sweepObjects = OBJ_NEXT(object);
+
+		if( GC_IS_MARKED(object) ) {
+			OBJ_SET_NEXT(object, vm.objects);
+			vm.objects = object;
+		} else {
+			memFreeObject(object);
+		}
+
+		--budget;
+	}
+
+	if( vm.sweepObjects == NULL ) {
+		vm.nextGC = vm.bytesAllocated * GC_HEAP_GROW_FACTOR;
+	}
+}
+
+void gcSweep(size_t bytes) {
+	_sweepLazy(bytes, GC_SWEEP_BUDGET);
+}
+#elif !defined(GC_PHASES)
+/**
+ * @brief Libera os objetos não marcados de @a vm.objects até @a end
+ *
+ * @param[in] end Primeiro objeto que não será varrido (NULL para todos)
+ * @param[in] KEEP_MARKS Se a marca dos sobreviventes é mantida
+ */
+static void _sweep(Obj *end, const bool KEEP_MARKS) {
 	Obj *previous = NULL;
 	Obj *object = vm.objects;
 
-	while( object != NULL ) {
+	while( object != end ) {
 		if( object->isMarked ) {
-			object->isMarked = false;
+			object->isMarked = KEEP_MARKS;
 			previous = object;
-			object = object->next;
+			object = OBJ_NEXT(object);
 		} else {
 			Obj *unreached = object;
-			object = object->next;
+			object = OBJ_NEXT(object);
 			if( previous != NULL ) {
-				previous->next = object;
+				OBJ_SET_NEXT(previous, object);
 			} else {
 				vm.objects = object;
 			}
@@ -166,6 +663,494 @@ static void _sweep(void) {
 		}
 	}
 }
+#endif
+
+#ifdef GC_GENERATIONAL
+/**
+ * @brief Marca os filhos dos objetos lembrados e esvazia o conjunto
+ */
+static void _markRemembered(void) {
+	for( size_t i = 0; i < vm.rememberedCount; ++i ) {
+		Obj *object = vm.remembered[i];
+		object->isRemembered = false;
+		_blackenObject(object);
+	}
+
+	vm.rememberedCount = 0;
+}
+
+/**
+ * @brief Apaga as marcas de todos os objetos, que passam a ser novos de novo
+ */
+static void _unmarkAll(void) {
+	for( size_t i = 0; i < vm.rememberedCount; ++i ) {
+		vm.remembered[i]->isRemembered = false;
+	}
+
+	vm.rememberedCount = 0;
+
+	for( Obj *object = vm.objects; object != NULL; object = OBJ_NEXT(object) ) {
+		object->isMarked = false;
+	}
+}
+
+/**
+ * @brief Coleta só a geração nova, promovendo os sobreviventes
+ */
+static void _collectMinor(void) {
+	_markRoots();
+	_markRemembered();
+	_traceRefs();
+	tableRemoveWhite(&vm.strings);
+	_sweep(vm.oldObjects, true);
+
+	vm.oldObjects = vm.objects;
+}
+
+/**
+ * @brief Coleta o heap inteiro
+ */
+static void _collectMajor(void) {
+	_unmarkAll();
+	_markRoots();
+	_traceRefs();
+	tableRemoveWhite(&vm.strings);
+	_sweep(NULL, true);
+
+	vm.oldObjects = vm.objects;
+	vm.nextMajorGC = vm.bytesAllocated * GC_HEAP_GROW_FACTOR;
+}
+#endif
+
+#ifdef GC_CONCURRENT
+/**
+ * @brief Corpo da thread de marcação: esvazia a pilha cinza
+ */
+static void *_markerMain(void *arg) {
+	INTENTIONALLY_UNUSED(arg);
+
+	pthread_mutex_lock(&_markLock);
+
+	while( vm.grayCount > 0 ) {
+		_blackenObject(vm.grayStack[--vm.grayCount]);
+
+		/* A thread principal quer percorrer um objeto antes de modificá-lo:
+		 * cedemos a trava para que ela não fique parada */
+		if( __atomic_load_n(&_waiting, __ATOMIC_ACQUIRE) > 0 ) {
+			pthread_mutex_unlock(&_markLock);
+			while( __atomic_load_n(&_waiting, __ATOMIC_ACQUIRE) > 0 ) {
+				sched_yield();
+			}
+			pthread_mutex_lock(&_markLock);
+		}
+	}
+
+	__atomic_store_n(&_markDone, true, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&_markLock);
+
+	return NULL;
+}
+
+void gcScanObject(Obj *object) {
+	__atomic_add_fetch(&_waiting, 1, __ATOMIC_ACQ_REL);
+	pthread_mutex_lock(&_markLock);
+	__atomic_sub_fetch(&_waiting, 1, __ATOMIC_ACQ_REL);
+
+	/* Um objeto branco ainda pode ser alcançável pela foto do começo do
+	 * ciclo. Na dúvida, ele sobrevive a este ciclo */
+	object->isMarked = true;
+	_blackenObject(object);
+
+	pthread_mutex_unlock(&_markLock);
+}
+
+void gcJoin(void) {
+	if( _hasMarker ) {
+		pthread_join(_marker, NULL);
+		_hasMarker = false;
+	}
+}
+#endif
+
+#ifdef GC_PHASES
+/**
+ * @brief Começa um ciclo, pintando as raízes de cinza
+ */
+static void _startCycle(void) {
+#ifdef DEBUG_LOG_GC
+	printf("-- gc ciclo incremental comecou\n");
+#endif
+
+	_markRoots();
+	vm.gcPhase = GC_PHASE_MARK;
+
+#ifdef GC_CONCURRENT
+	_markDone = false;
+	_hasMarker = (pthread_create(&_marker, NULL, _markerMain, NULL) == 0);
+
+	if( !_hasMarker ) {
+		/* Sem a thread, a marcação é feita aqui mesmo */
+		_markerMain(NULL);
+	}
+#endif
+}
+
+/**
+ * @brief Termina a marcação e separa a lista de objetos que será varrida
+ *
+ * Objetos alocados a partir daqui vão para uma lista nova, e não são
+ * varridos neste ciclo
+ */
+static void _finishMark(void) {
+#ifdef GC_CONCURRENT
+	/* A barreira manteve a foto das raízes marcadas no começo do ciclo. Só
+	 * falta o que a thread principal pintou de cinza depois que a outra
+	 * thread terminou */
+	gcJoin();
+	_traceRefs();
+#else
+	_markRoots();
+	_traceRefs();
+#endif
+	tableRemoveWhite(&vm.strings);
+
+	vm.sweepObjects = vm.objects;
+	vm.objects = NULL;
+	vm.gcPhase = GC_PHASE_SWEEP;
+}
+
+/**
+ * @brief Escurece até @a budget objetos da pilha cinza
+ *
+ * No modo concorrente, só verifica se a thread de marcação terminou
+ *
+ * @return O orçamento que sobrou
+ */
+static size_t _markStep(size_t budget) {
+#ifdef GC_CONCURRENT
+	if( __atomic_load_n(&_markDone, __ATOMIC_ACQUIRE) ) {
+		_finishMark();
+	}
+
+	return budget;
+#else
+	while( budget > 0 && vm.grayCount > 0 ) {
+		_blackenObject(vm.grayStack[--vm.grayCount]);
+		--budget;
+	}
+
+	if( vm.grayCount == 0 ) {
+		_finishMark();
+	}
+
+	return budget;
+#endif
+}
+
+/**
+ * @brief Varre até @a budget objetos, devolvendo os sobreviventes (já
+ * desmarcados) para @a vm.objects
+ */
+static void _sweepStep(size_t budget) {
+	while( budget > 0 && vm.sweepObjects != NULL ) {
+		Obj *object = vm.sweepObjects;
+		vm.sweepObjects = OBJ_NEXT(object);
+
+		if( object->isMarked ) {
+			object->isMarked = false;
+			object->isScanned = false;
+			OBJ_SET_NEXT(object, vm.objects);
+			vm.objects = object;
+		} else {
+			memFreeObject(object);
+		}
+
+		--budget;
+	}
+
+	if( vm.sweepObjects == NULL ) {
+		vm.gcPhase = GC_PHASE_IDLE;
+		vm.nextGC = vm.bytesAllocated * GC_HEAP_GROW_FACTOR;
+
+#ifdef DEBUG_LOG_GC
+		printf("-- gc ciclo incremental terminou, proximo em %zu\n",
+			   vm.nextGC);
+#endif
+	}
+}
+
+/**
+ * @brief Faz até @a budget unidades de trabalho do ciclo atual
+ */
+static void _step(size_t budget) {
+	if( vm.gcPhase == GC_PHASE_MARK ) {
+		budget = _markStep(budget);
+	}
+
+	if( vm.gcPhase == GC_PHASE_SWEEP ) {
+		_sweepStep(budget);
+	}
+}
+
+/**
+ * @brief Se o heap passou do limite e um ciclo novo deve começar
+ */
+static bool _shouldStart(void) {
+#ifdef DEBUG_STRESS_GC
+	return true;
+#else
+	return vm.bytesAllocated > vm.nextGC;
+#endif
+}
+
+void gcStep(void) {
+	if( vm.gcPhase == GC_PHASE_IDLE ) {
+#ifdef GC_CONCURRENT
+		/* Ciclos concorrentes só começam em gcStartCycle */
+		return;
+#else
+		if( !_shouldStart() ) {
+			return;
+		}
+
+		_startCycle();
+#endif
+	}
+
+	_step(GC_STEP_BUDGET);
+}
+#endif
+
+#ifdef GC_CONCURRENT
+void gcStartCycle(void) {
+	if( vm.gcPhase == GC_PHASE_IDLE && _shouldStart() ) {
+		_startCycle();
+	}
+}
+#endif
+
+#ifdef GC_COMPACT
+/**
+ * @brief Endereço atual de um objeto
+ *
+ * A cópia velha de um objeto movido fica marcada, com o endereço novo em
+ * @a next. Objetos que não foram movidos continuam desmarcados
+ */
+static Obj *_forward(Obj *object) {
+	if( object != NULL && object->isMarked ) {
+		return OBJ_NEXT(object);
+	}
+
+	return object;
+}
+
+/** Macro de conveniência para atualizar um ponteiro para objeto */
+#define FORWARD(PTR) ((PTR) = (void *)_forward((Obj *)(PTR)))
+
+static void _forwardValue(Value *value) {
+	if( IS_OBJECT(*value) ) {
+		*value = CREATE_OBJECT(_forward(AS_OBJECT(*value)));
+	}
+}
+
+static void _forwardTable(Table *table) {
+	for( size_t i = 0; i < table->size; ++i ) {
+		_forwardValue(&table->entries[i].key);
+		_forwardValue(&table->entries[i].value);
+	}
+}
+
+static void _forwardArray(ValueArray *array) {
+	if( !array->hasObjects ) {
+		return;
+	}
+
+	for( size_t i = 0; i < array->count; ++i ) {
+		_forwardValue(&array->values[i]);
+	}
+}
+
+/**
+ * @brief Atualiza as referências de um objeto para os endereços novos
+ */
+static void _forwardObject(Obj *object) {
+	switch( object->type ) {
+		case OBJ_UPVALUE: {
+			ObjUpvalue *upvalue = (ObjUpvalue *)object;
+			_forwardValue(&upvalue->closed);
+
+			/* Só os upvalues abertos estão na lista */
+			if( upvalue->location != &upvalue->closed ) {
+				FORWARD(upvalue->next);
+			}
+		} break;
+
+		case OBJ_FUNCTION: {
+			ObjFunction *function = (ObjFunction *)object;
+			FORWARD(function->name);
+			_forwardArray(&function->chunk.consts);
+
+			for( size_t i = 0; i < function->chunk.cacheCount; ++i ) {
+				InlineCache *cache = &function->chunk.caches[i];
+				for( uint8_t j = 0; j < cache->count; ++j ) {
+					FORWARD(cache->entries[j].shape);
+					_forwardValue(&cache->entries[j].value);
+				}
+			}
+
+#ifdef JIT
+			/* O código nativo embute endereços de objetos. Ele é jogado
+			 * fora, e a função é compilada de novo quando esquentar
+			 */
+			jitFree(function->jit);
+			function->jit = NULL;
+			jitFreeTraces(function->traces);
+			function->traces = NULL;
+#endif
+		} break;
+
+		case OBJ_CLOSURE: {
+			ObjClosure *closure = (ObjClosure *)object;
+			FORWARD(closure->function);
+
+			for( size_t i = 0; i < closure->upvalueCount; ++i ) {
+				FORWARD(closure->upvalues[i]);
+			}
+		} break;
+
+		case OBJ_CLASS: {
+			ObjClass *klass = (ObjClass *)object;
+			FORWARD(klass->name);
+			_forwardValue(&klass->constructor);
+			_forwardTable(&klass->methods);
+			FORWARD(klass->shape);
+		} break;
+
+		case OBJ_INSTANCE: {
+			ObjInstance *instance = (ObjInstance *)object;
+			FORWARD(instance->klass);
+
+			if( instance->shape == NULL ) {
+				_forwardTable(instance->fields);
+				break;
+			}
+
+			FORWARD(instance->shape);
+			for( uint32_t i = 0; i < instance->shape->slotCount; ++i ) {
+				_forwardValue(&instance->slots[i]);
+			}
+		} break;
+
+		case OBJ_BOUND_METHOD: {
+			ObjBoundMethod *bound = (ObjBoundMethod *)object;
+			_forwardValue(&bound->receiver);
+			FORWARD(bound->method);
+		} break;
+
+		case OBJ_RANGE: {
+			ObjRange *range = (ObjRange *)object;
+			_forwardValue(&range->start);
+			_forwardValue(&range->end);
+		} break;
+
+		case OBJ_ARRAY:
+			_forwardArray(&((ObjArray *)object)->array);
+			break;
+
+		case OBJ_TABLE:
+			_forwardTable(&((ObjTable *)object)->table);
+			break;
+
+		case OBJ_SHAPE: {
+			ObjShape *shape = (ObjShape *)object;
+			_forwardTable(&shape->slots);
+			_forwardTable(&shape->transitions);
+		} break;
+
+		case OBJ_NATIVE:
+		case OBJ_STRING:
+			break;
+	}
+}
+
+/**
+ * @brief Atualiza as raízes (e a tabela de strings) para os endereços novos
+ */
+static void _forwardRoots(void) {
+	for( Value *slot = vm.stack; slot < vm.stackTop; ++slot ) {
+		_forwardValue(slot);
+	}
+
+	for( int8_t i = 0; i < vm.frameCount; ++i ) {
+		FORWARD(vm.frames[i].closure);
+	}
+
+	FORWARD(vm.openUpvalues);
+
+	_forwardTable(&vm.globalNames);
+	_forwardArray(&vm.globalValues);
+	_forwardTable(&vm.strings);
+}
+
+void gcCompact(void) {
+#ifdef JIT
+	jitStopRecording();
+#endif
+
+	/* Depois da coleta, todos os objetos da lista estão vivos e
+	 * desmarcados
+	 */
+	gcCollect();
+	vm.compactPending = false;
+
+#ifdef DEBUG_LOG_GC
+	printf("-- gc compactando\n");
+#endif
+
+	/* Copia os objetos, na ordem da lista, para slabs novas */
+	memBeginEvacuation();
+
+	Obj *previous = NULL;
+	Obj *object = vm.objects;
+	while( object != NULL ) {
+		Obj *next = OBJ_NEXT(object);
+		Obj *copy = memEvacuate(object);
+
+		if( copy != object ) {
+			/* Um upvalue fechado aponta para dentro de si mesmo */
+			ObjUpvalue *upvalue = (ObjUpvalue *)copy;
+			if( object->type == OBJ_UPVALUE &&
+				upvalue->location == &((ObjUpvalue *)object)->closed ) {
+				upvalue->location = &upvalue->closed;
+			}
+
+			object->isMarked = true;
+			OBJ_SET_NEXT(object, copy);
+		}
+
+		if( previous != NULL ) {
+			OBJ_SET_NEXT(previous, copy);
+		} else {
+			vm.objects = copy;
+		}
+
+		previous = copy;
+		object = next;
+	}
+
+	if( previous != NULL ) {
+		OBJ_SET_NEXT(previous, NULL);
+	}
+
+	/* Com as cópias velhas ainda no lugar, atualiza todas as referências */
+	_forwardRoots();
+	for( object = vm.objects; object != NULL; object = OBJ_NEXT(object) ) {
+		_forwardObject(object);
+	}
+
+	memEndEvacuation();
+}
+#endif
 
 void gcCollect(void) {
 #ifdef DEBUG_LOG_GC
@@ -173,13 +1158,56 @@ void gcCollect(void) {
 	const size_t BEFORE = vm.bytesAllocated;
 #endif
 
+#ifdef GC_GENERATIONAL
+	if( vm.bytesAllocated > vm.nextMajorGC ) {
+		_collectMajor();
+	} else {
+		_collectMinor();
+	}
+
+	vm.nextGC = vm.bytesAllocated + GC_NURSERY_SIZE;
+#elif defined(GC_PHASES)
+	/* Termina o ciclo atual de uma vez (ou faz um ciclo inteiro) */
+	if( vm.gcPhase == GC_PHASE_IDLE ) {
+		_startCycle();
+	}
+
+#ifdef GC_CONCURRENT
+	if( vm.gcPhase == GC_PHASE_MARK ) {
+		_finishMark();
+	}
+#endif
+
+	while( vm.gcPhase != GC_PHASE_IDLE ) {
+		_step(SIZE_MAX);
+	}
+#elif defined(GC_LAZY_SWEEP)
+	/* O resto do ciclo anterior é varrido antes das marcas mudarem de cor */
+	_sweepLazy(SIZE_MAX, SIZE_MAX);
+	vm.markColor = !vm.markColor;
+
+	_markRoots();
+	_traceRefs();
+	tableRemoveWhite(&vm.strings);
+
+	vm.sweepObjects = vm.objects;
+	vm.objects = NULL;
+	vm.nextGC = vm.bytesAllocated * GC_HEAP_GROW_FACTOR;
+#else
 	_markRoots();
 	_traceRefs();
 	tableRemoveWhite(&vm.strings);
-	_sweep();
+	_sweep(NULL, false);
 
 	vm.nextGC = vm.bytesAllocated * GC_HEAP_GROW_FACTOR;
 
+#ifdef GC_COMPACT
+	if( memIsFragmented() ) {
+		vm.compactPending = true;
+	}
+#endif
+#endif
+
 #ifdef DEBUG_LOG_GC
 	printf("-- gc end\n");
 	printf("   Coletou %u bytes (de %u para %u), proxima em %u\n",
@@ -194,9 +1222,18 @@ void gcMarkValue(Value value) {
 }
 
 void gcMarkObject(Obj *object) {
-	if( object == NULL || object->isMarked == true ) {
+#ifdef GC_PARALLEL
+	/* Várias threads podem encontrar o mesmo objeto: só uma o marca */
+	if( object == NULL ||
+		__atomic_exchange_n(&object->isMarked, GC_MARK_COLOR,
+							__ATOMIC_RELAXED) == GC_MARK_COLOR ) {
 		return;
 	}
+#else
+	if( object == NULL || GC_IS_MARKED(object) ) {
+		return;
+	}
+#endif
 
 #ifdef DEBUG_LOG_GC
 	printf("%p | Marcou o objeto ", (void *)object);
@@ -204,19 +1241,41 @@ void gcMarkObject(Obj *object) {
 	printf("\n");
 #endif
 
-	object->isMarked = true;
+#ifndef GC_PARALLEL
+	object->isMarked = GC_MARK_COLOR;
+#endif
+	_pushGray(object);
+}
 
-	if( vm.graySize < vm.grayCount + 1 ) {
-		vm.graySize = MEM_GROW_SIZE(vm.graySize);
-		vm.grayStack =
-			(Obj **)realloc(vm.grayStack, sizeof(Obj *) * vm.graySize);
+#ifdef GC_GENERATIONAL
+void gcRemember(Obj *object) {
+	if( !object->isMarked || object->isRemembered ) {
+		return;
+	}
 
-		if( vm.grayStack == NULL ) {
-			errFatal(0,
-					 "Sem memoria o bastante para alocar a pilha de objetos");
+	object->isRemembered = true;
+
+	if( vm.rememberedSize < vm.rememberedCount + 1 ) {
+		vm.rememberedSize = MEM_GROW_SIZE(vm.rememberedSize);
+		vm.remembered =
+			(Obj **)realloc(vm.remembered, sizeof(Obj *) * vm.rememberedSize);
+
+		if( vm.remembered == NULL ) {
+			errFatal(0, "Sem memoria o bastante para alocar o conjunto de "
+						"objetos lembrados");
 			exit(1);
 		}
 	}
 
-	vm.grayStack[vm.grayCount++] = object;
+	vm.remembered[vm.rememberedCount++] = object;
 }
+#endif
+
+#ifdef GC_INCREMENTAL
+void gcRemember(Obj *object) {
+	/* Um objeto já escurecido volta a ser cinza e é escurecido de novo */
+	if( vm.gcPhase == GC_PHASE_MARK && object->isMarked ) {
+		_pushGray(object);
+	}
+}
+#endif
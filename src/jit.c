@@ -0,0 +1,1842 @@
+/**
+ * @file jit.c
+ * @author Pedro B.
+ * @date 2026.10.16
+ *
+ * @brief Compilador JIT de base, que traduz o bytecode de funções quentes
+ * para código nativo x86-64
+ *
+ * Registradores usados pelo código nativo (todos preservados entre chamadas
+ * pela convenção System V):
+ * - rbx: CallFrame atual;
+ * - r12: topo da pilha (vm.stackTop);
+ * - r13: slots do frame;
+ * - r14: endereço de vm.stackTop, para sincronizar o topo;
+ * - r15: array de constantes da função.
+ */
+
+#include "jit.h"
+
+#ifdef JIT
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "gc.h"
+#include "memory.h"
+#include "opcodes.h"
+#include "tier.h"
+#include "value.h"
+
+/** Registradores x86-64, na ordem da codificação */
+typedef enum {
+	RAX = 0,
+	RCX = 1,
+	RDX = 2,
+	RBX = 3,
+	RSI = 6,
+	RDI = 7,
+	R12 = 12,
+	R13 = 13,
+	R14 = 14,
+	R15 = 15,
+} Register;
+
+/** Tamanho de um Value na pilha */
+#define VALUE_SIZE ((int32_t)sizeof(Value))
+
+/** Deslocamento do payload (número, bool, objeto) dentro de um Value */
+#define VALUE_PAYLOAD ((int32_t)offsetof(Value, vNumber))
+
+/** Marca um offset do bytecode que não é o começo de uma instrução */
+#define NOT_AN_INSTRUCTION SIZE_MAX
+
+/**
+ * @brief Emite uma sequência de bytes
+ */
+#define EMIT(AS, ...)                       \
+	_emitBytes((AS), (const uint8_t[]){__VA_ARGS__}, \
+			   sizeof((const uint8_t[]){__VA_ARGS__}))
+
+/**
+ * @brief Struct representando um pulo que será corrigido no fim da
+ * compilação
+ */
+typedef struct JumpFixup {
+	size_t at;	   /**< Posição do deslocamento de 32 bits no código */
+	size_t target; /**< Offset do bytecode para onde o pulo vai */
+} JumpFixup;
+
+/**
+ * @brief Struct representando um operando em memória ([base + disp])
+ */
+typedef struct Operand {
+	Register base; /**< Registrador base */
+	int32_t disp;  /**< Deslocamento */
+} Operand;
+
+/**
+ * @brief Struct representando o estado do montador
+ */
+typedef struct Assembler {
+	size_t count;  /**< Ocupação atual do código */
+	size_t size;   /**< Tamanho do array de código */
+	uint8_t *code; /**< Código sendo montado */
+
+	size_t *labels; /**< Posição no código de cada offset do bytecode */
+
+	size_t fixupCount;	/**< Quantidade de pulos a serem corrigidos */
+	size_t fixupSize;	/**< Tamanho do array de pulos */
+	JumpFixup *fixups;	/**< Pulos a serem corrigidos */
+
+	size_t exit; /**< Posição da saída para o interpretador */
+} Assembler;
+
+/** Assinatura do código nativo de uma função */
+typedef uint8_t *(*JitFn)(CallFrame *frame, uint8_t *target);
+
+/** Ponteiro genérico para uma função em C chamada pelo código nativo */
+typedef void (*JitHelper)(void);
+
+static void _emitBytes(Assembler *as, const uint8_t *BYTES,
+					   const size_t COUNT) {
+	if( as->count + COUNT > as->size ) {
+		const size_t OLD_SIZE = as->size;
+		while( as->count + COUNT > as->size ) {
+			as->size = MEM_GROW_SIZE(as->size);
+		}
+
+		as->code = MEM_GROW_ARRAY(uint8_t, as->code, OLD_SIZE, as->size);
+	}
+
+	memcpy(as->code + as->count, BYTES, COUNT);
+	as->count += COUNT;
+}
+
+static void _emit32(Assembler *as, const uint32_t VALUE) {
+	EMIT(as, VALUE & 0xff, (VALUE >> 8) & 0xff, (VALUE >> 16) & 0xff,
+		 (VALUE >> 24) & 0xff);
+}
+
+static void _emit64(Assembler *as, const uint64_t VALUE) {
+	_emit32(as, (uint32_t)VALUE);
+	_emit32(as, (uint32_t)(VALUE >> 32));
+}
+
+/**
+ * @brief Emite o prefixo REX, se ele for necessário
+ *
+ * @param[out] as Montador
+ * @param[in] W Se a operação é de 64 bits
+ * @param[in] REG Registrador do campo reg do ModRM
+ * @param[in] BASE Registrador do campo rm do ModRM
+ */
+static void _rex(Assembler *as, const bool W, const uint8_t REG,
+				 const uint8_t BASE) {
+	const uint8_t REX = 0x40 | (W << 3) | ((REG >> 3) << 2) | (BASE >> 3);
+	if( REX != 0x40 ) {
+		EMIT(as, REX);
+	}
+}
+
+/**
+ * @brief Emite o ModRM (e SIB/deslocamento) de um operando [base + disp]
+ *
+ * @param[out] as Montador
+ * @param[in] REG Registrador (ou extensão do opcode) do campo reg
+ * @param[in] MEM Operando em memória
+ */
+static void _modrm(Assembler *as, const uint8_t REG, const Operand MEM) {
+	const uint8_t RM = MEM.base & 7;
+	const uint8_t MID = (REG & 7) << 3;
+
+	/* rbp/r13 sem deslocamento seriam endereçamento relativo ao rip */
+	if( MEM.disp == 0 && RM != 5 ) {
+		EMIT(as, MID | RM);
+	} else if( MEM.disp >= INT8_MIN && MEM.disp <= INT8_MAX ) {
+		EMIT(as, 0x40 | MID | RM);
+	} else {
+		EMIT(as, 0x80 | MID | RM);
+	}
+
+	/* rsp/r12 como base precisam de um SIB */
+	if( RM == 4 ) {
+		EMIT(as, 0x24);
+	}
+
+	if( MEM.disp != 0 || RM == 5 ) {
+		if( MEM.disp >= INT8_MIN && MEM.disp <= INT8_MAX ) {
+			EMIT(as, (uint8_t)MEM.disp);
+		} else {
+			_emit32(as, (uint32_t)MEM.disp);
+		}
+	}
+}
+
+/**
+ * @brief Emite uma instrução SSE com um operando em memória
+ *
+ * @param[out] as Montador
+ * @param[in] PREFIX Prefixo obrigatório (0xf2, 0xf3 ou 0x66)
+ * @param[in] OPCODE Opcode depois do 0x0f
+ * @param[in] XMM Registrador xmm
+ * @param[in] MEM Operando em memória
+ */
+static void _sse(Assembler *as, const uint8_t PREFIX, const uint8_t OPCODE,
+				 const uint8_t XMM, const Operand MEM) {
+	EMIT(as, PREFIX);
+	_rex(as, false, XMM, MEM.base);
+	EMIT(as, 0x0f, OPCODE);
+	_modrm(as, XMM, MEM);
+}
+
+static Operand _payload(const Operand VALUE) {
+	return (Operand){VALUE.base, VALUE.disp + VALUE_PAYLOAD};
+}
+
+static Operand _stack(const int32_t SLOT) {
+	return (Operand){R12, SLOT * VALUE_SIZE};
+}
+
+/** Copia um Value inteiro de @a SRC para @a DST */
+static void _copyValue(Assembler *as, const Operand DST, const Operand SRC) {
+	_sse(as, 0xf3, 0x6f, 0, SRC); /* movdqu xmm0, [src] */
+	_sse(as, 0xf3, 0x7f, 0, DST); /* movdqu [dst], xmm0 */
+}
+
+static void _movLoad(Assembler *as, const Register REG, const Operand MEM) {
+	_rex(as, true, REG, MEM.base);
+	EMIT(as, 0x8b);
+	_modrm(as, REG, MEM);
+}
+
+static void _movStore(Assembler *as, const Operand MEM, const Register REG) {
+	_rex(as, true, REG, MEM.base);
+	EMIT(as, 0x89);
+	_modrm(as, REG, MEM);
+}
+
+static void _lea(Assembler *as, const Register REG, const Operand MEM) {
+	_rex(as, true, REG, MEM.base);
+	EMIT(as, 0x8d);
+	_modrm(as, REG, MEM);
+}
+
+static void _movImm64(Assembler *as, const Register REG, const uint64_t IMM) {
+	_rex(as, true, 0, REG);
+	EMIT(as, 0xb8 + (REG & 7));
+	_emit64(as, IMM);
+}
+
+/** mov byte [mem], imm8 */
+static void _movByte(Assembler *as, const Operand MEM, const uint8_t IMM) {
+	_rex(as, false, 0, MEM.base);
+	EMIT(as, 0xc6);
+	_modrm(as, 0, MEM);
+	EMIT(as, IMM);
+}
+
+/** Ajusta o topo da pilha em @a SLOTS valores */
+static void _moveTop(Assembler *as, const int8_t SLOTS) {
+	if( SLOTS > 0 ) {
+		EMIT(as, 0x49, 0x83, 0xc4, SLOTS * VALUE_SIZE); /* add r12, imm8 */
+	} else if( SLOTS < 0 ) {
+		EMIT(as, 0x49, 0x83, 0xec, -SLOTS * VALUE_SIZE); /* sub r12, imm8 */
+	}
+}
+
+/** Lê o ValueType de um Value em eax */
+static void _loadType(Assembler *as, const Operand VALUE) {
+	_rex(as, false, RAX, VALUE.base);
+	EMIT(as, 0x0f, 0xb6); /* movzx eax, byte [value] */
+	_modrm(as, RAX, VALUE);
+	EMIT(as, 0x83, 0xe0, 0x07); /* and eax, 7 */
+}
+
+/** cmp byte [mem], 0 */
+static void _cmpByteZero(Assembler *as, const Operand MEM) {
+	_rex(as, false, 0, MEM.base);
+	EMIT(as, 0x80);
+	_modrm(as, 7, MEM);
+	EMIT(as, 0x00);
+}
+
+/** Emite um pulo condicional com deslocamento de 32 bits a ser corrigido */
+static size_t _jcc(Assembler *as, const uint8_t CONDITION) {
+	EMIT(as, 0x0f, CONDITION);
+	_emit32(as, 0);
+	return as->count - 4;
+}
+
+/** Emite um pulo com deslocamento de 32 bits a ser corrigido */
+static size_t _jmp(Assembler *as) {
+	EMIT(as, 0xe9);
+	_emit32(as, 0);
+	return as->count - 4;
+}
+
+/** Faz o pulo em @a AT ir para @a TARGET */
+static void _patch(Assembler *as, const size_t AT, const size_t TARGET) {
+	const int32_t REL = (int32_t)(TARGET - (AT + 4));
+	memcpy(as->code + AT, &REL, sizeof(int32_t));
+}
+
+/** Pula para a instrução @a TARGET do bytecode */
+static void _jumpTo(Assembler *as, const size_t AT, const size_t TARGET) {
+	if( as->fixupCount + 1 > as->fixupSize ) {
+		const size_t OLD_SIZE = as->fixupSize;
+		as->fixupSize = MEM_GROW_SIZE(OLD_SIZE);
+		as->fixups =
+			MEM_GROW_ARRAY(JumpFixup, as->fixups, OLD_SIZE, as->fixupSize);
+	}
+
+	as->fixups[as->fixupCount++] = (JumpFixup){AT, TARGET};
+}
+
+/**
+ * @brief Pula pro slow path se o Value em @a VALUE não for do tipo @a TYPE
+ *
+ * @return A posição do pulo, que deve ser corrigida para o slow path
+ */
+static size_t _guardType(Assembler *as, const Operand VALUE,
+						 const ValueType TYPE) {
+	_loadType(as, VALUE);
+	EMIT(as, 0x83, 0xf8, TYPE); /* cmp eax, type */
+	return _jcc(as, 0x85);		/* jne */
+}
+
+/**
+ * @brief Devolve o controle pro interpretador, que continua em @a fp
+ */
+static void _emitExit(Assembler *as, uint8_t *fp) {
+	_movImm64(as, RAX, (uint64_t)(uintptr_t)fp);
+	_patch(as, _jmp(as), as->exit);
+}
+
+/**
+ * @brief Emite o slow path de uma instrução com guardas
+ *
+ * O caminho rápido pula o slow path, que devolve a instrução @a fp inteira
+ * pro interpretador
+ *
+ * @param[out] as Montador
+ * @param[in] guards Pulos pro slow path (0 se não usado)
+ * @param[in] COUNT Quantidade de pulos
+ * @param[in] fp Instrução onde o interpretador continua
+ */
+static void _emitGuardExit(Assembler *as, const size_t *guards,
+						   const size_t COUNT, uint8_t *fp) {
+	const size_t DONE = _jmp(as);
+	for( size_t i = 0; i < COUNT; i++ ) {
+		if( guards[i] != 0 ) {
+			_patch(as, guards[i], as->count);
+		}
+	}
+	_emitExit(as, fp);
+	_patch(as, DONE, as->count);
+}
+
+/**
+ * @brief Chama uma função em C que usa a pilha da VM
+ *
+ * O topo da pilha é sincronizado antes da chamada e relido depois dela
+ */
+static void _emitCall(Assembler *as, JitHelper function) {
+	EMIT(as, 0x4d, 0x89, 0x26); /* mov [r14], r12 */
+	_movImm64(as, RAX, (uint64_t)(uintptr_t)function);
+	EMIT(as, 0xff, 0xd0);		/* call rax */
+	EMIT(as, 0x4d, 0x8b, 0x26); /* mov r12, [r14] */
+}
+
+/**
+ * @brief Chama uma função em C que retorna false em caso de erro
+ *
+ * frame->fp aponta pra próxima instrução durante a chamada, como no
+ * interpretador, para que erros reportem a linha certa. Se a função falhar,
+ * o código nativo retorna NULL
+ *
+ * @param[out] as Montador
+ * @param[in] function Função em C
+ * @param[in] next Instrução seguinte
+ */
+static void _emitFallibleCall(Assembler *as, JitHelper function,
+							  uint8_t *next) {
+	_movImm64(as, RAX, (uint64_t)(uintptr_t)next);
+	_movStore(as, (Operand){RBX, offsetof(CallFrame, fp)}, RAX);
+
+	_emitCall(as, function);
+
+	EMIT(as, 0x84, 0xc0); /* test al, al */
+	EMIT(as, 0x75, 0x00); /* jnz ok */
+	const size_t OK = as->count - 1;
+
+	EMIT(as, 0x31, 0xc0); /* xor eax, eax */
+	_patch(as, _jmp(as), as->exit);
+
+	as->code[OK] = (uint8_t)(as->count - OK - 1);
+}
+
+/**
+ * @brief Helper: imprime o valor no topo da pilha
+ */
+static void _helperPrint(void) {
+	valuePrint(vmPop());
+	printf("\n");
+}
+
+/**
+ * @brief Helper: compara os dois valores no topo da pilha
+ */
+static void _helperEqual(void) {
+	Value b = vmPop();
+	Value a = vmPop();
+	vmPush(CREATE_BOOL(valueEquals(a, b)));
+}
+
+#ifdef GC_WRITE_BARRIER
+/**
+ * @brief Helper: barreira de escrita do valor no topo da pilha em @a owner
+ */
+static void _helperBarrier(Obj *owner) {
+	gcBarrier(owner, vm.stackTop[-1]);
+}
+#endif
+
+/**
+ * @brief Emite a barreira de escrita do GC, depois de o valor no topo da
+ * pilha ser guardado no objeto em @a OWNER
+ *
+ * O helper só é chamado se o objeto estiver marcado
+ *
+ * @param[out] as Montador
+ * @param[in] OWNER Registrador com o objeto que recebeu o valor
+ */
+static void _emitBarrier(Assembler *as, const Register OWNER) {
+#ifdef GC_WRITE_BARRIER
+	_rex(as, true, OWNER, RDI);
+	EMIT(as, 0x89, 0xc0 | ((OWNER & 7) << 3) | (RDI & 7)); /* mov rdi, owner */
+
+	_cmpByteZero(as, (Operand){RDI, offsetof(Obj, isMarked)});
+	EMIT(as, 0x74, 0x00); /* je done */
+	const size_t DONE = as->count - 1;
+
+	_emitCall(as, (JitHelper)_helperBarrier);
+	as->code[DONE] = (uint8_t)(as->count - DONE - 1);
+#else
+	(void)as;
+	(void)OWNER;
+#endif
+}
+
+#ifdef GC_CONCURRENT
+/**
+ * @brief Helper: barreira do GC antes de @a owner ser modificado
+ */
+static void _helperPreBarrier(Obj *owner) {
+	gcPreBarrier(owner);
+}
+#endif
+
+/**
+ * @brief Emite a barreira do GC concorrente, antes de o objeto em @a OWNER
+ * ser modificado
+ *
+ * O helper só é chamado durante a marcação, se o objeto ainda não foi
+ * percorrido. @a OWNER é preservado
+ *
+ * @param[out] as Montador
+ * @param[in] OWNER Registrador com o objeto que será modificado
+ */
+static void _emitPreBarrier(Assembler *as, const Register OWNER) {
+#ifdef GC_CONCURRENT
+	_movImm64(as, RDI, (uint64_t)(uintptr_t)&vm.gcPhase);
+	EMIT(as, 0x80, 0x3f, GC_PHASE_MARK); /* cmp byte [rdi], GC_PHASE_MARK */
+	EMIT(as, 0x75, 0x00);				 /* jne done */
+	const size_t NOT_MARKING = as->count - 1;
+
+	_rex(as, true, OWNER, RDI);
+	EMIT(as, 0x89, 0xc0 | ((OWNER & 7) << 3) | (RDI & 7)); /* mov rdi, owner */
+
+	_cmpByteZero(as, (Operand){RDI, offsetof(Obj, isScanned)});
+	EMIT(as, 0x75, 0x00); /* jne done */
+	const size_t SCANNED = as->count - 1;
+
+	/* push owner duas vezes, para a pilha continuar alinhada na chamada */
+	for( uint8_t i = 0; i < 2; ++i ) {
+		if( OWNER & 8 ) {
+			EMIT(as, 0x41);
+		}
+		EMIT(as, 0x50 | (OWNER & 7));
+	}
+
+	_emitCall(as, (JitHelper)_helperPreBarrier);
+
+	for( uint8_t i = 0; i < 2; ++i ) {
+		if( OWNER & 8 ) {
+			EMIT(as, 0x41);
+		}
+		EMIT(as, 0x58 | (OWNER & 7)); /* pop owner */
+	}
+
+	as->code[NOT_MARKING] = (uint8_t)(as->count - NOT_MARKING - 1);
+	as->code[SCANNED] = (uint8_t)(as->count - SCANNED - 1);
+#else
+	(void)as;
+	(void)OWNER;
+#endif
+}
+
+/**
+ * @brief Tipos de operações numéricas
+ */
+typedef enum {
+	NUM_ADD,
+	NUM_SUB,
+	NUM_MUL,
+	NUM_DIV,
+	NUM_MOD,
+	NUM_EQUAL,
+	NUM_GREATER,
+	NUM_GREATER_EQUAL,
+	NUM_LESS,
+	NUM_LESS_EQUAL,
+} NumberOp;
+
+/**
+ * @brief Emite uma operação numérica, com guardas de tipo
+ *
+ * @param[out] as Montador
+ * @param[in] KIND Operação
+ * @param[in] A Primeiro operando
+ * @param[in] B Segundo operando
+ * @param[in] B_IS_CONST Se @a B é uma constante (já sabidamente numérica)
+ * @param[in] DST Onde o resultado será escrito
+ * @param[in] DELTA Quanto o topo da pilha muda depois da operação
+ * @param[out] guards Pulos pro slow path (0 se o operando não tem guarda)
+ */
+static void _emitNumberOp(Assembler *as, const NumberOp KIND, const Operand A,
+						  const Operand B, const bool B_IS_CONST,
+						  const Operand DST, const int8_t DELTA,
+						  size_t guards[2]) {
+	guards[0] = _guardType(as, A, VALUE_NUMBER);
+	guards[1] = B_IS_CONST ? 0 : _guardType(as, B, VALUE_NUMBER);
+
+	_sse(as, 0xf2, 0x10, 0, _payload(A)); /* movsd xmm0, a */
+	_sse(as, 0xf2, 0x10, 1, _payload(B)); /* movsd xmm1, b */
+
+	switch( KIND ) {
+		case NUM_ADD:
+			EMIT(as, 0xf2, 0x0f, 0x58, 0xc1); /* addsd xmm0, xmm1 */
+			break;
+		case NUM_SUB:
+			EMIT(as, 0xf2, 0x0f, 0x5c, 0xc1); /* subsd xmm0, xmm1 */
+			break;
+		case NUM_MUL:
+			EMIT(as, 0xf2, 0x0f, 0x59, 0xc1); /* mulsd xmm0, xmm1 */
+			break;
+		case NUM_DIV:
+			EMIT(as, 0xf2, 0x0f, 0x5e, 0xc1); /* divsd xmm0, xmm1 */
+			break;
+		case NUM_MOD:
+			_movImm64(as, RAX, (uint64_t)(uintptr_t)&fmod);
+			EMIT(as, 0xff, 0xd0); /* call rax */
+			break;
+		case NUM_EQUAL:
+			EMIT(as, 0x66, 0x0f, 0x2e, 0xc1); /* ucomisd xmm0, xmm1 */
+			EMIT(as, 0x0f, 0x94, 0xc0);		  /* sete al */
+			EMIT(as, 0x0f, 0x9b, 0xc1);		  /* setnp cl */
+			EMIT(as, 0x20, 0xc8);			  /* and al, cl */
+			break;
+		case NUM_GREATER:
+			EMIT(as, 0x66, 0x0f, 0x2e, 0xc1); /* ucomisd xmm0, xmm1 */
+			EMIT(as, 0x0f, 0x97, 0xc0);		  /* seta al */
+			break;
+		case NUM_GREATER_EQUAL:
+			EMIT(as, 0x66, 0x0f, 0x2e, 0xc1); /* ucomisd xmm0, xmm1 */
+			EMIT(as, 0x0f, 0x93, 0xc0);		  /* setae al */
+			break;
+		case NUM_LESS:
+			EMIT(as, 0x66, 0x0f, 0x2e, 0xc8); /* ucomisd xmm1, xmm0 */
+			EMIT(as, 0x0f, 0x97, 0xc0);		  /* seta al */
+			break;
+		case NUM_LESS_EQUAL:
+			EMIT(as, 0x66, 0x0f, 0x2e, 0xc8); /* ucomisd xmm1, xmm0 */
+			EMIT(as, 0x0f, 0x93, 0xc0);		  /* setae al */
+			break;
+	}
+
+	if( KIND >= NUM_EQUAL ) {
+		_movByte(as, DST, VALUE_BOOL);
+		_rex(as, false, RAX, DST.base);
+		EMIT(as, 0x88); /* mov byte [dst], al */
+		_modrm(as, RAX, _payload(DST));
+	} else {
+		_movByte(as, DST, VALUE_NUMBER);
+		_sse(as, 0xf2, 0x11, 0, _payload(DST)); /* movsd [dst], xmm0 */
+	}
+
+	_moveTop(as, DELTA);
+}
+
+/**
+ * @brief Traduz uma operação binária genérica para o seu tipo numérico
+ */
+static NumberOp _numberOp(const uint8_t OP) {
+	switch( OP ) {
+		case OP_ADD:
+		case OP_ADD_NUM:
+			return NUM_ADD;
+		case OP_SUB:
+		case OP_SUB_NUM:
+			return NUM_SUB;
+		case OP_MUL:
+		case OP_MUL_NUM:
+			return NUM_MUL;
+		case OP_DIV:
+		case OP_DIV_NUM:
+			return NUM_DIV;
+		case OP_MOD:
+		case OP_MOD_NUM:
+			return NUM_MOD;
+		case OP_EQUAL:
+		case OP_EQUAL_NUM:
+			return NUM_EQUAL;
+		case OP_GREATER:
+		case OP_GREATER_NUM:
+			return NUM_GREATER;
+		case OP_GREATER_EQUAL:
+		case OP_GREATER_EQUAL_NUM:
+			return NUM_GREATER_EQUAL;
+		case OP_LESS:
+		case OP_LESS_NUM:
+			return NUM_LESS;
+		default:
+			return NUM_LESS_EQUAL;
+	}
+}
+
+/**
+ * @brief Emite o código de uma instrução
+ *
+ * @param[out] as Montador
+ * @param[in] function Função sendo compilada
+ * @param[in] OFFSET Offset da instrução
+ *
+ * @return Se a instrução foi compilada. Se não, foi emitida uma saída pro
+ * interpretador no lugar dela
+ */
+static bool _emitInstruction(Assembler *as, ObjFunction *function,
+							 const size_t OFFSET) {
+	Chunk *chunk = &function->chunk;
+	uint8_t *ip = chunk->code + OFFSET;
+
+	/* Só lê os operandos que a instrução tem de fato */
+	const uint8_t OP = ip[0];
+	const size_t LENGTH = chunkInstructionLength(chunk, OFFSET);
+	const uint32_t ARG_8 = LENGTH > 1 ? ip[1] : 0;
+	const uint32_t ARG_24 =
+		LENGTH > 3 ? ip[1] | (ip[2] << 8) | ((uint32_t)ip[3] << 16) : 0;
+	const uint16_t ARG_JUMP =
+		LENGTH > 2 ? (uint16_t)((ip[1] << 8) | ip[2]) : 0;
+
+	/* Pulos pro slow path da instrução */
+	size_t guards[2] = {0, 0};
+
+	switch( OP ) {
+		case OP_CONST_16:
+		case OP_CONST_32:
+			_copyValue(as, _stack(0),
+					   (Operand){R15, (OP == OP_CONST_16 ? ARG_8 : ARG_24) *
+										  VALUE_SIZE});
+			_moveTop(as, 1);
+			return true;
+
+		case OP_TRUE:
+		case OP_FALSE:
+			_movByte(as, _stack(0), VALUE_BOOL);
+			_movByte(as, _payload(_stack(0)), OP == OP_TRUE);
+			_moveTop(as, 1);
+			return true;
+
+		case OP_NIL:
+			_movByte(as, _stack(0), VALUE_NIL);
+			_moveTop(as, 1);
+			return true;
+
+		case OP_POP:
+			_moveTop(as, -1);
+			return true;
+
+		case OP_DUP:
+			_copyValue(as, _stack(0), _stack(-1));
+			_moveTop(as, 1);
+			return true;
+
+		case OP_GET_LOCAL_16:
+		case OP_GET_LOCAL_32:
+			_copyValue(as, _stack(0),
+					   (Operand){R13, (OP == OP_GET_LOCAL_16 ? ARG_8 : ARG_24) *
+										  VALUE_SIZE});
+			_moveTop(as, 1);
+			return true;
+
+		case OP_SET_LOCAL_16:
+		case OP_SET_LOCAL_32:
+			_copyValue(as,
+					   (Operand){R13, (OP == OP_SET_LOCAL_16 ? ARG_8 : ARG_24) *
+										  VALUE_SIZE},
+					   _stack(-1));
+			return true;
+
+		case OP_GET_UPVALUE_16:
+		case OP_GET_UPVALUE_32:
+		case OP_SET_UPVALUE_16:
+		case OP_SET_UPVALUE_32: {
+			const bool IS_16 =
+				(OP == OP_GET_UPVALUE_16 || OP == OP_SET_UPVALUE_16);
+			const int32_t INDEX = IS_16 ? ARG_8 : ARG_24;
+
+			/* rcx = frame->closure->upvalues[index], rax = rcx->location */
+			_movLoad(as, RAX, (Operand){RBX, offsetof(CallFrame, closure)});
+			_movLoad(as, RAX, (Operand){RAX, offsetof(ObjClosure, upvalues)});
+			_movLoad(as, RCX, (Operand){RAX, INDEX * (int32_t)sizeof(void *)});
+
+			if( OP == OP_GET_UPVALUE_16 || OP == OP_GET_UPVALUE_32 ) {
+				_movLoad(as, RAX,
+						 (Operand){RCX, offsetof(ObjUpvalue, location)});
+				_copyValue(as, _stack(0), (Operand){RAX, 0});
+				_moveTop(as, 1);
+			} else {
+				_emitPreBarrier(as, RCX);
+				_movLoad(as, RAX,
+						 (Operand){RCX, offsetof(ObjUpvalue, location)});
+				_copyValue(as, (Operand){RAX, 0}, _stack(-1));
+				_emitBarrier(as, RCX);
+			}
+		}
+			return true;
+
+		case OP_GET_GLOBAL_16:
+		case OP_GET_GLOBAL_32:
+		case OP_SET_GLOBAL_16:
+		case OP_SET_GLOBAL_32: {
+			const bool IS_16 =
+				(OP == OP_GET_GLOBAL_16 || OP == OP_SET_GLOBAL_16);
+			const Operand GLOBAL = {RAX,
+									(IS_16 ? ARG_8 : ARG_24) * VALUE_SIZE};
+
+			/* O array de globais pode ser realocado, então é sempre relido */
+			_movImm64(as, RAX, (uint64_t)(uintptr_t)&vm.globalValues.values);
+			_movLoad(as, RAX, (Operand){RAX, 0});
+
+			_rex(as, false, RCX, RAX);
+			EMIT(as, 0x0f, 0xb6); /* movzx ecx, byte [global] */
+			_modrm(as, RCX, GLOBAL);
+			EMIT(as, 0x83, 0xe1, 0x07);			/* and ecx, 7 */
+			EMIT(as, 0x83, 0xf9, VALUE_EMPTY);	/* cmp ecx, VALUE_EMPTY */
+			guards[0] = _jcc(as, 0x84);			/* je */
+
+			if( OP == OP_GET_GLOBAL_16 || OP == OP_GET_GLOBAL_32 ) {
+				_copyValue(as, _stack(0), GLOBAL);
+				_moveTop(as, 1);
+			} else {
+				_copyValue(as, GLOBAL, _stack(-1));
+			}
+		} break;
+
+		case OP_EQUAL:
+		case OP_EQUAL_NUM:
+		case OP_GREATER:
+		case OP_GREATER_NUM:
+		case OP_GREATER_EQUAL:
+		case OP_GREATER_EQUAL_NUM:
+		case OP_LESS:
+		case OP_LESS_NUM:
+		case OP_LESS_EQUAL:
+		case OP_LESS_EQUAL_NUM:
+		case OP_ADD:
+		case OP_ADD_NUM:
+		case OP_SUB:
+		case OP_SUB_NUM:
+		case OP_MUL:
+		case OP_MUL_NUM:
+		case OP_DIV:
+		case OP_DIV_NUM:
+		case OP_MOD:
+		case OP_MOD_NUM: {
+			_emitNumberOp(as, _numberOp(OP), _stack(-2), _stack(-1), false,
+						  _stack(-2), -1, guards);
+
+			/* Igualdade funciona com qualquer tipo, então não precisa sair */
+			if( OP == OP_EQUAL || OP == OP_EQUAL_NUM ) {
+				const size_t DONE = _jmp(as);
+				_patch(as, guards[0], as->count);
+				_patch(as, guards[1], as->count);
+				_emitCall(as, _helperEqual);
+				_patch(as, DONE, as->count);
+				return true;
+			}
+		} break;
+
+		case OP_NEGATE:
+		case OP_NEGATE_NUM:
+			guards[0] = _guardType(as, _stack(-1), VALUE_NUMBER);
+			_movLoad(as, RAX, _payload(_stack(-1)));
+			EMIT(as, 0x48, 0x0f, 0xba, 0xf8, 0x3f); /* btc rax, 63 */
+			_movStore(as, _payload(_stack(-1)), RAX);
+			_movByte(as, _stack(-1), VALUE_NUMBER);
+			break;
+
+		case OP_NOT: {
+			/* cl = valor é nulo ou falso */
+			_loadType(as, _stack(-1));
+			EMIT(as, 0xb9, 0x01, 0x00, 0x00, 0x00); /* mov ecx, 1 */
+			EMIT(as, 0x85, 0xc0);					/* test eax, eax */
+			EMIT(as, 0x74, 0x00);					/* jz done */
+			const size_t IS_NIL = as->count - 1;
+
+			EMIT(as, 0x31, 0xc9);				/* xor ecx, ecx */
+			EMIT(as, 0x83, 0xf8, VALUE_BOOL);	/* cmp eax, VALUE_BOOL */
+			EMIT(as, 0x75, 0x00);				/* jne done */
+			const size_t NOT_BOOL = as->count - 1;
+
+			_cmpByteZero(as, _payload(_stack(-1)));
+			EMIT(as, 0x0f, 0x94, 0xc1); /* sete cl */
+
+			as->code[IS_NIL] = (uint8_t)(as->count - IS_NIL - 1);
+			as->code[NOT_BOOL] = (uint8_t)(as->count - NOT_BOOL - 1);
+
+			_movByte(as, _stack(-1), VALUE_BOOL);
+			_rex(as, false, RCX, R12);
+			EMIT(as, 0x88); /* mov byte [payload], cl */
+			_modrm(as, RCX, _payload(_stack(-1)));
+		}
+			return true;
+
+		case OP_PRINT:
+			_emitCall(as, _helperPrint);
+			return true;
+
+		case OP_GET_PROPERTY_16:
+		case OP_GET_PROPERTY_32:
+		case OP_SET_PROPERTY_16:
+		case OP_SET_PROPERTY_32: {
+			const bool IS_16 =
+				(OP == OP_GET_PROPERTY_16 || OP == OP_SET_PROPERTY_16);
+			const uint8_t *CACHE = ip + (IS_16 ? 2 : 4);
+			const uint16_t CACHE_INDEX = (uint16_t)(CACHE[0] << 8) | CACHE[1];
+
+			Value name = chunk->consts.values[IS_16 ? ARG_8 : ARG_24];
+			_movImm64(as, RDI, (uint64_t)(uintptr_t)AS_STRING(name));
+			_movImm64(as, RSI,
+					  (uint64_t)(uintptr_t)&chunk->caches[CACHE_INDEX]);
+
+			const bool IS_GET =
+				(OP == OP_GET_PROPERTY_16 || OP == OP_GET_PROPERTY_32);
+			_emitFallibleCall(as,
+							  IS_GET ? (JitHelper)vmGetProperty
+									 : (JitHelper)vmSetProperty,
+							  (uint8_t *)CACHE + 2);
+		}
+			return true;
+
+		case OP_JUMP:
+			_jumpTo(as, _jmp(as), OFFSET + 3 + ARG_JUMP);
+			return true;
+
+		case OP_LOOP:
+			_jumpTo(as, _jmp(as), OFFSET + 3 - ARG_JUMP);
+			return true;
+
+		case OP_JUMP_IF_FALSE: {
+			_loadType(as, _stack(-1));
+			EMIT(as, 0x85, 0xc0); /* test eax, eax */
+			_jumpTo(as, _jcc(as, 0x84), OFFSET + 3 + ARG_JUMP);
+
+			EMIT(as, 0x83, 0xf8, VALUE_BOOL); /* cmp eax, VALUE_BOOL */
+			EMIT(as, 0x75, 0x00);			  /* jne next */
+			const size_t NOT_BOOL = as->count - 1;
+
+			_cmpByteZero(as, _payload(_stack(-1)));
+			_jumpTo(as, _jcc(as, 0x84), OFFSET + 3 + ARG_JUMP);
+
+			as->code[NOT_BOOL] = (uint8_t)(as->count - NOT_BOOL - 1);
+		}
+			return true;
+
+		case OP_JUMP_IF_TRUE: {
+			_loadType(as, _stack(-1));
+			EMIT(as, 0x85, 0xc0); /* test eax, eax */
+			EMIT(as, 0x74, 0x00); /* je next */
+			const size_t IS_NIL = as->count - 1;
+
+			EMIT(as, 0x83, 0xf8, VALUE_BOOL); /* cmp eax, VALUE_BOOL */
+			_jumpTo(as, _jcc(as, 0x85), OFFSET + 3 + ARG_JUMP);
+
+			_cmpByteZero(as, _payload(_stack(-1)));
+			_jumpTo(as, _jcc(as, 0x85), OFFSET + 3 + ARG_JUMP);
+
+			as->code[IS_NIL] = (uint8_t)(as->count - IS_NIL - 1);
+		}
+			return true;
+
+		default:
+			if( OP >= OP_ADD_RR && OP <= OP_MOD_RRK ) {
+				/* Cada grupo de instruções de registradores segue a ordem
+				 * de NumberOp
+				 */
+				uint8_t first = OP_ADD_RR;
+				if( OP >= OP_ADD_RRK ) {
+					first = OP_ADD_RRK;
+				} else if( OP >= OP_ADD_RRR ) {
+					first = OP_ADD_RRR;
+				} else if( OP >= OP_ADD_RK ) {
+					first = OP_ADD_RK;
+				}
+
+				const bool IS_STORE = (OP >= OP_ADD_RRR);
+				const bool IS_CONST = (first == OP_ADD_RK || first == OP_ADD_RRK);
+				const uint8_t *OPERANDS = ip + 1 + IS_STORE;
+
+				/* Constantes que não são números (ex.: concatenação com
+				 * uma string) ficam com o interpretador
+				 */
+				if( IS_CONST &&
+					!IS_NUMBER(chunk->consts.values[OPERANDS[1]]) ) {
+					_emitExit(as, ip);
+					return false;
+				}
+
+				const Operand A = {R13, OPERANDS[0] * VALUE_SIZE};
+				const Operand B = {IS_CONST ? R15 : R13,
+								   OPERANDS[1] * VALUE_SIZE};
+				const Operand DST =
+					IS_STORE ? (Operand){R13, ip[1] * VALUE_SIZE} : _stack(0);
+
+				_emitNumberOp(as, (NumberOp)(OP - first), A, B, IS_CONST, DST,
+							  IS_STORE ? 0 : 1, guards);
+				break;
+			}
+
+			/* Qualquer outra instrução é executada pelo interpretador */
+			_emitExit(as, ip);
+			return false;
+	}
+
+	_emitGuardExit(as, guards, 2, ip);
+	return true;
+}
+
+/**
+ * @brief Emite o prólogo do código nativo e a saída para o interpretador
+ *
+ * O prólogo salva os registradores, carrega o estado do frame e pula pro
+ * endereço recebido. A saída salva o topo da pilha e retorna a instrução
+ * em rax
+ *
+ * @param[out] as Montador
+ * @param[in] function Função do frame onde o código nativo começa
+ */
+static void _emitPrologue(Assembler *as, ObjFunction *function) {
+	EMIT(as, 0x55, 0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57);
+	EMIT(as, 0x48, 0x83, 0xec, 0x08); /* sub rsp, 8 (alinha a pilha) */
+	EMIT(as, 0x48, 0x89, 0xfb);		  /* mov rbx, rdi */
+	_movImm64(as, R14, (uint64_t)(uintptr_t)&vm.stackTop);
+	EMIT(as, 0x4d, 0x8b, 0x26); /* mov r12, [r14] */
+	_movLoad(as, R13, (Operand){RBX, offsetof(CallFrame, slots)});
+	_movImm64(as, R15, (uint64_t)(uintptr_t)function->chunk.consts.values);
+	EMIT(as, 0xff, 0xe6); /* jmp rsi */
+
+	as->exit = as->count;
+	EMIT(as, 0x4d, 0x89, 0x26);		  /* mov [r14], r12 */
+	EMIT(as, 0x48, 0x83, 0xc4, 0x08); /* add rsp, 8 */
+	EMIT(as, 0x41, 0x5f, 0x41, 0x5e, 0x41, 0x5d, 0x41, 0x5c, 0x5b, 0x5d,
+		 0xc3);
+}
+
+/**
+ * @brief Copia o código montado para uma região executável
+ *
+ * A região nunca é gravável e executável ao mesmo tempo
+ *
+ * @return O código, ou NULL se não foi possível mapeá-lo
+ */
+static uint8_t *_install(Assembler *as) {
+	uint8_t *code = mmap(NULL, as->count, PROT_READ | PROT_WRITE,
+						 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if( code == MAP_FAILED ) {
+		return NULL;
+	}
+
+	memcpy(code, as->code, as->count);
+
+	if( mprotect(code, as->count, PROT_READ | PROT_EXEC) != 0 ) {
+		munmap(code, as->count);
+		return NULL;
+	}
+
+	return code;
+}
+
+/**
+ * @brief Executa código nativo a partir de @a target
+ */
+static uint8_t *_callNative(uint8_t *code, CallFrame *frame,
+							uint8_t *target) {
+	/* ISO C não permite converter ponteiros de dados em ponteiros de função
+	 * diretamente
+	 */
+	union {
+		uint8_t *code;
+		JitFn function;
+	} native = {code};
+
+	return native.function(frame, target);
+}
+
+bool jitCompile(ObjFunction *function) {
+	Chunk *chunk = &function->chunk;
+
+	/* O montador usa a memória da VM, então o GC não pode rodar no meio */
+	const bool WAS_LOCKED = vm.isLocked;
+	vm.isLocked = true;
+
+	Assembler as = {0};
+	as.labels = MEM_ALLOC(size_t, chunk->count + 1);
+	for( size_t i = 0; i <= chunk->count; i++ ) {
+		as.labels[i] = NOT_AN_INSTRUCTION;
+	}
+
+	bool *compiled = MEM_ALLOC(bool, chunk->count);
+
+	_emitPrologue(&as, function);
+
+	bool ok = true;
+	for( size_t offset = 0; offset < chunk->count; ) {
+		const size_t LENGTH = chunkInstructionLength(chunk, offset);
+		if( LENGTH == 0 || offset + LENGTH > chunk->count ) {
+			ok = false;
+			break;
+		}
+
+		as.labels[offset] = as.count;
+		compiled[offset] = _emitInstruction(&as, function, offset);
+
+		offset += LENGTH;
+	}
+
+	for( size_t i = 0; ok && i < as.fixupCount; i++ ) {
+		const size_t TARGET = as.fixups[i].target;
+		if( TARGET > chunk->count || as.labels[TARGET] == NOT_AN_INSTRUCTION ) {
+			ok = false;
+			break;
+		}
+
+		_patch(&as, as.fixups[i].at, as.labels[TARGET]);
+	}
+
+	JitCode *jit = NULL;
+	uint8_t *code = ok ? _install(&as) : NULL;
+
+	if( code != NULL ) {
+		jit = MEM_ALLOC(JitCode, 1);
+		jit->code = code;
+		jit->size = as.count;
+		jit->entryCount = chunk->count;
+		jit->entries = MEM_ALLOC(uint8_t *, chunk->count);
+
+		for( size_t i = 0; i < chunk->count; i++ ) {
+			const bool IS_ENTRY =
+				as.labels[i] != NOT_AN_INSTRUCTION && compiled[i];
+			jit->entries[i] = IS_ENTRY ? code + as.labels[i] : NULL;
+		}
+	}
+
+	MEM_FREE_ARRAY(uint8_t, as.code, as.size);
+	MEM_FREE_ARRAY(size_t, as.labels, chunk->count + 1);
+	MEM_FREE_ARRAY(JumpFixup, as.fixups, as.fixupSize);
+	MEM_FREE_ARRAY(bool, compiled, chunk->count);
+
+	vm.isLocked = WAS_LOCKED;
+
+	function->jit = jit;
+	return jit != NULL;
+}
+
+uint8_t *jitEnter(CallFrame *frame, uint8_t *fp) {
+	JitCode *jit = frame->closure->function->jit;
+	uint8_t *target = jit->entries[fp - frame->closure->function->chunk.code];
+
+	if( target == NULL ) {
+		return fp;
+	}
+
+	return _callNative(jit->code, frame, target);
+}
+
+void jitFree(JitCode *jit) {
+	if( jit == NULL ) {
+		return;
+	}
+
+	munmap(jit->code, jit->size);
+	MEM_FREE_ARRAY(uint8_t *, jit->entries, jit->entryCount);
+	MEM_FREE(JitCode, jit);
+}
+
+/*
+ * Traces
+ *
+ * Quando um OP_LOOP volta TRACE_THRESHOLD vezes para o mesmo começo de loop,
+ * o interpretador passa a avisar o gravador antes de cada instrução. O
+ * gravador anota o caminho seguido (pulos tomados, funções chamadas, formas
+ * dos receptores e tipos dos operandos) até o loop voltar ao começo. Esse
+ * caminho vira código nativo linear, com guardas onde a próxima volta pode
+ * divergir. Uma guarda que falha é uma saída lateral: o código nativo
+ * devolve o controle pro interpretador exatamente na instrução divergente
+ *
+ * Chamadas de funções e métodos são embutidas no trace. O código nativo
+ * empilha e desempilha os CallFrames de verdade, então uma saída lateral
+ * dentro de uma função embutida continua no frame certo
+ *
+ * A gravação aborta antes de qualquer instrução que aloque memória. Os
+ * objetos gravados ainda assim são raízes do GC, já que contar as voltas de
+ * um loop interno pode alocar
+ */
+
+/**
+ * @brief Struct representando uma instrução gravada em um trace
+ */
+typedef struct TraceStep {
+	ObjFunction *function; /**< Função da instrução */
+	uint8_t *fp;		   /**< Instrução */
+	bool taken;			   /**< Se o pulo condicional foi tomado */
+	ObjShape *shape;	   /**< Forma do receptor (propriedades e métodos) */
+	int32_t slot;		   /**< Índice do campo (propriedades) */
+	ObjClosure *callee;	   /**< Função chamada (chamadas e métodos) */
+} TraceStep;
+
+/**
+ * @brief Estado do gravador de traces
+ */
+static struct {
+	JitTrace *trace;	   /**< Trace sendo gravado, ou NULL */
+	ObjFunction *function; /**< Função onde o loop está */
+	int8_t frameCount;	   /**< Quantidade de frames no começo do loop */
+	size_t count;		   /**< Quantidade de instruções gravadas */
+	TraceStep steps[TRACE_MAX_LENGTH]; /**< Instruções gravadas */
+} recorder = {0};
+
+/** Olha um valor da pilha sem removê-lo */
+static Value _peek(const size_t DIST) {
+	return vm.stackTop[-1 - (ptrdiff_t)DIST];
+}
+
+static bool _isFalsey(Value value) {
+	return IS_NIL(value) || (IS_BOOL(value) && !AS_BOOL(value));
+}
+
+/**
+ * @brief Verifica os operandos de uma instrução de registradores
+ *
+ * @return Se os dois operandos são números
+ */
+static bool _recordRegisterOp(CallFrame *frame, const uint8_t *ip) {
+	const uint8_t OP = ip[0];
+	const bool IS_STORE = (OP >= OP_ADD_RRR);
+	const bool IS_CONST = (OP >= OP_ADD_RK && OP < OP_ADD_RRR) ||
+						  (OP >= OP_ADD_RRK);
+	const uint8_t *OPERANDS = ip + 1 + IS_STORE;
+
+	Value b = IS_CONST ? frame->closure->function->chunk.consts
+							 .values[OPERANDS[1]]
+					   : frame->slots[OPERANDS[1]];
+	return IS_NUMBER(frame->slots[OPERANDS[0]]) && IS_NUMBER(b);
+}
+
+/**
+ * @brief Anota o que é preciso saber de uma instrução antes de executá-la
+ *
+ * @param[out] step Instrução gravada
+ * @param[in] frame Frame atual
+ *
+ * @return Se a instrução pode fazer parte de um trace
+ */
+static bool _recordStep(TraceStep *step, CallFrame *frame) {
+	Chunk *chunk = &step->function->chunk;
+	const uint8_t *ip = step->fp;
+	const uint8_t OP = ip[0];
+
+	switch( OP ) {
+		case OP_CONST_16:
+		case OP_CONST_32:
+		case OP_TRUE:
+		case OP_FALSE:
+		case OP_NIL:
+		case OP_POP:
+		case OP_DUP:
+		case OP_GET_LOCAL_16:
+		case OP_GET_LOCAL_32:
+		case OP_SET_LOCAL_16:
+		case OP_SET_LOCAL_32:
+		case OP_GET_UPVALUE_16:
+		case OP_GET_UPVALUE_32:
+		case OP_SET_UPVALUE_16:
+		case OP_SET_UPVALUE_32:
+		case OP_GET_GLOBAL_16:
+		case OP_GET_GLOBAL_32:
+		case OP_SET_GLOBAL_16:
+		case OP_SET_GLOBAL_32:
+		case OP_EQUAL:
+		case OP_EQUAL_NUM:
+		case OP_NOT:
+		case OP_PRINT:
+		case OP_JUMP:
+		case OP_LOOP:
+			return true;
+
+		case OP_GREATER:
+		case OP_GREATER_NUM:
+		case OP_GREATER_EQUAL:
+		case OP_GREATER_EQUAL_NUM:
+		case OP_LESS:
+		case OP_LESS_NUM:
+		case OP_LESS_EQUAL:
+		case OP_LESS_EQUAL_NUM:
+		case OP_ADD:
+		case OP_ADD_NUM:
+		case OP_SUB:
+		case OP_SUB_NUM:
+		case OP_MUL:
+		case OP_MUL_NUM:
+		case OP_DIV:
+		case OP_DIV_NUM:
+		case OP_MOD:
+		case OP_MOD_NUM:
+			/* Concatenação de strings aloca, então só números entram */
+			return IS_NUMBER(_peek(0)) && IS_NUMBER(_peek(1));
+
+		case OP_NEGATE:
+		case OP_NEGATE_NUM:
+			return IS_NUMBER(_peek(0));
+
+		case OP_JUMP_IF_FALSE:
+			step->taken = _isFalsey(_peek(0));
+			return true;
+
+		case OP_JUMP_IF_TRUE:
+			step->taken = !_isFalsey(_peek(0));
+			return true;
+
+		case OP_GET_PROPERTY_16:
+		case OP_GET_PROPERTY_32:
+		case OP_SET_PROPERTY_16:
+		case OP_SET_PROPERTY_32: {
+			const bool IS_16 =
+				(OP == OP_GET_PROPERTY_16 || OP == OP_SET_PROPERTY_16);
+			const bool IS_GET =
+				(OP == OP_GET_PROPERTY_16 || OP == OP_GET_PROPERTY_32);
+			const uint32_t NAME =
+				IS_16 ? ip[1] : ip[1] | (ip[2] << 8) | ((uint32_t)ip[3] << 16);
+
+			/* Só campos que já existem: métodos criariam um bound method, e
+			 * campos novos mudariam a forma da instância
+			 */
+			Value receiver = _peek(IS_GET ? 0 : 1);
+			if( !IS_INSTANCE(receiver) || AS_INSTANCE(receiver)->shape == NULL ) {
+				return false;
+			}
+
+			step->shape = AS_INSTANCE(receiver)->shape;
+			step->slot = objShapeFind(step->shape,
+									  AS_STRING(chunk->consts.values[NAME]));
+			return step->slot >= 0;
+		}
+
+		case OP_CALL: {
+			const uint8_t ARG_COUNT = ip[1];
+			Value callee = _peek(ARG_COUNT);
+
+			if( !IS_CLOSURE(callee) ||
+				AS_CLOSURE(callee)->function->arity != ARG_COUNT ) {
+				return false;
+			}
+
+			step->callee = AS_CLOSURE(callee);
+			return true;
+		}
+
+		case OP_INVOKE_16:
+		case OP_INVOKE_32: {
+			const bool IS_16 = (OP == OP_INVOKE_16);
+			const uint32_t NAME =
+				IS_16 ? ip[1] : ip[1] | (ip[2] << 8) | ((uint32_t)ip[3] << 16);
+			const uint8_t ARG_COUNT = ip[IS_16 ? 2 : 4];
+			ObjString *name = AS_STRING(chunk->consts.values[NAME]);
+
+			/* A forma diz que nenhum campo esconde o método */
+			Value receiver = _peek(ARG_COUNT);
+			if( !IS_INSTANCE(receiver) || AS_INSTANCE(receiver)->shape == NULL ) {
+				return false;
+			}
+
+			ObjInstance *instance = AS_INSTANCE(receiver);
+			if( objShapeFind(instance->shape, name) >= 0 ) {
+				return false;
+			}
+
+			Value method;
+			if( !tableGet(&instance->klass->methods, CREATE_OBJECT(name),
+						  &method) ||
+				AS_CLOSURE(method)->function->arity != ARG_COUNT ) {
+				return false;
+			}
+
+			step->shape = instance->shape;
+			step->callee = AS_CLOSURE(method);
+			return true;
+		}
+
+		case OP_RETURN:
+			/* Retornar do frame onde o loop está sai do loop */
+			return vm.frameCount > recorder.frameCount;
+
+		default:
+			if( OP >= OP_ADD_RR && OP <= OP_MOD_RRK ) {
+				return _recordRegisterOp(frame, ip);
+			}
+
+			return false;
+	}
+}
+
+/**
+ * @brief Descarta a gravação atual
+ */
+static void _recordAbort(void) {
+	JitTrace *trace = recorder.trace;
+	trace->hits = 0;
+	++trace->aborts;
+
+	recorder.trace = NULL;
+}
+
+/**
+ * @brief Guarda um objeto usado pelo código do trace, para o GC não soltá-lo
+ */
+static void _traceKeep(JitTrace *trace, Obj *object, size_t *size) {
+	for( size_t i = 0; i < trace->objectCount; i++ ) {
+		if( trace->objects[i] == object ) {
+			return;
+		}
+	}
+
+	if( trace->objectCount + 1 > *size ) {
+		const size_t OLD_SIZE = *size;
+		*size = MEM_GROW_SIZE(OLD_SIZE);
+		trace->objects = MEM_GROW_ARRAY(Obj *, trace->objects, OLD_SIZE, *size);
+	}
+
+	trace->objects[trace->objectCount++] = object;
+}
+
+/**
+ * @brief Guarda que o receptor em @a RECEIVER é uma instância com a forma
+ * gravada, deixando a instância em rax
+ *
+ * @param[out] as Montador
+ * @param[in] RECEIVER Receptor na pilha
+ * @param[in] shape Forma gravada
+ * @param[out] guards Pulos pra saída lateral
+ */
+static void _emitShapeGuard(Assembler *as, const Operand RECEIVER,
+							ObjShape *shape, size_t guards[3]) {
+	guards[0] = _guardType(as, RECEIVER, VALUE_OBJECT);
+	_movLoad(as, RAX, _payload(RECEIVER));
+
+	EMIT(as, 0x83, 0x38, OBJ_INSTANCE); /* cmp dword [rax], OBJ_INSTANCE */
+	guards[1] = _jcc(as, 0x85);			/* jne */
+
+	_movLoad(as, RCX, (Operand){RAX, offsetof(ObjInstance, shape)});
+	_movImm64(as, RDX, (uint64_t)(uintptr_t)shape);
+	EMIT(as, 0x48, 0x39, 0xd1); /* cmp rcx, rdx */
+	guards[2] = _jcc(as, 0x85); /* jne */
+}
+
+/**
+ * @brief Emite o pulo condicional gravado como uma guarda
+ *
+ * O caminho gravado segue em frente. Se o valor no topo levar para o outro
+ * lado, o interpretador continua de lá
+ */
+static void _emitBranchGuard(Assembler *as, const TraceStep *STEP) {
+	const uint16_t OFFSET = (uint16_t)(STEP->fp[1] << 8) | STEP->fp[2];
+	uint8_t *next = STEP->fp + 3;
+	uint8_t *target = next + OFFSET;
+	size_t guards[2];
+
+	/* OP_JUMP_IF_TRUE troca os dois caminhos de lugar */
+	const bool IF_TRUE = (STEP->fp[0] == OP_JUMP_IF_TRUE);
+	uint8_t *falsey = IF_TRUE ? next : target;
+	uint8_t *truthy = IF_TRUE ? target : next;
+
+	_loadType(as, _stack(-1));
+	EMIT(as, 0x85, 0xc0); /* test eax, eax */
+
+	if( STEP->taken != IF_TRUE ) {
+		/* O valor precisa ser falso */
+		const size_t IS_NIL = _jcc(as, 0x84);  /* je ok */
+		EMIT(as, 0x83, 0xf8, VALUE_BOOL);	   /* cmp eax, VALUE_BOOL */
+		guards[0] = _jcc(as, 0x85);			   /* jne exit */
+		_cmpByteZero(as, _payload(_stack(-1)));
+		guards[1] = _jcc(as, 0x85); /* jne exit */
+
+		_emitGuardExit(as, guards, 2, truthy);
+		_patch(as, IS_NIL, as->count);
+	} else {
+		/* O valor precisa ser verdadeiro */
+		guards[0] = _jcc(as, 0x84);		  /* je exit */
+		EMIT(as, 0x83, 0xf8, VALUE_BOOL); /* cmp eax, VALUE_BOOL */
+		const size_t NOT_BOOL = _jcc(as, 0x85); /* jne ok */
+		_cmpByteZero(as, _payload(_stack(-1)));
+		guards[1] = _jcc(as, 0x84); /* je exit */
+
+		_emitGuardExit(as, guards, 2, falsey);
+		_patch(as, NOT_BOOL, as->count);
+	}
+}
+
+/**
+ * @brief Emite uma chamada embutida: empilha o CallFrame da função gravada
+ *
+ * @param[out] as Montador
+ * @param[in] STEP Chamada gravada
+ * @param[in] ARG_COUNT Quantidade de argumentos
+ * @param[in] next Instrução seguinte (para onde a função retorna)
+ * @param[out] guards Pulos pra saída lateral
+ */
+static void _emitFramePush(Assembler *as, const TraceStep *STEP,
+						   const uint8_t ARG_COUNT, uint8_t *next,
+						   size_t guards[2]) {
+	ObjFunction *callee = STEP->callee->function;
+
+	/* Os mesmos limites do interpretador */
+	_movImm64(as, RAX, (uint64_t)(uintptr_t)&vm.frameCount);
+	EMIT(as, 0x80, 0x38, FRAMES_MAX); /* cmp byte [rax], FRAMES_MAX */
+	guards[0] = _jcc(as, 0x8d);		  /* jge */
+
+	_movImm64(as, RAX, (uint64_t)(uintptr_t)&vm.stack);
+	_movLoad(as, RAX, (Operand){RAX, 0});
+	_lea(as, RAX, (Operand){RAX, vm.stackMax * VALUE_SIZE});
+	_lea(as, RCX, _stack(ARG_COUNT));
+	EMIT(as, 0x48, 0x39, 0xc1); /* cmp rcx, rax */
+	guards[1] = _jcc(as, 0x87); /* ja */
+
+	_emitGuardExit(as, guards, 2, STEP->fp);
+
+	/* O frame atual retorna para a instrução seguinte */
+	_movImm64(as, RAX, (uint64_t)(uintptr_t)next);
+	_movStore(as, (Operand){RBX, offsetof(CallFrame, fp)}, RAX);
+
+	_movImm64(as, RAX, (uint64_t)(uintptr_t)&vm.frameCount);
+	EMIT(as, 0xfe, 0x00); /* inc byte [rax] */
+	EMIT(as, 0x48, 0x83, 0xc3, (uint8_t)sizeof(CallFrame)); /* add rbx, n */
+
+	_movImm64(as, RAX, (uint64_t)(uintptr_t)STEP->callee);
+	_movStore(as, (Operand){RBX, offsetof(CallFrame, closure)}, RAX);
+	_movImm64(as, RAX, (uint64_t)(uintptr_t)callee->chunk.code);
+	_movStore(as, (Operand){RBX, offsetof(CallFrame, fp)}, RAX);
+	_lea(as, R13, _stack(-ARG_COUNT - 1));
+	_movStore(as, (Operand){RBX, offsetof(CallFrame, slots)}, R13);
+	_movImm64(as, R15, (uint64_t)(uintptr_t)callee->chunk.consts.values);
+}
+
+/**
+ * @brief Emite o retorno de uma função embutida
+ *
+ * @param[out] as Montador
+ * @param[in] STEP Retorno gravado
+ * @param[in] caller Função para onde o retorno volta
+ */
+static void _emitFramePop(Assembler *as, const TraceStep *STEP,
+						  ObjFunction *caller) {
+	/* Upvalues abertos apontando para o frame ficam com o interpretador */
+	size_t guards[1];
+	_movImm64(as, RAX, (uint64_t)(uintptr_t)&vm.openUpvalues);
+	_movLoad(as, RAX, (Operand){RAX, 0});
+	EMIT(as, 0x48, 0x85, 0xc0); /* test rax, rax */
+	const size_t NO_UPVALUES = _jcc(as, 0x84); /* jz */
+	_movLoad(as, RAX, (Operand){RAX, offsetof(ObjUpvalue, location)});
+	EMIT(as, 0x4c, 0x39, 0xe8); /* cmp rax, r13 */
+	guards[0] = _jcc(as, 0x83); /* jae */
+	_emitGuardExit(as, guards, 1, STEP->fp);
+	_patch(as, NO_UPVALUES, as->count);
+
+	/* O resultado fica no lugar da função chamada */
+	_copyValue(as, (Operand){R13, 0}, _stack(-1));
+	_lea(as, R12, (Operand){R13, VALUE_SIZE});
+
+	_movImm64(as, RAX, (uint64_t)(uintptr_t)&vm.frameCount);
+	EMIT(as, 0xfe, 0x08); /* dec byte [rax] */
+	EMIT(as, 0x48, 0x83, 0xeb, (uint8_t)sizeof(CallFrame)); /* sub rbx, n */
+
+	_movLoad(as, R13, (Operand){RBX, offsetof(CallFrame, slots)});
+	_movImm64(as, R15, (uint64_t)(uintptr_t)caller->chunk.consts.values);
+}
+
+/**
+ * @brief Emite uma instrução gravada
+ *
+ * @param[out] as Montador
+ * @param[in] STEP Instrução gravada
+ * @param[in] NEXT Instrução gravada seguinte
+ */
+static void _emitStep(Assembler *as, const TraceStep *STEP,
+					  const TraceStep *NEXT) {
+	uint8_t *ip = STEP->fp;
+	const uint8_t OP = ip[0];
+	size_t guards[3] = {0, 0, 0};
+
+	switch( OP ) {
+		case OP_JUMP:
+		case OP_LOOP:
+			/* O trace é linear: o pulo já está no caminho gravado */
+			return;
+
+		case OP_JUMP_IF_FALSE:
+		case OP_JUMP_IF_TRUE:
+			_emitBranchGuard(as, STEP);
+			return;
+
+		case OP_GET_PROPERTY_16:
+		case OP_GET_PROPERTY_32:
+			_emitShapeGuard(as, _stack(-1), STEP->shape, guards);
+			_emitGuardExit(as, guards, 3, ip);
+
+			_movLoad(as, RAX, (Operand){RAX, offsetof(ObjInstance, slots)});
+			_copyValue(as, _stack(-1), (Operand){RAX, STEP->slot * VALUE_SIZE});
+			return;
+
+		case OP_SET_PROPERTY_16:
+		case OP_SET_PROPERTY_32:
+			_emitShapeGuard(as, _stack(-2), STEP->shape, guards);
+			_emitGuardExit(as, guards, 3, ip);
+
+			_emitPreBarrier(as, RAX);
+			_movLoad(as, RCX, (Operand){RAX, offsetof(ObjInstance, slots)});
+			_copyValue(as, (Operand){RCX, STEP->slot * VALUE_SIZE}, _stack(-1));
+			_emitBarrier(as, RAX);
+			_copyValue(as, _stack(-2), _stack(-1));
+			_moveTop(as, -1);
+			return;
+
+		case OP_CALL: {
+			const uint8_t ARG_COUNT = ip[1];
+			const Operand CALLEE = _stack(-ARG_COUNT - 1);
+
+			guards[0] = _guardType(as, CALLEE, VALUE_OBJECT);
+			_movLoad(as, RAX, _payload(CALLEE));
+			_movImm64(as, RCX, (uint64_t)(uintptr_t)STEP->callee);
+			EMIT(as, 0x48, 0x39, 0xc8); /* cmp rax, rcx */
+			guards[1] = _jcc(as, 0x85); /* jne */
+			_emitGuardExit(as, guards, 2, ip);
+
+			_emitFramePush(as, STEP, ARG_COUNT, ip + 2, guards);
+		}
+			return;
+
+		case OP_INVOKE_16:
+		case OP_INVOKE_32: {
+			const bool IS_16 = (OP == OP_INVOKE_16);
+			const uint8_t ARG_COUNT = ip[IS_16 ? 2 : 4];
+
+			/* A forma garante a classe e que nenhum campo esconde o método */
+			_emitShapeGuard(as, _stack(-ARG_COUNT - 1), STEP->shape, guards);
+			_emitGuardExit(as, guards, 3, ip);
+
+			_emitFramePush(as, STEP, ARG_COUNT, ip + (IS_16 ? 5 : 7), guards);
+		}
+			return;
+
+		case OP_RETURN:
+			_emitFramePop(as, STEP, NEXT->function);
+			return;
+
+		default:
+			/* O resto é igual ao código nativo de funções */
+			_emitInstruction(as, STEP->function,
+							 (size_t)(ip - STEP->function->chunk.code));
+			return;
+	}
+}
+
+/**
+ * @brief Compila o trace gravado
+ *
+ * @return Se o trace foi compilado
+ */
+static bool _traceCompile(void) {
+	JitTrace *trace = recorder.trace;
+	gcPreBarrier((Obj *)recorder.function);
+
+	/* O montador usa a memória da VM, então o GC não pode rodar no meio */
+	const bool WAS_LOCKED = vm.isLocked;
+	vm.isLocked = true;
+
+	Assembler as = {0};
+	_emitPrologue(&as, recorder.function);
+
+	const size_t LOOP = as.count;
+	size_t objectSize = 0;
+
+	for( size_t i = 0; i < recorder.count; i++ ) {
+		const TraceStep *STEP = &recorder.steps[i];
+		const TraceStep *NEXT =
+			&recorder.steps[i + 1 < recorder.count ? i + 1 : 0];
+
+		_emitStep(&as, STEP, NEXT);
+
+		if( STEP->callee != NULL ) {
+			_traceKeep(trace, (Obj *)STEP->callee, &objectSize);
+		}
+
+		if( STEP->shape != NULL ) {
+			_traceKeep(trace, (Obj *)STEP->shape, &objectSize);
+		}
+	}
+
+	/* Fim do caminho: o loop volta pro começo. Os objetos guardados podem
+	 * ser mais novos que a função */
+	_patch(&as, _jmp(&as), LOOP);
+	gcRemember((Obj *)recorder.function);
+
+	trace->code = _install(&as);
+	trace->size = as.count;
+	trace->loop = trace->code != NULL ? trace->code + LOOP : NULL;
+
+	if( trace->code == NULL ) {
+		MEM_FREE_ARRAY(Obj *, trace->objects, objectSize);
+		trace->objects = NULL;
+		trace->objectCount = 0;
+		trace->aborts = TRACE_MAX_ABORTS;
+	} else if( objectSize > trace->objectCount ) {
+		/* Encolhe o array, para que o tamanho seja sempre objectCount */
+		trace->objects = MEM_GROW_ARRAY(Obj *, trace->objects, objectSize,
+										trace->objectCount);
+	}
+
+	MEM_FREE_ARRAY(uint8_t, as.code, as.size);
+	MEM_FREE_ARRAY(JumpFixup, as.fixups, as.fixupSize);
+
+	vm.isLocked = WAS_LOCKED;
+
+	recorder.trace = NULL;
+	return trace->code != NULL;
+}
+
+/**
+ * @brief Procura o trace de um loop
+ *
+ * @return O trace, ou NULL se o loop ainda não tem um
+ */
+static JitTrace *_traceLookup(ObjFunction *function, uint8_t *header) {
+	for( JitTrace *trace = function->traces; trace != NULL;
+		 trace = trace->next ) {
+		if( trace->header == header ) {
+			return trace;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Procura o trace de um loop, criando-o se for preciso
+ */
+static JitTrace *_traceFind(ObjFunction *function, uint8_t *header) {
+	JitTrace *found = _traceLookup(function, header);
+	if( found != NULL ) {
+		return found;
+	}
+
+	JitTrace *trace = MEM_ALLOC(JitTrace, 1);
+	*trace = (JitTrace){0};
+	trace->header = header;
+	trace->hits = TRACE_THRESHOLD;
+
+	gcPreBarrier((Obj *)function);
+	trace->next = function->traces;
+	function->traces = trace;
+
+	return trace;
+}
+
+/**
+ * @brief Nível dos traces: grava, compila e executa o trace de cada loop
+ * quente
+ */
+static uint8_t *_traceHook(CallFrame *frame, uint8_t *header,
+						   const uint32_t COUNT) {
+	INTENTIONALLY_UNUSED(COUNT);
+
+	if( recorder.trace != NULL ) {
+		/* Voltou pro começo do loop gravado: o caminho está completo */
+		if( header == recorder.trace->header &&
+			vm.frameCount == recorder.frameCount ) {
+			JitTrace *trace = recorder.trace;
+			if( _traceCompile() ) {
+				return _callNative(trace->code, frame, trace->loop);
+			}
+		}
+
+		return header;
+	}
+
+	/* Funções já compiladas rodam os seus loops no código nativo */
+	ObjFunction *function = frame->closure->function;
+	if( function->jit != NULL ) {
+		return header;
+	}
+
+	JitTrace *trace = _traceFind(function, header);
+
+	if( trace->code != NULL ) {
+		return _callNative(trace->code, frame, trace->loop);
+	}
+
+	/* Depois de uma gravação abortada, espera mais um pouco até tentar de
+	 * novo
+	 */
+	if( trace->aborts < TRACE_MAX_ABORTS && ++trace->hits >= TRACE_THRESHOLD ) {
+		recorder.trace = trace;
+		recorder.function = function;
+		recorder.frameCount = vm.frameCount;
+		recorder.count = 0;
+	}
+
+	return header;
+}
+
+/**
+ * @brief Nível de OSR: compila a função de um loop quente que não conseguiu
+ * ter um trace
+ *
+ * O OP_LOOP continua no código nativo a partir do começo do loop, pela
+ * tabela de entradas da função
+ */
+static uint8_t *_osrHook(CallFrame *frame, uint8_t *header,
+						 const uint32_t COUNT) {
+	ObjFunction *function = frame->closure->function;
+
+	/* Uma compilação que falhou só é tentada de novo depois de outras
+	 * OSR_THRESHOLD voltas
+	 */
+	if( function->jit != NULL || recorder.trace != NULL ||
+		COUNT % OSR_THRESHOLD != 0 ) {
+		return header;
+	}
+
+	/* Loops com trace (ou que ainda podem ter um) ficam com o trace */
+	JitTrace *trace = _traceLookup(function, header);
+	if( trace != NULL &&
+		(trace->code != NULL || trace->aborts < TRACE_MAX_ABORTS) ) {
+		return header;
+	}
+
+	jitCompile(function);
+	return header;
+}
+
+/**
+ * @brief Nível de base: compila funções chamadas muitas vezes
+ */
+static uint8_t *_callHook(CallFrame *frame, uint8_t *fp,
+						  const uint32_t COUNT) {
+	ObjFunction *function = frame->closure->function;
+
+	if( function->jit == NULL && COUNT == JIT_THRESHOLD ) {
+		jitCompile(function);
+	}
+
+	return fp;
+}
+
+void jitInit(void) {
+	tierRegister(TIER_EVENT_CALL, JIT_THRESHOLD, _callHook);
+	tierRegister(TIER_EVENT_LOOP, TRACE_THRESHOLD, _traceHook);
+	tierRegister(TIER_EVENT_LOOP, OSR_THRESHOLD, _osrHook);
+}
+
+bool jitRecord(CallFrame *frame, uint8_t *fp) {
+	if( recorder.trace == NULL ) {
+		return false;
+	}
+
+	const int16_t DEPTH = (int16_t)(vm.frameCount - recorder.frameCount);
+	if( recorder.count == TRACE_MAX_LENGTH || DEPTH < 0 ||
+		DEPTH > TRACE_MAX_DEPTH ) {
+		_recordAbort();
+		return false;
+	}
+
+	/* Uma chamada gravada precisa ter entrado na função esperada */
+	if( recorder.count > 0 ) {
+		const TraceStep *PREVIOUS = &recorder.steps[recorder.count - 1];
+		if( PREVIOUS->callee != NULL &&
+			(frame->closure != PREVIOUS->callee ||
+			 fp != PREVIOUS->callee->function->chunk.code) ) {
+			_recordAbort();
+			return false;
+		}
+	}
+
+	TraceStep *step = &recorder.steps[recorder.count];
+	*step = (TraceStep){frame->closure->function, fp, false, NULL, 0, NULL};
+
+	if( !_recordStep(step, frame) ) {
+		_recordAbort();
+		return false;
+	}
+
+	++recorder.count;
+	return true;
+}
+
+bool jitIsRecording(void) {
+	return recorder.trace != NULL;
+}
+
+void jitStopRecording(void) {
+	if( recorder.trace != NULL ) {
+		_recordAbort();
+	}
+}
+
+void jitMarkRoots(void) {
+	if( recorder.trace == NULL ) {
+		return;
+	}
+
+	for( size_t i = 0; i < recorder.count; i++ ) {
+		gcMarkObject((Obj *)recorder.steps[i].callee);
+		gcMarkObject((Obj *)recorder.steps[i].shape);
+	}
+}
+
+void jitFreeTraces(JitTrace *trace) {
+	while( trace != NULL ) {
+		JitTrace *next = trace->next;
+
+		if( trace->code != NULL ) {
+			munmap(trace->code, trace->size);
+		}
+
+		MEM_FREE_ARRAY(Obj *, trace->objects, trace->objectCount);
+		MEM_FREE(JitTrace, trace);
+		trace = next;
+	}
+}
+
+#endif
@@ -10,8 +10,11 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "bytecode.h"
 #include "common.h"
+#include "compiler.h"
 #include "error.h"
+#include "optimizer.h"
 #include "vm.h"
 
 /**
@@ -21,6 +24,9 @@
 
 static void _runREPL(void);
 static void _runFile(const char* PATH);
+static void _compileFile(const char* PATH, const char* OUTPUT);
+static void _usage(void);
+static bool _parseOption(const char* OPTION);
 
 /**
  * @brief Ponto de entrada da linguagem
@@ -33,6 +39,12 @@ static void _runFile(const char* PATH);
 int main(int argc, const char* argv[]) {
 	vmInit();
 
+	/* As opções vêm antes do arquivo */
+	while( argc > 1 && _parseOption(argv[1]) ) {
+		--argc;
+		++argv;
+	}
+
 	if( argc == 1 ) {
 		/* Nenhum argumento foi dado.
 		 * Iniciamos uma sessão interativa
@@ -43,13 +55,14 @@ int main(int argc, const char* argv[]) {
 		 * assumimos que é uma arquivo e tentamos interpretá-lo
 		 */
 		_runFile(argv[1]);
+	} else if( (argc == 3 || argc == 4) && strcmp(argv[1], "--compile") == 0 ) {
+		/* Compila o arquivo para um .loxc, sem rodar */
+		_compileFile(argv[2], argc == 4 ? argv[3] : NULL);
 	} else {
 		/* Uma quantidade inválida de argumentos foi dada.
 		 * Sai com erro
 		 */
-		errFatal(
-			0, "Invocacao invalida. Utilize assim:\n\t~> loxiec.exe [arquivo]");
-		exit(64);
+		_usage();
 	}
 
 	vmFree();
@@ -105,10 +118,42 @@ static char* _readFile(const char* PATH) {
 	return buffer;
 }
 
+/**
+ * @brief Verifica se @a PATH termina com @a SUFFIX
+ */
+static bool _endsWith(const char* PATH, const char* SUFFIX) {
+	const size_t PATH_LEN = strlen(PATH);
+	const size_t SUFFIX_LEN = strlen(SUFFIX);
+
+	return PATH_LEN >= SUFFIX_LEN &&
+		   strcmp(PATH + PATH_LEN - SUFFIX_LEN, SUFFIX) == 0;
+}
+
 static void _runFile(const char* PATH) {
-	char* source = _readFile(PATH);
-	Result result = vmInterpret(source);
-	free(source);
+	Result result;
+
+	if( _endsWith(PATH, LOXC_EXTENSION) ) {
+		ObjFunction* function = bcLoad(PATH);
+		if( function == NULL ) {
+			exit(65);
+		}
+
+		result = vmInterpretFunction(function);
+	} else {
+		char* source = _readFile(PATH);
+#ifdef COMPILE_CACHE
+		ObjFunction* function = bcCacheLoad(source);
+		if( function == NULL && (function = compCompile(source)) != NULL ) {
+			bcCacheStore(function, source);
+		}
+
+		result = function != NULL ? vmInterpretFunction(function)
+								  : RESULT_COMPILER_ERROR;
+#else
+		result = vmInterpret(source);
+#endif
+		free(source);
+	}
 
 	if( result == RESULT_COMPILER_ERROR ) {
 		exit(65);
@@ -118,3 +163,69 @@ static void _runFile(const char* PATH) {
 		exit(64);
 	}
 }
+
+static void _compileFile(const char* PATH, const char* OUTPUT) {
+	char* source = _readFile(PATH);
+	ObjFunction* function = compCompile(source);
+	free(source);
+
+	if( function == NULL ) {
+		exit(65);
+	}
+
+	/* Sem saída, arquivo.lox vira arquivo.loxc */
+	char* output = NULL;
+	if( OUTPUT == NULL ) {
+		const size_t LEN = strlen(PATH);
+		const size_t BASE_LEN = _endsWith(PATH, ".lox") ? LEN - 4 : LEN;
+
+		output = (char*)malloc(BASE_LEN + sizeof(LOXC_EXTENSION));
+		if( output == NULL ) {
+			errFatal(0, "Sem memoria o bastante para compilar '%s'", PATH);
+			exit(74);
+		}
+
+		memcpy(output, PATH, BASE_LEN);
+		memcpy(output + BASE_LEN, LOXC_EXTENSION, sizeof(LOXC_EXTENSION));
+		OUTPUT = output;
+	}
+
+	const bool WRITTEN = bcWrite(function, OUTPUT);
+	free(output);
+
+	if( !WRITTEN ) {
+		exit(74);
+	}
+}
+
+/**
+ * @brief Mostra como invocar o programa e sai com erro
+ */
+static void _usage(void) {
+	errFatal(0,
+			 "Invocacao invalida. Utilize assim:\n\t~> loxiec.exe [-O0|-O1] "
+			 "[arquivo]\n\t~> loxiec.exe [-O0|-O1] --compile arquivo.lox "
+			 "[saida.loxc]");
+	exit(64);
+}
+
+/**
+ * @brief Trata uma opção da linha de comando
+ *
+ * @param[in] OPTION Argumento
+ * @return Se o argumento é uma opção (se for uma opção inválida, sai com erro)
+ */
+static bool _parseOption(const char* OPTION) {
+	if( strncmp(OPTION, "-O", 2) != 0 ) {
+		return false;
+	}
+
+	/* -O<nível>: nível de otimização do bytecode */
+	if( OPTION[2] < '0' || OPTION[2] > '0' + OPT_LEVEL_MAX ||
+		OPTION[3] != '\0' ) {
+		_usage();
+	}
+
+	optLevel = (uint8_t)(OPTION[2] - '0');
+	return true;
+}
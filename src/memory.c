@@ -4,25 +4,171 @@
  * @date 2024.04.01
  *
  * @brief Lida com operações relacionadas à memória
+ *
+ * Blocos grandes (LARGE_OBJECTS) ficam fora do malloc, em páginas próprias
+ * mapeadas com mmap. Crescer um bloco desses remapeia as páginas (mremap),
+ * sem copiar o conteúdo, e liberá-lo devolve as páginas na hora
+ *
+ * Com COMPACT_HEADER, todos os objetos moram em uma única região de
+ * endereços reservada no começo, para que uma referência caiba em 32 bits.
+ * As slabs e os objetos que não cabem nelas são páginas tiradas da região
  */
 
+#ifdef LARGE_OBJECTS
+/* Para o mremap */
+#define _GNU_SOURCE
+#endif
+
 #include "memory.h"
 
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(LARGE_OBJECTS) || defined(COMPACT_HEADER)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(GC_COMPACT) && defined(__GLIBC__)
+#include <malloc.h>
+#endif
 
 #include "error.h"
 #include "gc.h"
+#include "jit.h"
+#include "tier.h"
 #include "vm.h"
 
 #ifdef DEBUG_LOG_GC
 #include <stdio.h>
 #endif
 
-void *memRealloc(void *pointer, const size_t OLD_SIZE, const size_t NEW_SIZE) {
+#ifdef SLAB_ALLOC
+/** Distância entre as classes de tamanho (e alinhamento das células) */
+#define SLAB_GRANULE 16
+
+/** Maior objeto das classes de tamanho espaçadas por SLAB_GRANULE */
+#define SLAB_LINEAR_MAX 256
+
+#ifdef COMPACT_HEADER
+/*
+ * Fora das slabs, um objeto ocuparia páginas inteiras da região, então
+ * acima de SLAB_LINEAR_MAX há mais algumas classes, cada uma com o dobro do
+ * tamanho da anterior
+ */
+
+/** Maior objeto guardado nas slabs. Objetos maiores usam páginas próprias */
+#define SLAB_MAX_SIZE 2048
+
+/** Quantidade de classes de tamanho */
+#define SLAB_CLASS_COUNT (SLAB_LINEAR_MAX / SLAB_GRANULE + 3)
+#else
+/** Maior objeto guardado nas slabs. Objetos maiores usam o realloc */
+#define SLAB_MAX_SIZE SLAB_LINEAR_MAX
+
+/** Quantidade de classes de tamanho */
+#define SLAB_CLASS_COUNT (SLAB_MAX_SIZE / SLAB_GRANULE)
+#endif
+
+/** Tamanho de cada slab */
+#define SLAB_SIZE (64 * 1024)
+
+/**
+ * @brief Célula livre de uma slab (o espaço de um objeto já liberado)
+ */
+typedef struct Cell {
+	struct Cell *next; /**< Próxima célula livre da mesma classe */
+} Cell;
+
+/**
+ * @brief Bloco de memória dividido em células de uma única classe
+ */
+typedef struct Slab {
+	struct Slab *next; /**< Próxima slab (de qualquer classe) */
+} Slab;
+
+/** Células livres de cada classe de tamanho */
+static Cell *_freeCells[SLAB_CLASS_COUNT];
+
+/** Todas as slabs, liberadas só no fim do programa (ou numa compactação) */
+static Slab *_slabs = NULL;
+
+/** Bytes reservados em slabs */
+static size_t _slabBytes = 0;
+
+/** Bytes das células em uso (com o arredondamento da classe) */
+static size_t _cellBytes = 0;
+#endif
+
+#ifdef GC_COMPACT
+/** Slabs de antes da compactação, liberadas quando ela termina */
+static Slab *_oldSlabs = NULL;
+#endif
+
+#if defined(LARGE_OBJECTS) || defined(COMPACT_HEADER)
+/** Tamanho de uma página, lido na primeira alocação grande */
+static size_t _pageSize = 0;
+#endif
+
+#ifdef COMPACT_HEADER
+uint8_t *memHeapBase = NULL;
+
+/** Tamanho da região que conseguimos reservar */
+static size_t _heapSize = 0;
+
+/** Fim da parte da região que já foi usada alguma vez */
+static size_t _heapTop = 0;
+
+/**
+ * @brief Trecho de páginas livres da região
+ */
+typedef struct HeapRun {
+	struct HeapRun *next; /**< Próximo trecho livre (em ordem de endereço) */
+	size_t size;		  /**< Tamanho do trecho, em bytes */
+} HeapRun;
+
+/** Trechos livres da região, em ordem de endereço */
+static HeapRun *_heapRuns = NULL;
+#endif
+
+/**
+ * @brief Termina o programa quando não há mais memória
+ */
+static void _outOfMemory(void) {
+	/* Um erro aconteceu quando tentamos alocar mais memória
+	 * Ou a memória RAM acabou ( x _ x ) ...
+	 * ... ou um erro bisonho aconteceu.
+	 *
+	 * De qualquer forma, sai com código ERR_UNAVAILABLE
+	 */
+	errFatal(vmGetLine(0), "Nao foi possivel alocar memoria!");
+	exit(69);
+}
+
+/**
+ * @brief Conta a mudança de tamanho de um bloco e, se ele cresceu, deixa o
+ * GC trabalhar antes da memória ser alocada
+ *
+ * @param[in] OLD_SIZE Tamanho velho do bloco de memória
+ * @param[in] NEW_SIZE Tamanho novo do bloco de memória
+ */
+static void _account(const size_t OLD_SIZE, const size_t NEW_SIZE) {
 	vm.bytesAllocated += NEW_SIZE - OLD_SIZE;
 
 	if( NEW_SIZE > OLD_SIZE ) {
-#ifdef DEBUG_STRESS_GC
+#ifdef GC_LAZY_SWEEP
+		/* A memória dos objetos mortos volta antes de pedirmos mais */
+		if( vm.sweepObjects != NULL ) {
+			gcSweep(NEW_SIZE - OLD_SIZE);
+		}
+#endif
+
+#if defined(GC_PHASES)
+		/* O coletor decide se começa um ciclo, e cada passo é limitado */
+		if( !vm.isLocked ) {
+			gcStep();
+		}
+#elif defined(DEBUG_STRESS_GC)
 		if( !vm.isLocked ) {
 			gcCollect();
 		}
@@ -32,6 +178,84 @@ void *memRealloc(void *pointer, const size_t OLD_SIZE, const size_t NEW_SIZE) {
 		}
 #endif
 	}
+}
+
+#if defined(LARGE_OBJECTS) || defined(COMPACT_HEADER)
+/**
+ * @brief Arredonda @a SIZE para um múltiplo do tamanho da página
+ */
+static size_t _pageRound(const size_t SIZE) {
+	if( _pageSize == 0 ) {
+		_pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	}
+
+	return (SIZE + _pageSize - 1) & ~(_pageSize - 1);
+}
+#endif
+
+#ifdef LARGE_OBJECTS
+/**
+ * @brief Realoca um bloco que é (ou passa a ser) grande
+ *
+ * Se o bloco já estava nas próprias páginas e continua grande, as páginas
+ * são remapeadas, e o kernel move o bloco sem copiar o conteúdo
+ */
+static void *_largeRealloc(void *pointer, const size_t OLD_SIZE,
+						   const size_t NEW_SIZE) {
+	const bool WAS_LARGE = (OLD_SIZE >= LOS_THRESHOLD);
+	const bool IS_LARGE = (NEW_SIZE >= LOS_THRESHOLD);
+
+	if( !WAS_LARGE ) {
+		/* Saindo do malloc */
+		void *block = mmap(NULL, _pageRound(NEW_SIZE), PROT_READ | PROT_WRITE,
+						   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if( block == MAP_FAILED ) {
+			_outOfMemory();
+		}
+
+		if( pointer != NULL ) {
+			memcpy(block, pointer, OLD_SIZE);
+			free(pointer);
+		}
+
+		return block;
+	}
+
+	if( NEW_SIZE == 0 ) {
+		munmap(pointer, _pageRound(OLD_SIZE));
+		return NULL;
+	}
+
+	if( !IS_LARGE ) {
+		/* Voltando para o malloc */
+		void *block = malloc(NEW_SIZE);
+		if( block == NULL ) {
+			_outOfMemory();
+		}
+
+		memcpy(block, pointer, NEW_SIZE);
+		munmap(pointer, _pageRound(OLD_SIZE));
+		return block;
+	}
+
+	void *block = mremap(pointer, _pageRound(OLD_SIZE), _pageRound(NEW_SIZE),
+						 MREMAP_MAYMOVE);
+	if( block == MAP_FAILED ) {
+		_outOfMemory();
+	}
+
+	return block;
+}
+#endif
+
+void *memRealloc(void *pointer, const size_t OLD_SIZE, const size_t NEW_SIZE) {
+	_account(OLD_SIZE, NEW_SIZE);
+
+#ifdef LARGE_OBJECTS
+	if( OLD_SIZE >= LOS_THRESHOLD || NEW_SIZE >= LOS_THRESHOLD ) {
+		return _largeRealloc(pointer, OLD_SIZE, NEW_SIZE);
+	}
+#endif
 
 	if( NEW_SIZE == 0 ) {
 		/* Se o novo tamanho for 0, libere a memória, já que
@@ -43,19 +267,340 @@ void *memRealloc(void *pointer, const size_t OLD_SIZE, const size_t NEW_SIZE) {
 
 	void *result = realloc(pointer, NEW_SIZE);
 	if( result == NULL ) {
-		/* Um erro aconteceu quando tentamos alocar mais memória
-		 * Ou a memória RAM acabou ( x _ x ) ...
-		 * ... ou um erro bisonho aconteceu.
-		 *
-		 * De qualquer forma, sai com código ERR_UNAVAILABLE
-		 */
-		errFatal(vmGetLine(0), "Nao foi possivel alocar memoria!");
-		exit(69);
+		_outOfMemory();
 	}
 
 	return result;
 }
 
+#ifdef COMPACT_HEADER
+/**
+ * @brief Reserva a região dos objetos. As páginas só ocupam memória depois
+ * de usadas
+ *
+ * Se o sistema recusar o tamanho todo, tenta regiões cada vez menores, até
+ * HEAP_RESERVE_MIN. O programa só sai quando os objetos não couberem mais
+ */
+static void _heapReserve(void) {
+	void *region = MAP_FAILED;
+
+	for( size_t size = HEAP_RESERVE;
+		 region == MAP_FAILED && size >= HEAP_RESERVE_MIN; size /= 2 ) {
+		region = mmap(NULL, size, PROT_READ | PROT_WRITE,
+					  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		_heapSize = size;
+	}
+
+	if( region == MAP_FAILED ) {
+		_outOfMemory();
+	}
+
+	memHeapBase = region;
+
+	/* A primeira página nunca é usada: a referência 0 é o NULL */
+	_heapTop = _pageRound(1);
+}
+
+/**
+ * @brief Tira @a size bytes (arredondados para páginas inteiras) da região
+ */
+static void *_heapAlloc(size_t size) {
+	if( memHeapBase == NULL ) {
+		_heapReserve();
+	}
+
+	size = _pageRound(size);
+
+	/* O primeiro trecho livre grande o bastante */
+	for( HeapRun **link = &_heapRuns; *link != NULL; link = &(*link)->next ) {
+		HeapRun *run = *link;
+		if( run->size < size ) {
+			continue;
+		}
+
+		if( run->size == size ) {
+			*link = run->next;
+		} else {
+			/* O resto do trecho continua livre */
+			HeapRun *rest = (HeapRun *)((uint8_t *)run + size);
+			rest->next = run->next;
+			rest->size = run->size - size;
+			*link = rest;
+		}
+
+		return run;
+	}
+
+	if( _heapTop + size > _heapSize ) {
+		_outOfMemory();
+	}
+
+	void *block = memHeapBase + _heapTop;
+	_heapTop += size;
+	return block;
+}
+
+/**
+ * @brief Devolve um bloco tirado com _heapAlloc. As páginas voltam ao
+ * sistema, e o trecho se junta aos trechos livres vizinhos
+ */
+static void _heapFree(void *block, size_t size) {
+	size = _pageRound(size);
+	madvise(block, size, MADV_DONTNEED);
+
+	uint8_t *start = block;
+	HeapRun *previous = NULL;
+	HeapRun *next = _heapRuns;
+	while( next != NULL && (uint8_t *)next < start ) {
+		previous = next;
+		next = next->next;
+	}
+
+	if( next != NULL && start + size == (uint8_t *)next ) {
+		size += next->size;
+		next = next->next;
+	}
+
+	if( previous != NULL && (uint8_t *)previous + previous->size == start ) {
+		previous->size += size;
+		previous->next = next;
+		return;
+	}
+
+	HeapRun *run = block;
+	run->size = size;
+	run->next = next;
+	if( previous != NULL ) {
+		previous->next = run;
+	} else {
+		_heapRuns = run;
+	}
+}
+#endif
+
+#ifdef SLAB_ALLOC
+/**
+ * @brief Classe de tamanho de um objeto de @a SIZE bytes
+ */
+static size_t _classOf(const size_t SIZE) {
+	if( SIZE <= SLAB_LINEAR_MAX ) {
+		return (SIZE - 1) / SLAB_GRANULE;
+	}
+
+	size_t class = SLAB_LINEAR_MAX / SLAB_GRANULE;
+	for( size_t cell = SLAB_LINEAR_MAX * 2; cell < SIZE; cell *= 2 ) {
+		++class;
+	}
+
+	return class;
+}
+
+/**
+ * @brief Tamanho das células da classe @a CLASS
+ */
+static size_t _cellSize(const size_t CLASS) {
+	if( CLASS < SLAB_LINEAR_MAX / SLAB_GRANULE ) {
+		return (CLASS + 1) * SLAB_GRANULE;
+	}
+
+	const size_t DOUBLINGS = CLASS - SLAB_LINEAR_MAX / SLAB_GRANULE + 1;
+	return (size_t)SLAB_LINEAR_MAX << DOUBLINGS;
+}
+
+/**
+ * @brief Cria uma slab nova para a classe @a CLASS e coloca as suas células
+ * na lista de células livres
+ */
+static void _refill(const size_t CLASS) {
+#ifdef COMPACT_HEADER
+	Slab *slab = _heapAlloc(SLAB_SIZE);
+#else
+	Slab *slab = malloc(SLAB_SIZE);
+	if( slab == NULL ) {
+		_outOfMemory();
+	}
+#endif
+
+	slab->next = _slabs;
+	_slabs = slab;
+	_slabBytes += SLAB_SIZE;
+
+	/* As células começam depois do cabeçalho, mantendo o alinhamento */
+	const size_t CELL_SIZE = _cellSize(CLASS);
+	uint8_t *cells = (uint8_t *)slab + SLAB_GRANULE;
+	size_t count = (SLAB_SIZE - SLAB_GRANULE) / CELL_SIZE;
+
+	/* Empilhadas de trás pra frente, as células saem em ordem crescente */
+	while( count > 0 ) {
+		--count;
+		Cell *cell = (Cell *)(cells + count * CELL_SIZE);
+		cell->next = _freeCells[CLASS];
+		_freeCells[CLASS] = cell;
+	}
+}
+
+/**
+ * @brief Libera uma lista de slabs
+ */
+static void _freeSlabList(Slab *slab) {
+	while( slab != NULL ) {
+		Slab *next = slab->next;
+#ifdef COMPACT_HEADER
+		_heapFree(slab, SLAB_SIZE);
+#else
+		free(slab);
+#endif
+		slab = next;
+	}
+}
+
+/**
+ * @brief Libera todas as slabs
+ */
+static void _freeSlabs(void) {
+	_freeSlabList(_slabs);
+	_slabs = NULL;
+	_slabBytes = 0;
+	_cellBytes = 0;
+
+	for( size_t i = 0; i < SLAB_CLASS_COUNT; ++i ) {
+		_freeCells[i] = NULL;
+	}
+}
+
+/**
+ * @brief Tira uma célula livre da classe @a CLASS
+ */
+static void *_takeCell(const size_t CLASS) {
+	if( _freeCells[CLASS] == NULL ) {
+		_refill(CLASS);
+	}
+
+	Cell *cell = _freeCells[CLASS];
+	_freeCells[CLASS] = cell->next;
+	_cellBytes += _cellSize(CLASS);
+	return cell;
+}
+#endif
+
+void *memAllocObject(const size_t SIZE) {
+#ifdef SLAB_ALLOC
+	if( SIZE <= SLAB_MAX_SIZE ) {
+		_account(0, SIZE);
+		return _takeCell(_classOf(SIZE));
+	}
+#endif
+
+#ifdef COMPACT_HEADER
+	_account(0, SIZE);
+	return _heapAlloc(SIZE);
+#else
+	return memRealloc(NULL, 0, SIZE);
+#endif
+}
+
+/**
+ * @brief Devolve a memória de um objeto (a slab dele, ou o free)
+ *
+ * @param[in] object Objeto sendo liberado
+ * @param[in] SIZE Tamanho usado para alocar o objeto
+ */
+static void _freeObjectMemory(Obj *object, const size_t SIZE) {
+#ifdef SLAB_ALLOC
+	if( SIZE <= SLAB_MAX_SIZE ) {
+		_account(SIZE, 0);
+
+		const size_t CLASS = _classOf(SIZE);
+		Cell *cell = (Cell *)object;
+		cell->next = _freeCells[CLASS];
+		_freeCells[CLASS] = cell;
+		_cellBytes -= _cellSize(CLASS);
+		return;
+	}
+#endif
+
+#ifdef COMPACT_HEADER
+	_account(SIZE, 0);
+	_heapFree(object, SIZE);
+#else
+	memRealloc(object, SIZE, 0);
+#endif
+}
+
+/** Macro de conveniência para liberar a memória de um objeto */
+#define FREE_OBJECT(TYPE, PTR) _freeObjectMemory(PTR, sizeof(TYPE))
+
+size_t memObjectSize(Obj *object) {
+	switch( object->type ) {
+		case OBJ_STRING:
+			return sizeof(ObjString) + ((ObjString *)object)->length + 1;
+		case OBJ_UPVALUE:
+			return sizeof(ObjUpvalue);
+		case OBJ_FUNCTION:
+			return sizeof(ObjFunction);
+		case OBJ_NATIVE:
+			return sizeof(ObjNative);
+		case OBJ_CLOSURE:
+			return sizeof(ObjClosure);
+		case OBJ_CLASS:
+			return sizeof(ObjClass);
+		case OBJ_INSTANCE:
+			return sizeof(ObjInstance);
+		case OBJ_BOUND_METHOD:
+			return sizeof(ObjBoundMethod);
+		case OBJ_RANGE:
+			return sizeof(ObjRange);
+		case OBJ_ARRAY:
+			return sizeof(ObjArray);
+		case OBJ_TABLE:
+			return sizeof(ObjTable);
+		case OBJ_SHAPE:
+			return sizeof(ObjShape);
+	}
+
+	return 0;
+}
+
+#ifdef GC_COMPACT
+bool memIsFragmented(void) {
+	return _slabBytes >= GC_COMPACT_MIN_BYTES &&
+		   _cellBytes * GC_COMPACT_RATIO < _slabBytes;
+}
+
+void memBeginEvacuation(void) {
+	_oldSlabs = _slabs;
+	_slabs = NULL;
+	_slabBytes = 0;
+	_cellBytes = 0;
+
+	for( size_t i = 0; i < SLAB_CLASS_COUNT; ++i ) {
+		_freeCells[i] = NULL;
+	}
+}
+
+Obj *memEvacuate(Obj *object) {
+	const size_t SIZE = memObjectSize(object);
+	if( SIZE > SLAB_MAX_SIZE ) {
+		return object;
+	}
+
+	/* A cópia vai para as slabs novas, uma célula depois da outra */
+	Obj *copy = _takeCell(_classOf(SIZE));
+	memcpy(copy, object, SIZE);
+	return copy;
+}
+
+void memEndEvacuation(void) {
+	_freeSlabList(_oldSlabs);
+	_oldSlabs = NULL;
+
+#ifdef __GLIBC__
+	/* Devolve ao sistema as páginas que ficaram livres */
+	malloc_trim(0);
+#endif
+}
+#endif
+
 void memFreeObject(Obj *object) {
 #ifdef DEBUG_LOG_GC
 	printf("%p | Liberando objeto ", (void *)object);
@@ -66,60 +611,77 @@ void memFreeObject(Obj *object) {
 	switch( object->type ) {
 		case OBJ_STRING: {
 			ObjString *obj = (ObjString *)object;
-			obj = memRealloc(obj, sizeof(ObjString) + obj->length + 1, 0);
+			_freeObjectMemory(object, sizeof(ObjString) + obj->length + 1);
 		} break;
 
 		case OBJ_UPVALUE:
-			MEM_FREE(ObjClosure, object);
+			FREE_OBJECT(ObjUpvalue, object);
 			break;
 
 		case OBJ_FUNCTION: {
 			ObjFunction *function = (ObjFunction *)object;
+#ifdef JIT
+			jitFree(function->jit);
+			jitFreeTraces(function->traces);
+#endif
+			tierFreeCounters(function);
 			chunkFree(&function->chunk);
-			MEM_FREE(ObjFunction, object);
+			FREE_OBJECT(ObjFunction, object);
 		} break;
 
 		case OBJ_NATIVE:
-			MEM_FREE(ObjNative, object);
+			FREE_OBJECT(ObjNative, object);
 			break;
 
 		case OBJ_CLOSURE: {
 			ObjClosure *closure = (ObjClosure *)object;
 			MEM_FREE_ARRAY(ObjUpvalue *, closure->upvalues,
 						   closure->upvalueCount);
-			MEM_FREE(ObjClosure, object);
+			FREE_OBJECT(ObjClosure, object);
 		} break;
 
 		case OBJ_CLASS: {
 			ObjClass *klass = (ObjClass *)object;
 			tableFree(&klass->methods);
-			MEM_FREE(ObjClass, object);
+			FREE_OBJECT(ObjClass, object);
 		} break;
 
 		case OBJ_INSTANCE: {
 			ObjInstance *instance = (ObjInstance *)object;
-			tableFree(&instance->fields);
-			MEM_FREE(ObjInstance, object);
+			if( instance->fields != NULL ) {
+				tableFree(instance->fields);
+				MEM_FREE(Table, instance->fields);
+			}
+
+			MEM_FREE_ARRAY(Value, instance->slots, instance->slotSize);
+			FREE_OBJECT(ObjInstance, object);
 		} break;
 
 		case OBJ_BOUND_METHOD:
-			MEM_FREE(ObjBoundMethod, object);
+			FREE_OBJECT(ObjBoundMethod, object);
 			break;
 
 		case OBJ_RANGE:
-			MEM_FREE(ObjRange, object);
+			FREE_OBJECT(ObjRange, object);
 			break;
 
 		case OBJ_ARRAY: {
 			ObjArray *array = (ObjArray *)object;
 			valueArrayFree(&array->array);
-			MEM_FREE(ObjArray, object);
+			FREE_OBJECT(ObjArray, object);
 		} break;
 
 		case OBJ_TABLE: {
 			ObjTable *table = (ObjTable *)object;
 			tableFree(&table->table);
-			MEM_FREE(ObjTable, object);
+			FREE_OBJECT(ObjTable, object);
+		} break;
+
+		case OBJ_SHAPE: {
+			ObjShape *shape = (ObjShape *)object;
+			tableFree(&shape->slots);
+			tableFree(&shape->transitions);
+			FREE_OBJECT(ObjShape, object);
 		} break;
 
 		default:
@@ -129,13 +691,38 @@ void memFreeObject(Obj *object) {
 	}
 }
 
-void memFreeObjects(void) {
-	Obj *object = vm.objects;
+/**
+ * @brief Libera uma lista de objetos
+ *
+ * @param[in] object Primeiro objeto da lista
+ */
+static void _freeList(Obj *object) {
 	while( object != NULL ) {
-		Obj *next = object->next;
+		Obj *next = OBJ_NEXT(object);
 		memFreeObject(object);
 		object = next;
 	}
+}
+
+void memFreeObjects(void) {
+#ifdef GC_CONCURRENT
+	/* A thread de marcação pode estar lendo os objetos */
+	gcJoin();
+#endif
+
+	_freeList(vm.objects);
+#if defined(GC_PHASES) || defined(GC_LAZY_SWEEP)
+	_freeList(vm.sweepObjects);
+#endif
 
 	free(vm.grayStack);
+#ifdef GC_PARALLEL
+	gcStopWorkers();
+#endif
+#ifdef GC_GENERATIONAL
+	free(vm.remembered);
+#endif
+#ifdef SLAB_ALLOC
+	_freeSlabs();
+#endif
 }
@@ -13,6 +13,8 @@
 #include <time.h>
 
 #include "compiler.h"
+#include "error.h"
+#include "gc.h"
 #include "vm.h"
 
 static Value _nativeClock(const uint8_t ARG_COUNT, Value *args) {
@@ -23,9 +25,56 @@ static Value _nativeType(const uint8_t ARG_COUNT, Value *args) {
 	return CREATE_NUMBER((LOXIE_NUMBER)clock() / CLOCKS_PER_SEC);
 }
 
+static Value _nativeDeleteField(const uint8_t ARG_COUNT, Value *args) {
+	INTENTIONALLY_UNUSED(ARG_COUNT);
+
+	if( !IS_INSTANCE(args[0]) || !IS_STRING(args[1]) ) {
+		errFatal(vmGetLine(0),
+				 "apague() recebe uma instancia e o nome do campo (string)");
+		return ERROR_TYPE;
+	}
+
+	return CREATE_BOOL(
+		objInstanceDelete(AS_INSTANCE(args[0]), AS_STRING(args[1])));
+}
+
+static Value _nativeAppend(const uint8_t ARG_COUNT, Value *args) {
+	INTENTIONALLY_UNUSED(ARG_COUNT);
+
+	if( !IS_ARRAY(args[0]) ) {
+		errFatal(vmGetLine(0),
+				 "anexa() recebe um array como primeiro argumento");
+		return ERROR_TYPE;
+	}
+
+	/* Os argumentos continuam na pilha caso o array cresça e o GC rode */
+	ObjArray *array = AS_ARRAY(args[0]);
+	gcPreBarrier((Obj *)array);
+	valueArrayWrite(&array->array, args[1]);
+	gcBarrier((Obj *)array, args[1]);
+
+	return CREATE_NUMBER((LOXIE_NUMBER)array->array.count);
+}
+
+static Value _nativeCompact(const uint8_t ARG_COUNT, Value *args) {
+	INTENTIONALLY_UNUSED(ARG_COUNT);
+	INTENTIONALLY_UNUSED(args);
+
+#ifdef GC_COMPACT
+	/* Os objetos só podem ser movidos depois que a chamada terminar */
+	vm.compactPending = true;
+#else
+	gcCollect();
+#endif
+	return CREATE_NIL();
+}
+
 void nativeInit(void) {
 	nativeDefine(_nativeClock, "cronometro", 0);
 	nativeDefine(_nativeType, "tipo", 1);
+	nativeDefine(_nativeDeleteField, "apague", 2);
+	nativeDefine(_nativeAppend, "anexa", 2);
+	nativeDefine(_nativeCompact, "compacta", 0);
 }
 
 bool nativeCall(NativeFn native, const uint8_t ARG_COUNT) {
@@ -37,14 +86,24 @@ bool nativeCall(NativeFn native, const uint8_t ARG_COUNT) {
 }
 
 void nativeDefine(NativeFn native, const char *NAME, const int16_t ARGS) {
+	const bool WAS_LOCKED = vm.isLocked;
 	vm.isLocked = true;
 
-	const Value INDEX = CREATE_NUMBER((double)vm.globalValues.count);
+	/* Definir de novo (a cada compilação) reaproveita o mesmo índice, para
+	 * que os índices das globais não dependam de quantas vezes isso rodou
+	 */
+	const Value NAME_VALUE =
+		CREATE_OBJECT(objCopyString(NAME, strlen(NAME)));
+	const Value NATIVE = CREATE_OBJECT(objMakeNative(native, ARGS));
 
-	tableSet(&vm.globalNames, CREATE_OBJECT(objCopyString(NAME, strlen(NAME))),
-			 INDEX);
-	valueArrayWrite(&vm.globalValues,
-					CREATE_OBJECT(objMakeNative(native, ARGS)));
+	Value index;
+	if( tableGet(&vm.globalNames, NAME_VALUE, &index) ) {
+		vm.globalValues.values[(size_t)AS_NUMBER(index)] = NATIVE;
+	} else {
+		tableSet(&vm.globalNames, NAME_VALUE,
+				 CREATE_NUMBER((double)vm.globalValues.count));
+		valueArrayWrite(&vm.globalValues, NATIVE);
+	}
 
-	vm.isLocked = false;
+	vm.isLocked = WAS_LOCKED;
 }
@@ -12,6 +12,7 @@
 #include <string.h>
 
 #include "error.h"
+#include "gc.h"
 #include "memory.h"
 #include "table.h"
 #include "value.h"
@@ -22,12 +23,30 @@
 	(TYPE *)_allocObject(sizeof(TYPE), OBJ_TYPE)
 
 static Obj *_allocObject(const size_t SIZE, const ObjType TYPE) {
-	Obj *newObject = memRealloc(NULL, 0, SIZE);
+#ifdef GC_CONCURRENT
+	if( !vm.isLocked ) {
+		gcStartCycle();
+	}
+#endif
+
+	Obj *newObject = memAllocObject(SIZE);
 
 	newObject->type = TYPE;
+#ifdef GC_CONCURRENT
+	/* Objetos criados durante a marcação concorrente já nascem pretos */
+	newObject->isMarked = (vm.gcPhase == GC_PHASE_MARK);
+	newObject->isScanned = newObject->isMarked;
+#elif defined(GC_LAZY_SWEEP)
+	/* Fica desmarcado quando a cor mudar no começo do próximo ciclo */
+	newObject->isMarked = vm.markColor;
+	newObject->isScanned = false;
+#else
 	newObject->isMarked = false;
+	newObject->isScanned = false;
+#endif
+	newObject->isRemembered = false;
 
-	newObject->next = vm.objects;
+	OBJ_SET_NEXT(newObject, vm.objects);
 	vm.objects = newObject;
 
 #ifdef DEBUG_LOG_GC
@@ -116,6 +135,11 @@ ObjFunction *objMakeFunction(void) {
 	function->name = NULL;
 	chunkInit(&function->chunk);
 
+	function->calls = 0;
+	function->loops = NULL;
+	function->jit = NULL;
+	function->traces = NULL;
+
 	return function;
 }
 
@@ -150,6 +174,14 @@ ObjClass *objMakeClass(ObjString *name) {
 	klass->name = name;
 	klass->constructor = CREATE_NIL();
 	tableInit(&klass->methods);
+	klass->shape = NULL;
+	klass->slotHint = 0;
+
+	/* A classe ainda não está na pilha, então travamos o GC */
+	const bool WAS_LOCKED = vm.isLocked;
+	vm.isLocked = true;
+	klass->shape = objMakeShape();
+	vm.isLocked = WAS_LOCKED;
 
 	return klass;
 }
@@ -158,7 +190,20 @@ ObjInstance *objMakeInstance(ObjClass *klass) {
 	ObjInstance *instance = ALLOC_OBJECT(ObjInstance, OBJ_INSTANCE);
 
 	instance->klass = klass;
-	tableInit(&instance->fields);
+	instance->shape = klass->shape;
+	instance->slotSize = 0;
+	instance->slots = NULL;
+	instance->fields = NULL;
+
+	/* Já reservamos os campos que as instâncias desta classe costumam ter */
+	if( klass->slotHint > 0 ) {
+		const bool WAS_LOCKED = vm.isLocked;
+		vm.isLocked = true;
+		instance->slots = MEM_ALLOC(Value, klass->slotHint);
+		vm.isLocked = WAS_LOCKED;
+
+		instance->slotSize = klass->slotHint;
+	}
 
 	return instance;
 }
@@ -200,6 +245,164 @@ ObjTable *objMakeTable(void) {
 	return table;
 }
 
+ObjShape *objMakeShape(void) {
+	ObjShape *shape = ALLOC_OBJECT(ObjShape, OBJ_SHAPE);
+
+	shape->slotCount = 0;
+	tableInit(&shape->slots);
+	tableInit(&shape->transitions);
+
+	return shape;
+}
+
+int32_t objShapeFind(ObjShape *shape, ObjString *name) {
+	Value index;
+	if( !tableGet(&shape->slots, CREATE_OBJECT(name), &index) ) {
+		return -1;
+	}
+
+	return (int32_t)AS_NUMBER(index);
+}
+
+ObjShape *objShapeTransition(ObjShape *shape, ObjString *name) {
+	Value next;
+	if( tableGet(&shape->transitions, CREATE_OBJECT(name), &next) ) {
+		return AS_SHAPE(next);
+	}
+
+	/* A forma nova só fica alcançável depois de entrar nas transições */
+	const bool WAS_LOCKED = vm.isLocked;
+	vm.isLocked = true;
+
+	ObjShape *newShape = objMakeShape();
+	tableCopyTo(&shape->slots, &newShape->slots);
+	tableSet(&newShape->slots, CREATE_OBJECT(name),
+			 CREATE_NUMBER((double)shape->slotCount));
+	newShape->slotCount = shape->slotCount + 1;
+
+	gcPreBarrier((Obj *)shape);
+	tableSet(&shape->transitions, CREATE_OBJECT(name),
+			 CREATE_OBJECT(newShape));
+	gcBarrier((Obj *)shape, CREATE_OBJECT(name));
+	gcBarrier((Obj *)shape, CREATE_OBJECT(newShape));
+
+	vm.isLocked = WAS_LOCKED;
+
+	return newShape;
+}
+
+void objInstanceSetShape(ObjInstance *instance, ObjShape *shape) {
+	ObjClass *klass = instance->klass;
+	gcPreBarrier((Obj *)instance);
+
+	if( shape->slotCount > instance->slotSize ) {
+		uint32_t newSize = instance->slotSize * 2;
+		if( newSize < klass->slotHint ) {
+			newSize = klass->slotHint;
+		}
+
+		if( newSize < shape->slotCount ) {
+			newSize = shape->slotCount;
+		}
+
+		instance->slots = MEM_GROW_ARRAY(Value, instance->slots,
+										 instance->slotSize, newSize);
+		instance->slotSize = newSize;
+	}
+
+	if( shape->slotCount > klass->slotHint ) {
+		klass->slotHint = shape->slotCount;
+	}
+
+	instance->shape = shape;
+	gcBarrier((Obj *)instance, CREATE_OBJECT(shape));
+}
+
+/**
+ * @brief Passa uma instância para o modo dicionário
+ *
+ * @param[out] instance Instância que será convertida
+ */
+static void _instanceToDictionary(ObjInstance *instance) {
+	ObjShape *shape = instance->shape;
+
+	const bool WAS_LOCKED = vm.isLocked;
+	vm.isLocked = true;
+
+	Table *fields = MEM_ALLOC(Table, 1);
+	tableInit(fields);
+
+	for( size_t i = 0; i < shape->slots.size; ++i ) {
+		Entry *entry = &shape->slots.entries[i];
+		if( !IS_EMPTY(entry->key) ) {
+			const size_t SLOT = (size_t)AS_NUMBER(entry->value);
+			tableSet(fields, entry->key, instance->slots[SLOT]);
+		}
+	}
+
+	MEM_FREE_ARRAY(Value, instance->slots, instance->slotSize);
+
+	instance->shape = NULL;
+	instance->slotSize = 0;
+	instance->slots = NULL;
+	instance->fields = fields;
+
+	vm.isLocked = WAS_LOCKED;
+}
+
+bool objInstanceGet(ObjInstance *instance, ObjString *name, Value *value) {
+	if( instance->shape == NULL ) {
+		return tableGet(instance->fields, CREATE_OBJECT(name), value);
+	}
+
+	const int32_t SLOT = objShapeFind(instance->shape, name);
+	if( SLOT < 0 ) {
+		return false;
+	}
+
+	*value = instance->slots[SLOT];
+	return true;
+}
+
+void objInstanceSet(ObjInstance *instance, ObjString *name, const Value VALUE) {
+	gcPreBarrier((Obj *)instance);
+	gcBarrier((Obj *)instance, CREATE_OBJECT(name));
+	gcBarrier((Obj *)instance, VALUE);
+
+	if( instance->shape != NULL ) {
+		const int32_t SLOT = objShapeFind(instance->shape, name);
+		if( SLOT >= 0 ) {
+			instance->slots[SLOT] = VALUE;
+			return;
+		}
+
+		if( instance->shape->slotCount < SHAPE_MAX_FIELDS ) {
+			objInstanceSetShape(instance,
+								objShapeTransition(instance->shape, name));
+			instance->slots[instance->shape->slotCount - 1] = VALUE;
+			return;
+		}
+
+		_instanceToDictionary(instance);
+	}
+
+	tableSet(instance->fields, CREATE_OBJECT(name), VALUE);
+}
+
+bool objInstanceDelete(ObjInstance *instance, ObjString *name) {
+	gcPreBarrier((Obj *)instance);
+
+	if( instance->shape != NULL ) {
+		if( objShapeFind(instance->shape, name) < 0 ) {
+			return false;
+		}
+
+		_instanceToDictionary(instance);
+	}
+
+	return tableDelete(instance->fields, CREATE_OBJECT(name));
+}
+
 uint32_t hashString(const char *KEY, const size_t LENGTH) {
 	uint32_t hash = 2166136261u;
 	for( size_t i = 0; i < LENGTH; ++i ) {
@@ -215,6 +418,7 @@ ObjString *objCopyString(const char *STR, const size_t LEN) {
 
 	Value interned = tableFindString(&vm.strings, STR, LEN, hash);
 	if( !IS_EMPTY(interned) ) {
+		gcRevive(AS_OBJECT(interned));
 		return AS_STRING(interned);
 	}
 
@@ -225,9 +429,10 @@ ObjString *objCopyString(const char *STR, const size_t LEN) {
 
 	string->hash = hashString(string->str, LEN);
 
+	const bool WAS_LOCKED = vm.isLocked;
 	vm.isLocked = true;
 	tableSet(&vm.strings, CREATE_OBJECT(string), CREATE_NIL());
-	vm.isLocked = false;
+	vm.isLocked = WAS_LOCKED;
 
 	return string;
 }
@@ -278,6 +483,10 @@ void objPrint(const Value VALUE) {
 			_printTable(&AS_TABLE(VALUE)->table);
 			break;
 
+		case OBJ_SHAPE:
+			printf("forma");
+			break;
+
 		default:
 			errFatal(vmGetLine(0),
 					 "Tentou imprimir objeto de tipo desconhecido %u",
@@ -285,13 +494,19 @@ void objPrint(const Value VALUE) {
 	}
 }
 
+/** Limite de arrays e hashmaps aninhados numa comparação */
+#define EQUALS_MAX_DEPTH 256
+
+/** Arrays e hashmaps aninhados sendo comparados agora */
+static size_t _equalsDepth = 0;
+
 static bool _arrayEquals(const ValueArray *A, const ValueArray *B) {
 	if( A->count != B->count ) {
 		return false;
 	}
 
 	for( size_t idx = 0; idx < A->count; ++idx ) {
-		if( !valueEquals(A->values[idx], A->values[idx]) ) {
+		if( !valueEquals(A->values[idx], B->values[idx]) ) {
 			return false;
 		}
 	}
@@ -314,7 +529,42 @@ static bool _tableEquals(const Table *A, const Table *B) {
 	return true;
 }
 
+/**
+ * @brief Compara dois arrays ou dois hashmaps pelo conteúdo
+ *
+ * Um objeto é igual a si mesmo sem olhar o conteúdo. Dois arrays diferentes
+ * que contêm a si mesmos desceriam para sempre, então a comparação para, com
+ * erro, depois de EQUALS_MAX_DEPTH níveis
+ *
+ * @param[in] A Primeiro array ou hashmap
+ * @param[in] B Segundo objeto, do mesmo tipo que @a A
+ * @return Se @a A e @a B têm o mesmo conteúdo
+ */
+static bool _containerEquals(const Value A, const Value B) {
+	if( AS_OBJECT(A) == AS_OBJECT(B) ) {
+		return true;
+	}
+
+	if( _equalsDepth >= EQUALS_MAX_DEPTH ) {
+		errFatal(vmGetLine(0), "Estruturas aninhadas demais para comparar");
+		return false;
+	}
+
+	++_equalsDepth;
+	const bool EQUALS =
+		OBJECT_TYPE(A) == OBJ_ARRAY
+			? _arrayEquals(&AS_ARRAY(A)->array, &AS_ARRAY(B)->array)
+			: _tableEquals(&AS_TABLE(A)->table, &AS_TABLE(B)->table);
+	--_equalsDepth;
+
+	return EQUALS;
+}
+
 bool objEquals(const Value A, const Value B) {
+	if( OBJECT_TYPE(A) != OBJECT_TYPE(B) ) {
+		return false;
+	}
+
 	switch( OBJECT_TYPE(A) ) {
 		case OBJ_STRING:
 		case OBJ_UPVALUE:
@@ -324,16 +574,15 @@ bool objEquals(const Value A, const Value B) {
 		case OBJ_CLASS:
 		case OBJ_INSTANCE:
 		case OBJ_BOUND_METHOD:
+		case OBJ_SHAPE:
 			return AS_OBJECT(A) == AS_OBJECT(B);
 
 		case OBJ_RANGE:
 			return false;
 
 		case OBJ_ARRAY:
-			return _arrayEquals(&AS_ARRAY(A)->array, &AS_ARRAY(B)->array);
-
 		case OBJ_TABLE:
-			return _tableEquals(&AS_TABLE(A)->table, &AS_TABLE(B)->table);
+			return _containerEquals(A, B);
 
 		default:
 			errFatal(vmGetLine(0),
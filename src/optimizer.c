@@ -0,0 +1,642 @@
+/**
+ * @file optimizer.c
+ * @author Pedro B.
+ * @date 2026.10.16
+ *
+ * @brief Otimizador <i>peephole</i> do bytecode
+ *
+ * O código é decodificado em um array de instruções. As passadas só marcam
+ * instruções como removidas ou trocam o alvo/OpCode dos pulos, e repetem
+ * até nada mudar. Depois, as sequências que têm uma superinstrução são
+ * juntadas. No fim, as instruções que sobraram são copiadas para o começo do
+ * código, e os offsets dos pulos e as linhas são refeitos
+ */
+
+#include "optimizer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "opcodes.h"
+
+/** Quantidade máxima de rodadas das passadas em uma chunk */
+#define OPT_MAX_ROUNDS 16
+
+/** Índice que não aponta para nenhuma instrução */
+#define NO_INSTRUCTION SIZE_MAX
+
+uint8_t optLevel = OPT_LEVEL_DEFAULT;
+
+/**
+ * @brief Struct representando uma instrução decodificada
+ */
+typedef struct Instruction {
+	size_t offset;		/**< Offset no código original */
+	size_t length;		/**< Tamanho, incluindo os operandos */
+	size_t target;		/**< Índice da instrução alvo (se for um pulo) */
+	size_t newOffset;	/**< Offset no código otimizado */
+	size_t line;		/**< Linha de código de onde a instrução veio */
+	size_t fusedLength; /**< Tamanho da superinstrução que começa nela */
+	uint8_t op;			/**< OpCode */
+	uint8_t fusedOp;	/**< Superinstrução que começa nela */
+	bool isLive;		/**< Se a instrução continua no código */
+	bool isFused;		/**< Se foi juntada à superinstrução de outra */
+	bool isTarget;		/**< Se algum pulo pode chegar nela */
+	bool isReached;		/**< Se é alcançável a partir do começo da função */
+} Instruction;
+
+/**
+ * @brief Struct representando uma chunk sendo otimizada
+ */
+typedef struct Optimizer {
+	Instruction *code; /**< Instruções, na ordem do código */
+	size_t count;	   /**< Quantidade de instruções */
+	size_t *work;	   /**< Pilha de instruções a visitar */
+} Optimizer;
+
+#ifdef OPT_SUPERINSTRUCTIONS
+/**
+ * @brief Struct representando uma superinstrução
+ */
+typedef struct Superinstruction {
+	uint8_t op;					  /**< OpCode da superinstrução */
+	uint8_t count;				  /**< Quantidade de instruções juntadas */
+	uint8_t ops[SUPER_MAX_COUNT]; /**< Instruções juntadas, em ordem */
+} Superinstruction;
+
+#define SUPER_ENTRY(NAME, LENGTH, COUNT, ...) {NAME, COUNT, {__VA_ARGS__}},
+
+/** Superinstruções, das maiores para as menores */
+static const Superinstruction SUPERINSTRUCTION_TABLE[] = {
+	SUPERINSTRUCTIONS(SUPER_ENTRY)};
+
+#undef SUPER_ENTRY
+#endif
+
+static bool _isJump(const uint8_t OP) {
+	return OP == OP_JUMP || OP == OP_JUMP_IF_FALSE || OP == OP_JUMP_IF_TRUE ||
+		   OP == OP_LOOP;
+}
+
+static bool _isConditional(const uint8_t OP) {
+	return OP == OP_JUMP_IF_FALSE || OP == OP_JUMP_IF_TRUE;
+}
+
+/**
+ * @brief Se a instrução só empilha um valor, sem nenhum outro efeito
+ */
+static bool _isPurePush(const uint8_t OP) {
+	switch( OP ) {
+		case OP_CONST_16:
+		case OP_CONST_32:
+		case OP_TRUE:
+		case OP_FALSE:
+		case OP_NIL:
+		case OP_GET_LOCAL_16:
+		case OP_GET_LOCAL_32:
+		case OP_GET_UPVALUE_16:
+		case OP_GET_UPVALUE_32:
+		case OP_DUP:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+/**
+ * @brief Primeira instrução que continua no código a partir de @a index
+ *
+ * @return O índice da instrução, ou @a OPT->count se não houver nenhuma
+ */
+static size_t _resolve(const Optimizer *OPT, size_t index) {
+	while( index < OPT->count && !OPT->code[index].isLive ) {
+		++index;
+	}
+
+	return index;
+}
+
+/**
+ * @brief Instrução que roda depois de @a INDEX, se ela não pular
+ */
+static size_t _next(const Optimizer *OPT, const size_t INDEX) {
+	return _resolve(OPT, INDEX + 1);
+}
+
+/**
+ * @brief Remove uma instrução. Os pulos que chegavam nela passam a chegar na
+ * instrução seguinte
+ */
+static void _kill(Optimizer *opt, const size_t INDEX) {
+	opt->code[INDEX].isLive = false;
+
+	const size_t NEXT = _next(opt, INDEX);
+	if( opt->code[INDEX].isTarget && NEXT < opt->count ) {
+		opt->code[NEXT].isTarget = true;
+	}
+}
+
+/**
+ * @brief Verifica se o pulo @a FROM consegue chegar em @a TO com um offset
+ * de 16 bits (no código original, que só diminui depois)
+ */
+static bool _canJump(const Optimizer *OPT, const size_t FROM, const size_t TO) {
+	const Instruction *JUMP = &OPT->code[FROM];
+	const size_t END = JUMP->offset + JUMP->length;
+	const size_t DEST = OPT->code[TO].offset;
+
+	if( TO > FROM ) {
+		return JUMP->op != OP_LOOP && DEST - END <= UINT16_MAX;
+	}
+
+	return (JUMP->op == OP_JUMP || JUMP->op == OP_LOOP) &&
+		   END - DEST <= UINT16_MAX;
+}
+
+/**
+ * @brief Decodifica o código da chunk
+ *
+ * @return Se o código só tem instruções e pulos que o otimizador entende
+ */
+static bool _decode(Optimizer *opt, Chunk *chunk) {
+	size_t *index = malloc(sizeof(size_t) * chunk->count);
+	if( index == NULL ) {
+		return false;
+	}
+
+	for( size_t i = 0; i < chunk->count; ++i ) {
+		index[i] = NO_INSTRUCTION;
+	}
+
+	bool ok = true;
+	for( size_t offset = 0; offset < chunk->count; ) {
+		const size_t LENGTH = chunkInstructionLength(chunk, offset);
+		if( LENGTH == 0 || offset + LENGTH > chunk->count ||
+			chunk->code[offset] == OP_BREAK ) {
+			ok = false;
+			break;
+		}
+
+		index[offset] = opt->count;
+		opt->code[opt->count++] = (Instruction){
+			.offset = offset,
+			.length = LENGTH,
+			.target = NO_INSTRUCTION,
+			.line = chunkGetLine(chunk, offset),
+			.op = chunk->code[offset],
+			.isLive = true,
+		};
+
+		offset += LENGTH;
+	}
+
+	for( size_t i = 0; ok && i < opt->count; ++i ) {
+		Instruction *instr = &opt->code[i];
+		if( !_isJump(instr->op) ) {
+			continue;
+		}
+
+		const uint8_t *IP = chunk->code + instr->offset;
+		const size_t JUMP = (size_t)((IP[1] << 8) | IP[2]);
+		const size_t END = instr->offset + instr->length;
+
+		if( instr->op == OP_LOOP ? JUMP > END : END + JUMP >= chunk->count ) {
+			ok = false;
+			break;
+		}
+
+		const size_t TARGET = instr->op == OP_LOOP ? END - JUMP : END + JUMP;
+		instr->target = index[TARGET];
+		ok = (instr->target != NO_INSTRUCTION);
+	}
+
+	free(index);
+	return ok;
+}
+
+/**
+ * @brief Marca as instruções que são alvo de algum pulo
+ */
+static void _markTargets(Optimizer *opt) {
+	for( size_t i = 0; i < opt->count; ++i ) {
+		opt->code[i].isTarget = false;
+	}
+
+	for( size_t i = 0; i < opt->count; ++i ) {
+		if( opt->code[i].isLive && _isJump(opt->code[i].op) ) {
+			const size_t TARGET = _resolve(opt, opt->code[i].target);
+			if( TARGET < opt->count ) {
+				opt->code[TARGET].isTarget = true;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Faz pulos que chegam em outros pulos irem direto pro destino final
+ *
+ * Um OP_JUMP que acaba indo para trás vira OP_LOOP. Um pulo condicional que
+ * chega em outro pulo condicional já sabe o resultado do segundo, já que o
+ * valor testado continua na pilha
+ *
+ * @return Se algum pulo mudou
+ */
+static bool _threadJumps(Optimizer *opt) {
+	bool changed = false;
+
+	for( size_t i = 0; i < opt->count; ++i ) {
+		Instruction *jump = &opt->code[i];
+		if( !jump->isLive || !_isJump(jump->op) ) {
+			continue;
+		}
+
+		const size_t FIRST = _resolve(opt, jump->target);
+		size_t target = FIRST;
+
+		for( size_t hops = 0; hops < opt->count && target < opt->count;
+			 ++hops ) {
+			const Instruction *NEXT_JUMP = &opt->code[target];
+
+			size_t next = NO_INSTRUCTION;
+			if( NEXT_JUMP->op == OP_JUMP || NEXT_JUMP->op == OP_LOOP ) {
+				next = _resolve(opt, NEXT_JUMP->target);
+			} else if( _isConditional(jump->op) &&
+					   _isConditional(NEXT_JUMP->op) ) {
+				next = NEXT_JUMP->op == jump->op
+						   ? _resolve(opt, NEXT_JUMP->target)
+						   : _next(opt, target);
+			}
+
+			if( next >= opt->count || next == target || next == i ||
+				!_canJump(opt, i, next) ) {
+				break;
+			}
+
+			target = next;
+		}
+
+		if( target >= opt->count ) {
+			continue;
+		}
+
+		jump->target = target;
+		opt->code[target].isTarget = true;
+
+		if( target != FIRST ) {
+			if( jump->op == OP_JUMP && target < i ) {
+				jump->op = OP_LOOP;
+			}
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+/**
+ * @brief Troca sequências curtas de instruções por outras mais baratas
+ *
+ * - Um valor empilhado sem efeito (constante, local, OP_DUP...) seguido de
+ * OP_POP some junto com ele
+ * - OP_NOT seguido de um pulo condicional some, e o pulo é invertido, desde
+ * que os dois caminhos do pulo só retirem o valor da pilha
+ *
+ * @return Se alguma instrução mudou
+ */
+static bool _peephole(Optimizer *opt) {
+	bool changed = false;
+
+	for( size_t i = _resolve(opt, 0); i < opt->count; i = _next(opt, i) ) {
+		const size_t NEXT = _next(opt, i);
+		if( NEXT >= opt->count || opt->code[NEXT].isTarget ) {
+			continue;
+		}
+
+		Instruction *first = &opt->code[i];
+		Instruction *second = &opt->code[NEXT];
+
+		if( _isPurePush(first->op) && second->op == OP_POP ) {
+			_kill(opt, NEXT);
+			_kill(opt, i);
+			changed = true;
+		} else if( first->op == OP_NOT && _isConditional(second->op) ) {
+			const size_t FALL = _next(opt, NEXT);
+			const size_t TARGET = _resolve(opt, second->target);
+
+			if( FALL < opt->count && TARGET < opt->count &&
+				opt->code[FALL].op == OP_POP &&
+				opt->code[TARGET].op == OP_POP ) {
+				second->op = second->op == OP_JUMP_IF_FALSE ? OP_JUMP_IF_TRUE
+															: OP_JUMP_IF_FALSE;
+				_kill(opt, i);
+				changed = true;
+			}
+		}
+	}
+
+	return changed;
+}
+
+/**
+ * @brief Remove as instruções que não são alcançáveis a partir do começo da
+ * função (o código depois de um 'retorne', por exemplo)
+ *
+ * @return Se alguma instrução foi removida
+ */
+static bool _removeDeadCode(Optimizer *opt) {
+	for( size_t i = 0; i < opt->count; ++i ) {
+		opt->code[i].isReached = false;
+	}
+
+	size_t workCount = 0;
+	const size_t START = _resolve(opt, 0);
+	if( START < opt->count ) {
+		opt->code[START].isReached = true;
+		opt->work[workCount++] = START;
+	}
+
+	while( workCount > 0 ) {
+		const size_t INDEX = opt->work[--workCount];
+		const Instruction *INSTR = &opt->code[INDEX];
+
+		size_t successors[2] = {NO_INSTRUCTION, NO_INSTRUCTION};
+		if( _isJump(INSTR->op) ) {
+			successors[0] = _resolve(opt, INSTR->target);
+		}
+		if( INSTR->op != OP_RETURN && INSTR->op != OP_JUMP &&
+			INSTR->op != OP_LOOP ) {
+			successors[1] = _next(opt, INDEX);
+		}
+
+		for( uint8_t s = 0; s < 2; ++s ) {
+			if( successors[s] < opt->count &&
+				!opt->code[successors[s]].isReached ) {
+				opt->code[successors[s]].isReached = true;
+				opt->work[workCount++] = successors[s];
+			}
+		}
+	}
+
+	bool changed = false;
+	for( size_t i = 0; i < opt->count; ++i ) {
+		if( opt->code[i].isLive && !opt->code[i].isReached ) {
+			opt->code[i].isLive = false;
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+/**
+ * @brief Remove os pulos para a instrução logo depois deles
+ *
+ * @return Se algum pulo foi removido
+ */
+static bool _removeEmptyJumps(Optimizer *opt) {
+	bool changed = false;
+
+	for( size_t i = 0; i < opt->count; ++i ) {
+		const Instruction *JUMP = &opt->code[i];
+		if( JUMP->isLive && _isJump(JUMP->op) && JUMP->op != OP_LOOP &&
+			_resolve(opt, JUMP->target) == _next(opt, i) ) {
+			_kill(opt, i);
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+#ifdef OPT_SUPERINSTRUCTIONS
+/**
+ * @brief Se a instrução pode levantar um erro em tempo de execução
+ */
+static bool _canFail(const uint8_t OP) {
+	switch( OP ) {
+		case OP_GET_GLOBAL_16:
+		case OP_SET_GLOBAL_16:
+		case OP_GREATER:
+		case OP_GREATER_EQUAL:
+		case OP_LESS:
+		case OP_LESS_EQUAL:
+		case OP_ADD:
+		case OP_SUB:
+		case OP_MUL:
+		case OP_DIV:
+		case OP_MOD:
+		case OP_NEGATE:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+/**
+ * @brief Verifica se a sequência de @a SUPER começa em @a INDEX
+ *
+ * Só as instruções seguidas que nenhum pulo alcança (além da primeira)
+ * podem ser juntadas. As que podem levantar um erro também precisam estar
+ * na linha da primeira, que é a linha da superinstrução
+ */
+static bool _matches(const Optimizer *OPT, const size_t INDEX,
+					 const Superinstruction *SUPER) {
+	const size_t LINE = OPT->code[INDEX].line;
+	size_t at = INDEX;
+
+	for( uint8_t i = 0; i < SUPER->count; ++i ) {
+		if( at >= OPT->count ) {
+			return false;
+		}
+
+		const Instruction *PART = &OPT->code[at];
+		if( PART->op != SUPER->ops[i] ) {
+			return false;
+		}
+		if( i > 0 && (PART->isTarget ||
+					  (_canFail(PART->op) && PART->line != LINE)) ) {
+			return false;
+		}
+
+		at = _next(OPT, at);
+	}
+
+	return true;
+}
+
+/**
+ * @brief Junta as sequências de instruções que têm uma superinstrução
+ *
+ * Vai da esquerda pra direita, usando a primeira superinstrução (a maior)
+ * que encaixa. A primeira instrução da sequência guarda a superinstrução, e
+ * as outras saem do código, mas continuam no array para o _rewrite
+ *
+ * @return Se alguma sequência foi juntada
+ */
+static bool _fuse(Optimizer *opt) {
+	const size_t SUPER_COUNT =
+		sizeof(SUPERINSTRUCTION_TABLE) / sizeof(SUPERINSTRUCTION_TABLE[0]);
+	bool changed = false;
+
+	for( size_t i = _resolve(opt, 0); i < opt->count; i = _next(opt, i) ) {
+		for( size_t s = 0; s < SUPER_COUNT; ++s ) {
+			const Superinstruction *SUPER = &SUPERINSTRUCTION_TABLE[s];
+			if( !_matches(opt, i, SUPER) ) {
+				continue;
+			}
+
+			Instruction *first = &opt->code[i];
+			first->fusedOp = SUPER->op;
+			first->fusedLength = first->length;
+
+			size_t at = i;
+			for( uint8_t part = 1; part < SUPER->count; ++part ) {
+				at = _next(opt, at);
+				opt->code[at].isLive = false;
+				opt->code[at].isFused = true;
+				first->fusedLength += opt->code[at].length - 1;
+			}
+
+			changed = true;
+			break;
+		}
+	}
+
+	return changed;
+}
+#endif
+
+/**
+ * @brief Escreve o offset de um pulo já movido para o código novo
+ *
+ * @param[in] OPT Otimizador
+ * @param[in] JUMP Instrução de pulo
+ * @param[out] operand Onde o offset é escrito
+ * @param[in] END Offset logo depois do operando, de onde o pulo parte
+ */
+static void _writeJump(const Optimizer *OPT, const Instruction *JUMP,
+					   uint8_t *operand, const size_t END) {
+	const size_t DEST = OPT->code[_resolve(OPT, JUMP->target)].newOffset;
+	const size_t OFFSET = JUMP->op == OP_LOOP ? END - DEST : DEST - END;
+
+	operand[0] = (OFFSET >> 8) & 0xff;
+	operand[1] = OFFSET & 0xff;
+}
+
+/**
+ * @brief Escreve as instruções que sobraram no lugar do código original, e
+ * refaz os offsets dos pulos e a tabela de linhas
+ *
+ * Uma superinstrução é escrita com os operandos de cada instrução que ela
+ * junta, em ordem. Os pulos dentro dela partem do fim do próprio operando
+ */
+static void _rewrite(Optimizer *opt, Chunk *chunk) {
+	size_t count = 0;
+	for( size_t i = 0; i < opt->count; ++i ) {
+		const Instruction *INSTR = &opt->code[i];
+		if( INSTR->isLive ) {
+			opt->code[i].newOffset = count;
+			count += INSTR->fusedLength > 0 ? INSTR->fusedLength
+											 : INSTR->length;
+		}
+
+		/* Todo pulo precisa chegar em uma instrução que sobrou */
+		if( (INSTR->isLive || INSTR->isFused) && _isJump(INSTR->op) &&
+			_resolve(opt, INSTR->target) >= opt->count ) {
+			return;
+		}
+	}
+
+	/* O código só diminui, então a cópia nunca passa por cima do que ainda
+	 * não foi lido
+	 */
+	chunk->lineCount = 0;
+	for( size_t i = 0; i < opt->count; ++i ) {
+		const Instruction *INSTR = &opt->code[i];
+		if( !INSTR->isLive ) {
+			continue;
+		}
+
+		uint8_t *ip = chunk->code + INSTR->newOffset;
+		if( INSTR->fusedLength > 0 ) {
+			/* As partes vêm logo depois da primeira, entre as removidas */
+			ip[0] = INSTR->fusedOp;
+			size_t at = 1;
+
+			for( size_t j = i;
+				 j < opt->count && (j == i || !opt->code[j].isLive); ++j ) {
+				const Instruction *PART = &opt->code[j];
+				if( j != i && !PART->isFused ) {
+					continue;
+				}
+
+				memmove(ip + at, chunk->code + PART->offset + 1,
+						PART->length - 1);
+				at += PART->length - 1;
+
+				if( _isJump(PART->op) ) {
+					_writeJump(opt, PART, ip + at - 2, INSTR->newOffset + at);
+				}
+			}
+		} else {
+			memmove(ip, chunk->code + INSTR->offset, INSTR->length);
+			ip[0] = INSTR->op;
+
+			if( _isJump(INSTR->op) ) {
+				_writeJump(opt, INSTR, ip + 1,
+						   INSTR->newOffset + INSTR->length);
+			}
+		}
+
+		if( chunk->lineCount == 0 ||
+			chunk->lines[chunk->lineCount - 1].line != INSTR->line ) {
+			LineStart *line = &chunk->lines[chunk->lineCount++];
+			line->offset = INSTR->newOffset;
+			line->line = INSTR->line;
+		}
+	}
+
+	chunk->count = count;
+}
+
+void optChunk(Chunk *chunk) {
+	if( optLevel == 0 || chunk->count == 0 || chunk->isMapped ) {
+		return;
+	}
+
+	Optimizer opt = {0};
+	opt.code = malloc(sizeof(Instruction) * chunk->count);
+	opt.work = malloc(sizeof(size_t) * chunk->count);
+
+	if( opt.code != NULL && opt.work != NULL && _decode(&opt, chunk) ) {
+		bool changed = false;
+
+		for( uint8_t round = 0; round < OPT_MAX_ROUNDS; ++round ) {
+			_markTargets(&opt);
+
+			bool roundChanged = _threadJumps(&opt);
+			roundChanged |= _peephole(&opt);
+			roundChanged |= _removeDeadCode(&opt);
+			roundChanged |= _removeEmptyJumps(&opt);
+
+			if( !roundChanged ) {
+				break;
+			}
+			changed = true;
+		}
+
+#ifdef OPT_SUPERINSTRUCTIONS
+		_markTargets(&opt);
+		changed |= _fuse(&opt);
+#endif
+
+		if( changed ) {
+			_rewrite(&opt, chunk);
+		}
+	}
+
+	free(opt.code);
+	free(opt.work);
+}
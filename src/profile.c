@@ -0,0 +1,156 @@
+/**
+ * @file profile.c
+ * @author Pedro B.
+ * @date 2026.10.16
+ *
+ * @brief Perfil das sequências de instruções executadas
+ */
+
+#include "profile.h"
+
+#ifdef DEBUG_PROFILE_OPS
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/** Tamanho inicial da tabela de contagens */
+#define PROFILE_INITIAL_SIZE 4096
+
+/**
+ * @brief Struct representando a contagem de uma sequência
+ *
+ * A chave guarda o tamanho da sequência nos bits de cima e os OpCodes, um
+ * por byte, nos de baixo. A chave 0 marca uma entrada vazia
+ */
+typedef struct ProfileEntry {
+	uint64_t key;	/**< Tamanho e OpCodes da sequência */
+	uint64_t count; /**< Vezes que a sequência foi executada */
+} ProfileEntry;
+
+static ProfileEntry *entries = NULL; /**< Tabela de contagens */
+static size_t entryCount = 0;		 /**< Entradas ocupadas */
+static size_t entrySize = 0;		 /**< Tamanho da tabela */
+
+static uint8_t window[PROFILE_MAX_GRAM]; /**< Últimas instruções seguidas */
+static uint8_t windowCount = 0;			 /**< Instruções na janela */
+static const uint8_t *nextIp = NULL;	 /**< Onde a próxima instrução
+											seguida começaria */
+
+static ProfileEntry *_find(ProfileEntry *table, const size_t SIZE,
+						   const uint64_t KEY) {
+	size_t index = (size_t)((KEY * 0x9E3779B97F4A7C15ull) >> 32) & (SIZE - 1);
+
+	while( table[index].key != 0 && table[index].key != KEY ) {
+		index = (index + 1) & (SIZE - 1);
+	}
+
+	return &table[index];
+}
+
+static void _grow(void) {
+	const size_t SIZE = entrySize == 0 ? PROFILE_INITIAL_SIZE : entrySize * 2;
+	ProfileEntry *table = calloc(SIZE, sizeof(ProfileEntry));
+	if( table == NULL ) {
+		fprintf(stderr, "Sem memoria para o perfil das instrucoes\n");
+		exit(74);
+	}
+
+	for( size_t i = 0; i < entrySize; ++i ) {
+		if( entries[i].key != 0 ) {
+			*_find(table, SIZE, entries[i].key) = entries[i];
+		}
+	}
+
+	free(entries);
+	entries = table;
+	entrySize = SIZE;
+}
+
+static void _count(const uint8_t LENGTH) {
+	uint32_t ops = 0;
+	for( uint8_t i = windowCount - LENGTH; i < windowCount; ++i ) {
+		ops = (ops << 8) | window[i];
+	}
+	const uint64_t KEY = ((uint64_t)LENGTH << 32) | ops;
+
+	if( (entryCount + 1) * 4 > entrySize * 3 ) {
+		_grow();
+	}
+
+	ProfileEntry *entry = _find(entries, entrySize, KEY);
+	if( entry->key == 0 ) {
+		entry->key = KEY;
+		++entryCount;
+	}
+	++entry->count;
+}
+
+/**
+ * @brief Escreve as contagens, uma sequência por linha: a contagem e os
+ * OpCodes (em números), separados por espaços
+ */
+static void _dump(void) {
+	const char *PATH = getenv("LOXIE_PROFILE");
+	FILE *file = PATH != NULL && PATH[0] != '\0' ? fopen(PATH, "a") : stderr;
+	if( file == NULL ) {
+		fprintf(stderr, "Nao foi possivel abrir o arquivo de perfil '%s'\n",
+				PATH);
+		return;
+	}
+
+	for( size_t i = 0; i < entrySize; ++i ) {
+		const uint64_t KEY = entries[i].key;
+		if( KEY == 0 ) {
+			continue;
+		}
+
+		fprintf(file, "%llu", (unsigned long long)entries[i].count);
+
+		const uint8_t LENGTH = (uint8_t)(KEY >> 32);
+		for( uint8_t j = LENGTH; j > 0; --j ) {
+			fprintf(file, " %u", (unsigned)((KEY >> (8 * (j - 1))) & 0xFF));
+		}
+		fprintf(file, "\n");
+	}
+
+	if( file != stderr ) {
+		fclose(file);
+	}
+
+	free(entries);
+	entries = NULL;
+	entryCount = entrySize = 0;
+}
+
+void profInit(void) {
+	static bool isRegistered = false;
+
+	if( !isRegistered ) {
+		atexit(_dump);
+		isRegistered = true;
+	}
+}
+
+void profInstruction(Chunk *chunk, const uint8_t *IP) {
+	if( IP != nextIp ) {
+		windowCount = 0;
+	}
+
+	if( windowCount == PROFILE_MAX_GRAM ) {
+		for( uint8_t i = 1; i < PROFILE_MAX_GRAM; ++i ) {
+			window[i - 1] = window[i];
+		}
+		--windowCount;
+	}
+	window[windowCount++] = *IP;
+
+	for( uint8_t length = 1; length <= windowCount; ++length ) {
+		_count(length);
+	}
+
+	const size_t LENGTH =
+		chunkInstructionLength(chunk, (size_t)(IP - chunk->code));
+	nextIp = LENGTH > 0 ? IP + LENGTH : NULL;
+}
+
+#endif
@@ -12,6 +12,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "gc.h"
 #include "memory.h"
 #include "object.h"
 #include "value.h"
@@ -50,6 +51,81 @@ static uint32_t _hashNumber(const LOXIE_NUMBER KEY) {
 #endif
 }
 
+/**
+ * @brief Obtém a hash de um valor dentro de um array ou hashmap
+ *
+ * Arrays e hashmaps aninhados entram só com o tamanho, sem descer no
+ * conteúdo: um array que contém a si mesmo não faz a hash recursar para
+ * sempre. Valores iguais continuam com a mesma hash
+ *
+ * @param[in] VALUE Valor guardado no array ou hashmap
+ * @return Hash rasa de @a VALUE
+ */
+static uint32_t _hashElement(const Value VALUE) {
+	if( IS_ARRAY(VALUE) ) {
+		return (uint32_t)AS_ARRAY(VALUE)->array.count;
+	} else if( IS_TABLE(VALUE) ) {
+		return (uint32_t)AS_TABLE(VALUE)->table.count;
+	}
+
+	return tableHashValue(VALUE);
+}
+
+/**
+ * @brief Obtém a hash de um objeto
+ *
+ * Precisa acompanhar objEquals: objetos iguais têm a mesma hash. Strings
+ * usam a hash calculada na criação, e arrays e hashmaps, que são comparados
+ * pelo conteúdo, juntam as hashes (rasas) dos seus valores. Os outros
+ * objetos são comparados pela identidade, então a hash vem do endereço.
+ *
+ * Como a hash de um array ou hashmap depende do conteúdo, mudar um que já é
+ * chave de um hashmap deixa a entrada no lugar errado: ela só é achada de
+ * novo se o conteúdo voltar ao que era
+ *
+ * @param[in] object Objeto a partir do qual a hash será gerada
+ * @return Hash do objeto @a object
+ */
+static uint32_t _hashObject(Obj *object) {
+	switch( object->type ) {
+		case OBJ_STRING:
+			return ((ObjString *)object)->hash;
+
+		case OBJ_ARRAY: {
+			const ValueArray *ARRAY = &((ObjArray *)object)->array;
+
+			uint32_t hash = (uint32_t)ARRAY->count;
+			for( size_t i = 0; i < ARRAY->count; ++i ) {
+				hash = hash * 31 + _hashElement(ARRAY->values[i]);
+			}
+
+			return hash;
+		}
+
+		case OBJ_TABLE: {
+			const Table *TABLE = &((ObjTable *)object)->table;
+
+			/* Soma, para a ordem das entradas não mudar a hash */
+			uint32_t hash = (uint32_t)TABLE->count;
+			for( size_t i = 0; i < TABLE->size; ++i ) {
+				const Entry *ENTRY = &TABLE->entries[i];
+				if( !IS_ENTRY_EMPTY(ENTRY) ) {
+					hash += _hashElement(ENTRY->key) * 31 +
+							_hashElement(ENTRY->value);
+				}
+			}
+
+			return hash;
+		}
+
+		default: {
+			/* Os 4 bits de baixo são sempre zero (alinhamento) */
+			const uintptr_t ADDRESS = (uintptr_t)object >> 4;
+			return (uint32_t)(ADDRESS ^ (ADDRESS >> 32));
+		}
+	}
+}
+
 uint32_t tableHashValue(const Value VALUE) {
 #ifdef NAN_BOXING
 	if( IS_BOOL(VALUE) ) {
@@ -59,7 +135,7 @@ uint32_t tableHashValue(const Value VALUE) {
 	} else if( IS_NUMBER(VALUE) ) {
 		return _hashNumber(AS_NUMBER(VALUE));
 	} else if( IS_OBJECT(VALUE) ) {
-		return AS_STRING(VALUE)->hash;
+		return _hashObject(AS_OBJECT(VALUE));
 	} else {
 #else
 	switch( GET_TYPE(VALUE) ) {
@@ -72,7 +148,7 @@ uint32_t tableHashValue(const Value VALUE) {
 		case VALUE_NUMBER:
 			return _hashNumber(AS_NUMBER(VALUE));
 		case VALUE_OBJECT:
-			return AS_STRING(VALUE)->hash;
+			return _hashObject(AS_OBJECT(VALUE));
 		default:
 #endif
 		return 0;
@@ -144,14 +220,17 @@ Value tableFindString(Table *table, const char *STR, const size_t LEN,
 	uint32_t index = HASH & (table->size - 1);
 	while( true ) {
 		Entry *entry = &table->entries[index];
-		if( IS_ENTRY_EMPTY(entry) && IS_NIL(entry->value) ) {
-			return CREATE_EMPTY();
-		}
-
-		ObjString *key = AS_STRING(entry->key);
-		if( key->length == LEN && key->hash == HASH &&
-			memcmp(key->str, STR, LEN) == 0 ) {
-			return entry->key;
+		if( IS_ENTRY_EMPTY(entry) ) {
+			/* Lápides (strings coletadas) não param a busca */
+			if( IS_NIL(entry->value) ) {
+				return CREATE_EMPTY();
+			}
+		} else {
+			ObjString *key = AS_STRING(entry->key);
+			if( key->length == LEN && key->hash == HASH &&
+				memcmp(key->str, STR, LEN) == 0 ) {
+				return entry->key;
+			}
 		}
 
 		index = (index + 1) & (table->size - 1);
@@ -219,7 +298,7 @@ void tableCopyTo(Table *from, Table *to) {
 void tableRemoveWhite(Table *table) {
 	for( size_t i = 0; i < table->size; i++ ) {
 		Entry *entry = &table->entries[i];
-		if( !IS_ENTRY_EMPTY(entry) && !AS_STRING(entry->key)->obj.isMarked ) {
+		if( !IS_ENTRY_EMPTY(entry) && !GC_IS_MARKED(&AS_STRING(entry->key)->obj) ) {
 			tableDelete(table, entry->key);
 		}
 	}
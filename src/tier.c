@@ -0,0 +1,102 @@
+/**
+ * @file tier.c
+ * @author Pedro B.
+ * @date 2026.10.16
+ *
+ * @brief Níveis de execução: contadores de calor e ganchos para subir de
+ * nível
+ */
+
+#include "tier.h"
+
+#include <string.h>
+
+#include "memory.h"
+
+/**
+ * @brief Struct representando um nível de execução registrado
+ */
+typedef struct Tier {
+	TierEvent event;	/**< Evento observado */
+	uint32_t threshold; /**< Limite do contador */
+	TierHook hook;		/**< Gancho */
+} Tier;
+
+static Tier tiers[TIER_MAX];  /**< Níveis, na ordem de registro */
+static uint8_t tierCount = 0; /**< Quantidade de níveis */
+
+uint32_t tierThresholds[TIER_EVENT_COUNT] = {UINT32_MAX, UINT32_MAX};
+
+void tierRegister(const TierEvent EVENT, const uint32_t THRESHOLD,
+				  TierHook hook) {
+	for( uint8_t i = 0; i < tierCount; ++i ) {
+		if( tiers[i].hook == hook ) {
+			return;
+		}
+	}
+
+	if( tierCount == TIER_MAX ) {
+		return;
+	}
+
+	tiers[tierCount++] = (Tier){EVENT, THRESHOLD, hook};
+
+	if( THRESHOLD < tierThresholds[EVENT] ) {
+		tierThresholds[EVENT] = THRESHOLD;
+	}
+}
+
+/**
+ * @brief Chama os ganchos de um evento, até um deles mudar onde a execução
+ * continua
+ */
+static uint8_t *_notify(const TierEvent EVENT, CallFrame *frame, uint8_t *fp,
+						const uint32_t COUNT) {
+	for( uint8_t i = 0; i < tierCount; ++i ) {
+		if( tiers[i].event != EVENT || COUNT < tiers[i].threshold ) {
+			continue;
+		}
+
+		uint8_t *next = tiers[i].hook(frame, fp, COUNT);
+		if( next != fp ) {
+			return next;
+		}
+	}
+
+	return fp;
+}
+
+uint8_t *tierCall(CallFrame *frame) {
+	ObjFunction *function = frame->closure->function;
+	return _notify(TIER_EVENT_CALL, frame, frame->fp, function->calls);
+}
+
+uint8_t *tierLoop(CallFrame *frame, uint8_t *header) {
+	ObjFunction *function = frame->closure->function;
+	Chunk *chunk = &function->chunk;
+
+	/* Um contador por offset do bytecode, alocado na primeira volta */
+	if( function->loops == NULL ) {
+		uint32_t *loops = MEM_ALLOC(uint32_t, chunk->count);
+		memset(loops, 0, sizeof(uint32_t) * chunk->count);
+		function->loops = loops;
+	}
+
+	uint32_t *counter = &function->loops[header - chunk->code];
+	if( *counter < UINT32_MAX ) {
+		++*counter;
+	}
+
+	if( *counter < tierThresholds[TIER_EVENT_LOOP] ) {
+		return header;
+	}
+
+	return _notify(TIER_EVENT_LOOP, frame, header, *counter);
+}
+
+void tierFreeCounters(ObjFunction *function) {
+	if( function->loops != NULL ) {
+		MEM_FREE_ARRAY(uint32_t, function->loops, function->chunk.count);
+		function->loops = NULL;
+	}
+}
@@ -8,6 +8,7 @@
 
 #include "value.h"
 
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -21,6 +22,10 @@ bool valueEquals(const Value A, const Value B) {
 		return AS_NUMBER(A) == AS_NUMBER(B);
 	}
 
+	if( IS_OBJECT(A) && IS_OBJECT(B) ) {
+		return objEquals(A, B);
+	}
+
 	return A == B;
 #else
 	if( GET_TYPE(A) != GET_TYPE(B) ) {
@@ -56,8 +61,10 @@ void valuePrint(Value value) {
 		printf("%g", AS_NUMBER(value));
 	} else if( IS_OBJECT(value) ) {
 		objPrint(value);
+	} else if( IS_EMPTY(value) ) {
+		printf("empty");
 	} else {
-		errFatal(vmGetLine(0), "Valor desconhecido %064x", value);
+		errFatal(vmGetLine(0), "Valor desconhecido %016" PRIx64, value);
 	}
 #else
 	switch( GET_TYPE(value) ) {
@@ -14,6 +14,7 @@ void valueArrayInit(ValueArray* array) {
 	array->count = 0;
 	array->size = 0;
 	array->values = NULL;
+	array->hasObjects = false;
 }
 
 void valueArrayFree(ValueArray* array) {
@@ -31,5 +32,8 @@ void valueArrayWrite(ValueArray* array, Value value) {
 	}
 
 	array->values[array->count] = value;
+	if( IS_OBJECT(value) ) {
+		array->hasObjects = true;
+	}
 	++array->count;
 }
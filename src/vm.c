@@ -13,13 +13,18 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "bytecode.h"
 #include "compiler.h"
 #include "debug.h"
 #include "error.h"
+#include "gc.h"
+#include "jit.h"
 #include "memory.h"
 #include "native.h"
 #include "object.h"
 #include "opcodes.h"
+#include "profile.h"
+#include "tier.h"
 #include "value.h"
 
 /**
@@ -59,6 +64,11 @@
  */
 #define READ_GLOBAL_32() (vm.globalValues.values[READ_24()])
 
+/**
+ * @brief Lê o índice 16-bit de um cache em linha e retorna o cache
+ */
+#define READ_CACHE() (&frame->closure->function->chunk.caches[READ_16()])
+
 /**
  * @brief Interpreta a próxima constante 8-bit como uma string
  */
@@ -69,13 +79,26 @@
  */
 #define READ_STRING_32() (AS_STRING(READ_CONST_32()))
 
+/**
+ * @brief Troca a instrução atual (sem operandos) por @a OP no bytecode
+ */
+#ifdef QUICKENING
+#define QUICKEN(OP) (*(fp - 1) = (OP))
+#else
+#define QUICKEN(OP) ((void)0)
+#endif
+
 /**
  * @brief Realiza um operação binária com os dois itens no topo da pilha
  *
+ * Como a operação só aceita números, a instrução é trocada pela versão
+ * especializada @a QUICK_OP
+ *
  * @param TYPE Tipo de valor usado na operação
  * @param OPERATOR Operação (uma de +, -, *, /) que será realizada
+ * @param QUICK_OP Instrução especializada em números
  */
-#define BINARY_OP(TYPE, OPERATOR)                                  \
+#define BINARY_OP(TYPE, OPERATOR, QUICK_OP)                        \
 	do {                                                           \
 		if( !IS_NUMBER(_peek(0)) || !IS_NUMBER(_peek(1)) ) {       \
 			RUNTIME_ERROR("Ambos os operandos devem ser numeros"); \
@@ -84,8 +107,96 @@
 		double b = AS_NUMBER(vmPop());                             \
 		double a = AS_NUMBER(vmPop());                             \
 		vmPush(TYPE(a OPERATOR b));                                \
+		QUICKEN(QUICK_OP);                                         \
 	} while( false )
 
+/**
+ * @brief Volta a instrução atual para a versão genérica @a OP e a executa
+ *
+ * Não usa do-while, já que NEXT() pode ser um break (switch)
+ */
+#define DEOPT(OP)       \
+	{                   \
+		*(--fp) = (OP); \
+		NEXT();         \
+	}
+
+/**
+ * @brief Operação binária especializada em números
+ *
+ * Se algum dos operandos não for um número, a instrução é desfeita
+ *
+ * @param TYPE Tipo de valor usado na operação
+ * @param OPERATOR Operação que será realizada
+ * @param GENERIC_OP Instrução genérica
+ */
+#define BINARY_OP_NUM(TYPE, OPERATOR, GENERIC_OP)                       \
+	{                                                                   \
+		const Value B = vm.stackTop[-1];                                \
+		const Value A = vm.stackTop[-2];                                \
+		if( !IS_NUMBER(A) || !IS_NUMBER(B) ) {                          \
+			DEOPT(GENERIC_OP);                                          \
+		}                                                               \
+		vm.stackTop[-2] = TYPE(AS_NUMBER(A) OPERATOR AS_NUMBER(B));     \
+		--vm.stackTop;                                                  \
+	}
+
+/**
+ * @brief Lê o índice 8-bit de uma local e retorna seu valor
+ */
+#define READ_REG() (frame->slots[READ_8()])
+
+/**
+ * @brief Operação binária de registradores, empilhando o resultado
+ *
+ * Se os dois operandos forem números, @a RESULT é calculado usando @a a e
+ * @a b. Se não, cai no caminho lento da instrução genérica @a GENERIC_OP
+ *
+ * @param RESULT Expressão que calcula o resultado a partir de @a a e @a b
+ * @param GENERIC_OP Instrução genérica equivalente
+ * @param READ_B Macro que lê o segundo operando (local ou constante)
+ */
+#define REGISTER_OP(RESULT, GENERIC_OP, READ_B)                  \
+	{                                                            \
+		const Value A = READ_REG();                              \
+		const Value B = READ_B();                                \
+		if( IS_NUMBER(A) && IS_NUMBER(B) ) {                     \
+			const double a = AS_NUMBER(A);                       \
+			const double b = AS_NUMBER(B);                       \
+			vmPush(RESULT);                                      \
+		} else {                                                 \
+			frame->fp = fp;                                      \
+			if( !_registerOpSlow(GENERIC_OP, A, B) ) {           \
+				return RESULT_RUNTIME_ERROR;                     \
+			}                                                    \
+		}                                                        \
+	}
+
+/**
+ * @brief Operação binária de registradores, guardando o resultado em uma local
+ *
+ * @param RESULT Expressão que calcula o resultado a partir de @a a e @a b
+ * @param GENERIC_OP Instrução genérica equivalente
+ * @param READ_B Macro que lê o segundo operando (local ou constante)
+ */
+#define REGISTER_STORE_OP(RESULT, GENERIC_OP, READ_B)            \
+	{                                                            \
+		Value *dst = &READ_REG();                                \
+		const Value A = READ_REG();                              \
+		const Value B = READ_B();                                \
+		if( IS_NUMBER(A) && IS_NUMBER(B) ) {                     \
+			const double a = AS_NUMBER(A);                       \
+			const double b = AS_NUMBER(B);                       \
+			*dst = RESULT;                                       \
+		} else {                                                 \
+			frame->fp = fp;                                      \
+			if( !_registerOpSlow(GENERIC_OP, A, B) ) {           \
+				return RESULT_RUNTIME_ERROR;                     \
+			}                                                    \
+			*dst = vmPop();                                      \
+		}                                                        \
+	}
+
 /**
  * @brief Levanta um erro durante a interpretação
  */
@@ -105,6 +216,251 @@
 		_runtimeError();                            \
 	} while( false )
 
+/*
+ * Despacho das instruções
+ *
+ * Com COMPUTED_GOTO, cada tratador pula direto pro próximo através de uma
+ * tabela de endereços (labels-as-values do GCC/Clang). Assim, cada OpCode
+ * ganha seu próprio desvio indireto, que o processador consegue prever
+ * bem melhor do que o único desvio compartilhado de um switch
+ *
+ * Sem COMPUTED_GOTO (ou em compiladores que não o suportam), usamos o switch
+ * portátil
+ */
+#if defined(COMPUTED_GOTO) && !defined(__GNUC__)
+#undef COMPUTED_GOTO
+#endif
+
+#ifdef COMPUTED_GOTO
+
+/** Pula para o tratador da próxima instrução (pela tabela atual, que é
+ * trocada enquanto um trace é gravado) */
+#define DISPATCH() goto *dispatch[READ_8()];
+
+/** Declara o tratador de um OpCode */
+#define CASE(OP) LABEL_##OP
+
+/** Tratador de OpCodes desconhecidos */
+#define CASE_UNKNOWN LABEL_UNKNOWN
+
+#if defined(DEBUG_TRACE_EXECUTION) || defined(DEBUG_PROFILE_OPS)
+/* Volta pro topo do loop, para que o estado da VM seja impresso (ou a
+ * instrução seja contada) */
+#define NEXT() continue
+#else
+#define NEXT() DISPATCH()
+#endif
+
+#else
+
+#define DISPATCH() switch( READ_8() )
+#define CASE(OP) case OP
+#define CASE_UNKNOWN default
+#define NEXT() break
+
+#endif
+
+/**
+ * @brief Continua a execução no código nativo do frame atual, se houver
+ *
+ * O código nativo devolve a instrução onde o interpretador deve continuar
+ */
+#ifdef JIT
+#define JIT_ENTER()                                        \
+	do {                                                   \
+		if( frame->closure->function->jit != NULL ) {      \
+			fp = jitEnter(frame, fp);                      \
+			if( fp == NULL ) {                             \
+				return RESULT_RUNTIME_ERROR;               \
+			}                                              \
+		}                                                  \
+	} while( false )
+#else
+#define JIT_ENTER() ((void)0)
+#endif
+
+/**
+ * @brief Liga ou desliga a gravação de traces no laço do interpretador
+ *
+ * Com COMPUTED_GOTO, a tabela de despacho é trocada por uma onde todo OpCode
+ * passa antes pelo gravador, então o laço não paga nada fora da gravação
+ */
+#if !defined(JIT)
+#define JIT_RECORDING(ON) ((void)0)
+#elif defined(COMPUTED_GOTO)
+#define JIT_RECORDING(ON) (dispatch = (ON) ? recordTable : dispatchTable)
+#else
+#define JIT_RECORDING(ON) (recording = (ON))
+#endif
+
+/**
+ * @brief Conta uma volta do loop em @a fp, se algum nível de execução
+ * observa loops
+ *
+ * O nível pode trocar a execução de lugar (um trace, ou o código nativo da
+ * função no meio do loop), e o interpretador continua onde ele mandar,
+ * possivelmente em outro frame
+ */
+#define HOT_LOOP()                                 \
+	do {                                           \
+		if( tierIsObserved(TIER_EVENT_LOOP) ) {    \
+			frame->fp = fp;                        \
+			fp = tierLoop(frame, fp);              \
+			if( fp == NULL ) {                     \
+				return RESULT_RUNTIME_ERROR;       \
+			}                                      \
+                                                   \
+			frame = &vm.frames[vm.frameCount - 1]; \
+			JIT_RECORDING(jitIsRecording());       \
+		}                                          \
+	} while( false )
+
+/*
+ * Passos das superinstruções
+ *
+ * Cada passo faz o mesmo que o tratador da instrução original, lendo os
+ * operandos dela na sequência, mas sem QUICKEN: a superinstrução não tem
+ * para onde ser especializada, então os números ficam no caminho rápido e o
+ * resto cai no caminho genérico. Um pulo tomado sai da superinstrução com
+ * NEXT() (por isso os passos não usam do-while)
+ */
+#define SUPER_STEP(OP) SUPER_STEP_##OP
+
+/**
+ * @brief Passo de uma operação binária que só aceita números
+ */
+#define SUPER_BINARY(TYPE, OPERATOR)                                \
+	{                                                               \
+		const Value B = vm.stackTop[-1];                            \
+		const Value A = vm.stackTop[-2];                            \
+		if( !IS_NUMBER(A) || !IS_NUMBER(B) ) {                      \
+			RUNTIME_ERROR("Ambos os operandos devem ser numeros");  \
+			return RESULT_RUNTIME_ERROR;                            \
+		}                                                           \
+		vm.stackTop[-2] = TYPE(AS_NUMBER(A) OPERATOR AS_NUMBER(B)); \
+		--vm.stackTop;                                              \
+	}
+
+#define SUPER_STEP_OP_CONST_16 vmPush(READ_CONST_16());
+#define SUPER_STEP_OP_TRUE vmPush(CREATE_BOOL(true));
+#define SUPER_STEP_OP_FALSE vmPush(CREATE_BOOL(false));
+#define SUPER_STEP_OP_NIL vmPush(CREATE_NIL());
+#define SUPER_STEP_OP_POP vmPop();
+#define SUPER_STEP_OP_DUP vmPush(_peek(0));
+#define SUPER_STEP_OP_GET_LOCAL_16 vmPush(frame->slots[READ_8()]);
+#define SUPER_STEP_OP_SET_LOCAL_16 frame->slots[READ_8()] = _peek(0);
+#define SUPER_STEP_OP_GET_UPVALUE_16 \
+	vmPush(*frame->closure->upvalues[READ_8()]->location);
+
+#define SUPER_STEP_OP_GET_GLOBAL_16               \
+	{                                             \
+		const Value VALUE = READ_GLOBAL_16();     \
+		if( IS_EMPTY(VALUE) ) {                   \
+			RUNTIME_ERROR("Variavel indefinida"); \
+			return RESULT_RUNTIME_ERROR;          \
+		}                                         \
+		vmPush(VALUE);                            \
+	}
+
+#define SUPER_STEP_OP_SET_GLOBAL_16                     \
+	{                                                   \
+		const uint8_t INDEX = READ_8();                 \
+		if( IS_EMPTY(vm.globalValues.values[INDEX]) ) { \
+			RUNTIME_ERROR("Variavel indefinida");       \
+			return RESULT_RUNTIME_ERROR;                \
+		}                                               \
+		vm.globalValues.values[INDEX] = _peek(0);       \
+	}
+
+#define SUPER_STEP_OP_EQUAL                     \
+	{                                           \
+		const Value A = vmPop();                \
+		const Value B = vmPop();                \
+		vmPush(CREATE_BOOL(valueEquals(A, B))); \
+	}
+
+#define SUPER_STEP_OP_GREATER SUPER_BINARY(CREATE_BOOL, >)
+#define SUPER_STEP_OP_GREATER_EQUAL SUPER_BINARY(CREATE_BOOL, >=)
+#define SUPER_STEP_OP_LESS SUPER_BINARY(CREATE_BOOL, <)
+#define SUPER_STEP_OP_LESS_EQUAL SUPER_BINARY(CREATE_BOOL, <=)
+#define SUPER_STEP_OP_SUB SUPER_BINARY(CREATE_NUMBER, -)
+#define SUPER_STEP_OP_MUL SUPER_BINARY(CREATE_NUMBER, *)
+#define SUPER_STEP_OP_DIV SUPER_BINARY(CREATE_NUMBER, /)
+
+#define SUPER_STEP_OP_ADD                                                 \
+	{                                                                     \
+		const Value B = vm.stackTop[-1];                                  \
+		const Value A = vm.stackTop[-2];                                  \
+		if( IS_NUMBER(A) && IS_NUMBER(B) ) {                              \
+			vm.stackTop[-2] = CREATE_NUMBER(AS_NUMBER(A) + AS_NUMBER(B)); \
+			--vm.stackTop;                                                \
+		} else if( IS_STRING(A) && IS_STRING(B) ) {                       \
+			_concatenate();                                               \
+		} else {                                                          \
+			RUNTIME_ERROR("Operandos devem ser dois numeros ou duas "     \
+						  "strings");                                     \
+			return RESULT_RUNTIME_ERROR;                                  \
+		}                                                                 \
+	}
+
+#define SUPER_STEP_OP_MOD                                                  \
+	{                                                                      \
+		const Value B = vm.stackTop[-1];                                   \
+		const Value A = vm.stackTop[-2];                                   \
+		if( !IS_NUMBER(A) || !IS_NUMBER(B) ) {                             \
+			RUNTIME_ERROR("Ambos os operandos devem ser numeros");         \
+			return RESULT_RUNTIME_ERROR;                                   \
+		}                                                                  \
+		vm.stackTop[-2] = CREATE_NUMBER(fmod(AS_NUMBER(A), AS_NUMBER(B))); \
+		--vm.stackTop;                                                     \
+	}
+
+#define SUPER_STEP_OP_NEGATE                                            \
+	{                                                                   \
+		if( !IS_NUMBER(_peek(0)) ) {                                    \
+			RUNTIME_ERROR("Impossivel negar algo que nao e um numero"); \
+			return RESULT_RUNTIME_ERROR;                                \
+		}                                                               \
+		vm.stackTop[-1] = CREATE_NUMBER(-AS_NUMBER(vm.stackTop[-1]));   \
+	}
+
+#define SUPER_STEP_OP_NOT \
+	vm.stackTop[-1] = CREATE_BOOL(_isFalsey(vm.stackTop[-1]));
+
+#define SUPER_STEP_OP_JUMP_IF_FALSE        \
+	{                                      \
+		const uint16_t OFFSET = READ_16(); \
+		if( _isFalsey(_peek(0)) ) {        \
+			fp += OFFSET;                  \
+			NEXT();                        \
+		}                                  \
+	}
+
+#define SUPER_STEP_OP_JUMP_IF_TRUE         \
+	{                                      \
+		const uint16_t OFFSET = READ_16(); \
+		if( !_isFalsey(_peek(0)) ) {       \
+			fp += OFFSET;                  \
+			NEXT();                        \
+		}                                  \
+	}
+
+#define SUPER_STEP_OP_JUMP                 \
+	{                                      \
+		const uint16_t OFFSET = READ_16(); \
+		fp += OFFSET;                      \
+		NEXT();                            \
+	}
+
+#define SUPER_STEP_OP_LOOP                 \
+	{                                      \
+		const uint16_t OFFSET = READ_16(); \
+		fp -= OFFSET;                      \
+		HOT_LOOP();                        \
+		JIT_ENTER();                       \
+		NEXT();                            \
+	}
+
 VM vm = {0}; /**< Instância global da máquina virtual */
 
 /**
@@ -131,6 +487,7 @@ static bool _isFalsey(Value value) {
 }
 
 static void _concatenate(void) {
+	const bool WAS_LOCKED = vm.isLocked;
 	vm.isLocked = true;
 
 	ObjString *strB = AS_STRING(vmPop());
@@ -146,14 +503,27 @@ static void _concatenate(void) {
 	result->str[LENGTH] = '\0';
 	result->hash = hashString(result->str, LENGTH);
 
-	tableSet(&vm.strings, CREATE_OBJECT(result), CREATE_NIL());
+	/* Se a string já existe, a nova vira lixo (que morre jovem). Guardar
+	 * cópias com a mesma hash deixaria as buscas na tabela lineares */
+	Value interned =
+		tableFindString(&vm.strings, result->str, LENGTH, result->hash);
+	if( IS_EMPTY(interned) ) {
+		tableSet(&vm.strings, CREATE_OBJECT(result), CREATE_NIL());
+	} else {
+		result = AS_STRING(interned);
+		gcRevive((Obj *)result);
+	}
 
-	vm.isLocked = false;
+	vm.isLocked = WAS_LOCKED;
 
 	vmPush(CREATE_OBJECT(result));
 }
 
 static void _runtimeError(void) {
+#ifdef JIT
+	jitStopRecording();
+#endif
+
 	if( vm.stackTop > &vm.stack[vm.stackMax] ) {
 		fprintf(stderr, COLOR_RED "\nSTACK OVERFLOW!" COLOR_RESET
 								  "Variaveis de mais. Funcao recursiva?");
@@ -187,6 +557,40 @@ static void _runtimeError(void) {
 	_resetStack();
 }
 
+/**
+ * @brief Caminho lento das instruções de registradores
+ *
+ * Executa a operação genérica @a OP quando algum operando não é um número,
+ * empilhando o resultado
+ *
+ * @param[in] OP Operação binária genérica
+ * @param[in] a Primeiro operando
+ * @param[in] b Segundo operando
+ *
+ * @return Se a operação foi bem-sucedida
+ */
+static bool _registerOpSlow(const OpCode OP, Value a, Value b) {
+	if( OP == OP_EQUAL ) {
+		vmPush(CREATE_BOOL(valueEquals(a, b)));
+		return true;
+	}
+
+	if( OP == OP_ADD ) {
+		if( IS_STRING(a) && IS_STRING(b) ) {
+			vmPush(a);
+			vmPush(b);
+			_concatenate();
+			return true;
+		}
+
+		RUNTIME_ERROR_F("Operandos devem ser dois numeros ou duas strings");
+		return false;
+	}
+
+	RUNTIME_ERROR_F("Ambos os operandos devem ser numeros");
+	return false;
+}
+
 static bool _call(ObjClosure *closure, const uint8_t ARG_COUNT) {
 	CallFrame *frame = &vm.frames[vm.frameCount++];
 
@@ -205,6 +609,13 @@ static bool _call(ObjClosure *closure, const uint8_t ARG_COUNT) {
 	frame->fp = closure->function->chunk.code;
 	frame->slots = vm.stackTop - ARG_COUNT - 1;
 
+	/* Só avisa depois que o frame está pronto, já que subir de nível aloca */
+	ObjFunction *function = closure->function;
+	if( function->calls < UINT32_MAX &&
+		tierIsHot(TIER_EVENT_CALL, ++function->calls) ) {
+		return tierCall(frame) != NULL;
+	}
+
 	return true;
 }
 
@@ -222,7 +633,12 @@ static bool _callValue(Value callee, const uint8_t ARG_COUNT) {
 					return false;
 				}
 
-				return nativeCall(AS_NATIVE_FN(callee), ARG_COUNT);
+				if( !nativeCall(AS_NATIVE_FN(callee), ARG_COUNT) ) {
+					_runtimeError();
+					return false;
+				}
+
+				return true;
 			}
 
 			case OBJ_CLASS: {
@@ -288,8 +704,10 @@ static ObjUpvalue *_captureUpvalue(Value *local) {
 static void _closeUpvalues(Value *last) {
 	while( vm.openUpvalues != NULL && vm.openUpvalues->location >= last ) {
 		ObjUpvalue *upvalue = vm.openUpvalues;
+		gcPreBarrier((Obj *)upvalue);
 		upvalue->closed = *upvalue->location;
 		upvalue->location = &upvalue->closed;
+		gcBarrier((Obj *)upvalue, upvalue->closed);
 
 		vm.openUpvalues = upvalue->next;
 	}
@@ -298,7 +716,9 @@ static void _closeUpvalues(Value *last) {
 static void _defineMethod(ObjString *name) {
 	Value method = _peek(0);
 	ObjClass *klass = AS_CLASS(_peek(1));
+	gcPreBarrier((Obj *)klass);
 	tableSet(&klass->methods, CREATE_OBJECT(name), method);
+	gcBarrier((Obj *)klass, method);
 
 	if( name == klass->name ) {
 		klass->constructor = method;
@@ -307,6 +727,17 @@ static void _defineMethod(ObjString *name) {
 	vmPop();
 }
 
+/**
+ * @brief Troca o receptor no topo da pilha por um método capturado
+ *
+ * @param[in] method Método que será capturado junto do receptor
+ */
+static void _pushBoundMethod(Value method) {
+	ObjBoundMethod *bound = objMakeBoundMethod(_peek(0), AS_CLOSURE(method));
+	vmPop();
+	vmPush(CREATE_OBJECT(bound));
+}
+
 static bool _bindMethod(ObjClass *klass, ObjString *name) {
 	Value method;
 	if( !tableGet(&klass->methods, CREATE_OBJECT(name), &method) ) {
@@ -314,9 +745,7 @@ static bool _bindMethod(ObjClass *klass, ObjString *name) {
 		return false;
 	}
 
-	ObjBoundMethod *bound = objMakeBoundMethod(_peek(0), AS_CLOSURE(method));
-	vmPop();
-	vmPush(CREATE_OBJECT(bound));
+	_pushBoundMethod(method);
 	return true;
 }
 
@@ -331,7 +760,179 @@ static bool _invokeFromClass(ObjClass *klass, ObjString *name,
 	return _call(AS_CLOSURE(method), ARG_COUNT);
 }
 
-static bool _invoke(ObjString *method, const uint8_t ARG_COUNT) {
+/**
+ * @brief Procura a entrada de uma forma em um cache em linha
+ *
+ * @param[in] cache Cache onde a forma será procurada
+ * @param[in] shape Forma do receptor
+ *
+ * @return A entrada da forma, ou NULL se ela ainda não foi vista
+ */
+static inline InlineCacheEntry *_cacheLookup(InlineCache *cache,
+											 ObjShape *shape) {
+	for( uint8_t i = 0; i < cache->count; ++i ) {
+		if( cache->entries[i].shape == shape ) {
+			return &cache->entries[i];
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Guarda o resultado de uma busca em um cache em linha
+ *
+ * Se o cache já estiver cheio (ponto megamórfico), as entradas mais antigas
+ * são substituídas em ordem
+ *
+ * @param[out] cache Cache que será atualizado
+ * @param[in] shape Forma do receptor
+ * @param[in] SLOT Índice do campo na instância (-1 se for método)
+ * @param[in] value Método encontrado, ou a forma seguinte de uma escrita
+ */
+static void _cacheUpdate(InlineCache *cache, ObjShape *shape,
+						 const int32_t SLOT, Value value) {
+	/* O cache pertence à função que está rodando */
+	Obj *function = (Obj *)vm.frames[vm.frameCount - 1].closure->function;
+	gcPreBarrier(function);
+
+	InlineCacheEntry *entry = _cacheLookup(cache, shape);
+
+	if( entry == NULL ) {
+		if( cache->count < INLINE_CACHE_ENTRIES ) {
+			entry = &cache->entries[cache->count++];
+		} else {
+			entry = &cache->entries[cache->next];
+			cache->next = (cache->next + 1) % INLINE_CACHE_ENTRIES;
+		}
+	}
+
+	entry->shape = shape;
+	entry->slot = SLOT;
+	entry->value = value;
+
+	gcBarrier(function, CREATE_OBJECT(shape));
+	gcBarrier(function, value);
+}
+
+/**
+ * @brief Troca a instância no topo da pilha pela sua propriedade @a name
+ *
+ * A forma da instância diz onde o campo está (ou que ele não existe), então
+ * um acerto no cache não precisa olhar nenhum hashmap
+ *
+ * @param[in] name Nome da propriedade
+ * @param[out] cache Cache em linha deste acesso
+ *
+ * @return Se a propriedade existe
+ */
+static bool _getProperty(ObjString *name, InlineCache *cache) {
+	ObjInstance *instance = AS_INSTANCE(_peek(0));
+	ObjShape *shape = instance->shape;
+	InlineCacheEntry *cached = NULL;
+
+	if( shape != NULL ) {
+		cached = _cacheLookup(cache, shape);
+	}
+
+	if( cached != NULL ) {
+		if( cached->slot >= 0 ) {
+			vm.stackTop[-1] = instance->slots[cached->slot];
+		} else {
+			_pushBoundMethod(cached->value);
+		}
+
+		return true;
+	}
+
+	Value value;
+	if( shape != NULL ) {
+		const int32_t SLOT = objShapeFind(shape, name);
+		if( SLOT >= 0 ) {
+			_cacheUpdate(cache, shape, SLOT, CREATE_NIL());
+			vm.stackTop[-1] = instance->slots[SLOT];
+			return true;
+		}
+	} else if( objInstanceGet(instance, name, &value) ) {
+		vm.stackTop[-1] = value;
+		return true;
+	}
+
+	if( !tableGet(&instance->klass->methods, CREATE_OBJECT(name), &value) ) {
+		RUNTIME_ERROR_F("Propriedade indefinida '%s'.", name->str);
+		return false;
+	}
+
+	if( shape != NULL ) {
+		_cacheUpdate(cache, shape, -1, value);
+	}
+
+	_pushBoundMethod(value);
+	return true;
+}
+
+/**
+ * @brief Muda a propriedade @a name da instância logo abaixo do topo da pilha
+ *
+ * @param[in] name Nome da propriedade
+ * @param[out] cache Cache em linha deste acesso
+ */
+static void _setProperty(ObjString *name, InlineCache *cache) {
+	ObjInstance *instance = AS_INSTANCE(_peek(1));
+	ObjShape *shape = instance->shape;
+	InlineCacheEntry *cached = NULL;
+
+	if( shape != NULL ) {
+		cached = _cacheLookup(cache, shape);
+	}
+
+	if( cached != NULL ) {
+		/* Se a escrita adiciona um campo, já sabemos a forma seguinte */
+		if( IS_OBJECT(cached->value) ) {
+			objInstanceSetShape(instance, AS_SHAPE(cached->value));
+		}
+
+		gcPreBarrier((Obj *)instance);
+		instance->slots[cached->slot] = _peek(0);
+		gcBarrier((Obj *)instance, _peek(0));
+	} else {
+		objInstanceSet(instance, name, _peek(0));
+
+		if( shape != NULL && instance->shape != NULL ) {
+			const Value NEXT_SHAPE = (instance->shape == shape)
+										 ? CREATE_NIL()
+										 : CREATE_OBJECT(instance->shape);
+			_cacheUpdate(cache, shape, objShapeFind(instance->shape, name),
+						 NEXT_SHAPE);
+		}
+	}
+
+	Value value = vmPop();
+	vmPop();
+	vmPush(value);
+}
+
+bool vmGetProperty(ObjString *name, InlineCache *cache) {
+	if( !IS_INSTANCE(_peek(0)) ) {
+		RUNTIME_ERROR_F("So e possivel acessar as propriedades de uma instancia");
+		return false;
+	}
+
+	return _getProperty(name, cache);
+}
+
+bool vmSetProperty(ObjString *name, InlineCache *cache) {
+	if( !IS_INSTANCE(_peek(1)) ) {
+		RUNTIME_ERROR_F("So e possivel mudar as propriedades de uma instancia");
+		return false;
+	}
+
+	_setProperty(name, cache);
+	return true;
+}
+
+static bool _invoke(ObjString *method, const uint8_t ARG_COUNT,
+					InlineCache *cache) {
 	Value receiver = _peek(ARG_COUNT);
 	if( !IS_INSTANCE(receiver) ) {
 		RUNTIME_ERROR_F("So instancias possuem metodos");
@@ -339,13 +940,48 @@ static bool _invoke(ObjString *method, const uint8_t ARG_COUNT) {
 	}
 
 	ObjInstance *instance = AS_INSTANCE(receiver);
+	ObjShape *shape = instance->shape;
+	InlineCacheEntry *cached = NULL;
+
+	if( shape != NULL ) {
+		cached = _cacheLookup(cache, shape);
+	}
+
+	if( cached != NULL && cached->slot < 0 ) {
+		return _call(AS_CLOSURE(cached->value), ARG_COUNT);
+	}
+
 	Value value;
-	if( tableGet(&instance->fields, CREATE_OBJECT(method), &value) ) {
+	if( cached != NULL ) {
+		value = instance->slots[cached->slot];
+		vm.stackTop[-ARG_COUNT - 1] = value;
+		return _callValue(value, ARG_COUNT);
+	}
+
+	if( shape != NULL ) {
+		const int32_t SLOT = objShapeFind(shape, method);
+		if( SLOT >= 0 ) {
+			_cacheUpdate(cache, shape, SLOT, CREATE_NIL());
+
+			value = instance->slots[SLOT];
+			vm.stackTop[-ARG_COUNT - 1] = value;
+			return _callValue(value, ARG_COUNT);
+		}
+	} else if( objInstanceGet(instance, method, &value) ) {
 		vm.stackTop[-ARG_COUNT - 1] = value;
 		return _callValue(value, ARG_COUNT);
 	}
 
-	return _invokeFromClass(instance->klass, method, ARG_COUNT);
+	if( !tableGet(&instance->klass->methods, CREATE_OBJECT(method), &value) ) {
+		RUNTIME_ERROR_F("Propriedade indefinida '%s'.", method->str);
+		return false;
+	}
+
+	if( shape != NULL ) {
+		_cacheUpdate(cache, shape, -1, value);
+	}
+
+	return _call(AS_CLOSURE(value), ARG_COUNT);
 }
 
 static bool _getArrayValue(ValueArray *array, const int64_t INDEX) {
@@ -369,6 +1005,10 @@ static bool _getArrayValue(ValueArray *array, const int64_t INDEX) {
 }
 
 static bool _setArrayValue(ValueArray *array, const int64_t INDEX, Value new) {
+	if( IS_OBJECT(new) ) {
+		array->hasObjects = true;
+	}
+
 	if( INDEX < 0 ) {
 		if( array->count + INDEX < 0 ) {
 			RUNTIME_ERROR_F("Tentou acessar indice fora do array");
@@ -408,14 +1048,18 @@ static bool _getCharAt(ObjString *str, const int64_t INDEX) {
 	return true;
 }
 
+/** Capacidade atual da pilha (o memRealloc precisa do tamanho antigo) */
+static size_t _stackSize = 0;
+
 static void _vmTempInitStack(void) {
-	vm.stack = memRealloc(vm.stack, 0, 32);
+	vm.stack = MEM_GROW_ARRAY(Value, vm.stack, _stackSize, 2);
+	_stackSize = 2;
 	_resetStack();
 }
 
 void vmInitStack(void) {
-	vm.stack = MEM_GROW_ARRAY(Value, vm.stack, (size_t)(vm.stackTop - vm.stack),
-							  vm.stackMax);
+	vm.stack = MEM_GROW_ARRAY(Value, vm.stack, _stackSize, vm.stackMax);
+	_stackSize = vm.stackMax;
 
 	_resetStack();
 }
@@ -432,20 +1076,57 @@ void vmInit(void) {
 	vm.nextGC = 1024 * 1024;
 	vm.isLocked = false;
 
+#ifdef GC_GENERATIONAL
+	vm.oldObjects = NULL;
+	vm.nextMajorGC = vm.nextGC;
+	vm.nextGC = GC_NURSERY_SIZE;
+
+	vm.rememberedCount = 0;
+	vm.rememberedSize = 0;
+	vm.remembered = NULL;
+#endif
+
+#ifdef GC_PHASES
+	vm.gcPhase = GC_PHASE_IDLE;
+#endif
+#if defined(GC_PHASES) || defined(GC_LAZY_SWEEP)
+	vm.sweepObjects = NULL;
+#endif
+#ifdef GC_LAZY_SWEEP
+	vm.markColor = true;
+#endif
+#ifdef GC_COMPACT
+	vm.compactPending = false;
+#endif
+
 	_vmTempInitStack();
 
 	tableInit(&vm.globalNames);
 	valueArrayInit(&vm.globalValues);
+	/* As instruções de globais escrevem direto no array, sem valueArrayWrite */
+	vm.globalValues.hasObjects = true;
+	tableInit(&vm.globalConsts);
+	tableInit(&vm.globalSets);
 
 	tableInit(&vm.strings);
+
+#ifdef JIT
+	jitInit();
+#endif
+#ifdef DEBUG_PROFILE_OPS
+	profInit();
+#endif
 }
 
 void vmFree(void) {
 	tableFree(&vm.globalNames);
 	valueArrayFree(&vm.globalValues);
+	tableFree(&vm.globalConsts);
+	tableFree(&vm.globalSets);
 
 	tableFree(&vm.strings);
 	memFreeObjects();
+	bcFree();
 }
 
 void vmPush(Value value) {
@@ -461,6 +1142,11 @@ Value vmPop(void) {
 size_t vmGetLine(const uint8_t FRAME_IDX) {
 	INTENTIONALLY_UNUSED(FRAME_IDX);
 
+	/* Antes do script começar (ao reservar a memória, por exemplo) */
+	if( vm.frameCount == 0 ) {
+		return 0;
+	}
+
 	CallFrame *frame = &vm.frames[vm.frameCount - 1];
 	const size_t OFFSET = frame->fp - frame->closure->function->chunk.code - 1;
 
@@ -482,10 +1168,149 @@ static void _printStack(void) {
 }
 #endif
 
+#ifdef COMPUTED_GOTO
+/* Labels-as-values e faixas em inicializadores são extensões do GNU C */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#pragma GCC diagnostic ignored "-Woverride-init"
+#endif
+
 static Result _run(void) {
 	CallFrame *frame = &vm.frames[vm.frameCount - 1];
 	register uint8_t *fp = frame->fp;
 
+#ifdef COMPUTED_GOTO
+	/* Tabela com o endereço do tratador de cada OpCode. Qualquer byte que não
+	 * seja um OpCode conhecido cai no tratador de OpCodes desconhecidos
+	 */
+	static void *dispatchTable[UINT8_COUNT] = {
+		[0 ... UINT8_MAX] = &&LABEL_UNKNOWN,
+
+		[OP_CONST_16] = &&LABEL_OP_CONST_16,
+		[OP_CONST_32] = &&LABEL_OP_CONST_32,
+		[OP_TRUE] = &&LABEL_OP_TRUE,
+		[OP_FALSE] = &&LABEL_OP_FALSE,
+		[OP_NIL] = &&LABEL_OP_NIL,
+		[OP_POP] = &&LABEL_OP_POP,
+		[OP_DEF_GLOBAL_16] = &&LABEL_OP_DEF_GLOBAL_16,
+		[OP_DEF_GLOBAL_32] = &&LABEL_OP_DEF_GLOBAL_32,
+		[OP_DEF_CONST_16] = &&LABEL_OP_DEF_CONST_16,
+		[OP_DEF_CONST_32] = &&LABEL_OP_DEF_CONST_32,
+		[OP_GET_GLOBAL_16] = &&LABEL_OP_GET_GLOBAL_16,
+		[OP_GET_GLOBAL_32] = &&LABEL_OP_GET_GLOBAL_32,
+		[OP_GET_LOCAL_16] = &&LABEL_OP_GET_LOCAL_16,
+		[OP_GET_LOCAL_32] = &&LABEL_OP_GET_LOCAL_32,
+		[OP_GET_UPVALUE_16] = &&LABEL_OP_GET_UPVALUE_16,
+		[OP_GET_UPVALUE_32] = &&LABEL_OP_GET_UPVALUE_32,
+		[OP_SET_GLOBAL_16] = &&LABEL_OP_SET_GLOBAL_16,
+		[OP_SET_GLOBAL_32] = &&LABEL_OP_SET_GLOBAL_32,
+		[OP_SET_LOCAL_16] = &&LABEL_OP_SET_LOCAL_16,
+		[OP_SET_LOCAL_32] = &&LABEL_OP_SET_LOCAL_32,
+		[OP_SET_UPVALUE_16] = &&LABEL_OP_SET_UPVALUE_16,
+		[OP_SET_UPVALUE_32] = &&LABEL_OP_SET_UPVALUE_32,
+		[OP_EQUAL] = &&LABEL_OP_EQUAL,
+		[OP_GREATER] = &&LABEL_OP_GREATER,
+		[OP_GREATER_EQUAL] = &&LABEL_OP_GREATER_EQUAL,
+		[OP_LESS] = &&LABEL_OP_LESS,
+		[OP_LESS_EQUAL] = &&LABEL_OP_LESS_EQUAL,
+		[OP_ADD] = &&LABEL_OP_ADD,
+		[OP_SUB] = &&LABEL_OP_SUB,
+		[OP_MUL] = &&LABEL_OP_MUL,
+		[OP_DIV] = &&LABEL_OP_DIV,
+		[OP_MOD] = &&LABEL_OP_MOD,
+		[OP_NEGATE] = &&LABEL_OP_NEGATE,
+		[OP_NOT] = &&LABEL_OP_NOT,
+		[OP_PRINT] = &&LABEL_OP_PRINT,
+		[OP_JUMP] = &&LABEL_OP_JUMP,
+		[OP_JUMP_IF_FALSE] = &&LABEL_OP_JUMP_IF_FALSE,
+		[OP_JUMP_IF_TRUE] = &&LABEL_OP_JUMP_IF_TRUE,
+		[OP_LOOP] = &&LABEL_OP_LOOP,
+		[OP_DUP] = &&LABEL_OP_DUP,
+		[OP_CALL] = &&LABEL_OP_CALL,
+		[OP_CLOSURE_16] = &&LABEL_OP_CLOSURE_16,
+		[OP_CLOSURE_32] = &&LABEL_OP_CLOSURE_32,
+		[OP_CLOSE_UPVALUE] = &&LABEL_OP_CLOSE_UPVALUE,
+		[OP_CLASS_16] = &&LABEL_OP_CLASS_16,
+		[OP_CLASS_32] = &&LABEL_OP_CLASS_32,
+		[OP_SET_PROPERTY_16] = &&LABEL_OP_SET_PROPERTY_16,
+		[OP_SET_PROPERTY_32] = &&LABEL_OP_SET_PROPERTY_32,
+		[OP_GET_PROPERTY_16] = &&LABEL_OP_GET_PROPERTY_16,
+		[OP_GET_PROPERTY_32] = &&LABEL_OP_GET_PROPERTY_32,
+		[OP_METHOD_16] = &&LABEL_OP_METHOD_16,
+		[OP_METHOD_32] = &&LABEL_OP_METHOD_32,
+		[OP_INVOKE_16] = &&LABEL_OP_INVOKE_16,
+		[OP_INVOKE_32] = &&LABEL_OP_INVOKE_32,
+		[OP_INHERIT] = &&LABEL_OP_INHERIT,
+		[OP_GET_SUPER_16] = &&LABEL_OP_GET_SUPER_16,
+		[OP_GET_SUPER_32] = &&LABEL_OP_GET_SUPER_32,
+		[OP_SUPER_INVOKE_16] = &&LABEL_OP_SUPER_INVOKE_16,
+		[OP_SUPER_INVOKE_32] = &&LABEL_OP_SUPER_INVOKE_32,
+		[OP_ARRAY] = &&LABEL_OP_ARRAY,
+		[OP_PUSH_TO_ARRAY] = &&LABEL_OP_PUSH_TO_ARRAY,
+		[OP_TABLE] = &&LABEL_OP_TABLE,
+		[OP_PUSH_TO_TABLE] = &&LABEL_OP_PUSH_TO_TABLE,
+		[OP_GET_SUBSCRIPT] = &&LABEL_OP_GET_SUBSCRIPT,
+		[OP_SET_SUBSCRIPT] = &&LABEL_OP_SET_SUBSCRIPT,
+		[OP_RETURN] = &&LABEL_OP_RETURN,
+		[OP_EQUAL_NUM] = &&LABEL_OP_EQUAL_NUM,
+		[OP_GREATER_NUM] = &&LABEL_OP_GREATER_NUM,
+		[OP_GREATER_EQUAL_NUM] = &&LABEL_OP_GREATER_EQUAL_NUM,
+		[OP_LESS_NUM] = &&LABEL_OP_LESS_NUM,
+		[OP_LESS_EQUAL_NUM] = &&LABEL_OP_LESS_EQUAL_NUM,
+		[OP_ADD_NUM] = &&LABEL_OP_ADD_NUM,
+		[OP_SUB_NUM] = &&LABEL_OP_SUB_NUM,
+		[OP_MUL_NUM] = &&LABEL_OP_MUL_NUM,
+		[OP_DIV_NUM] = &&LABEL_OP_DIV_NUM,
+		[OP_MOD_NUM] = &&LABEL_OP_MOD_NUM,
+		[OP_NEGATE_NUM] = &&LABEL_OP_NEGATE_NUM,
+		[OP_ADD_RR] = &&LABEL_OP_ADD_RR,
+		[OP_SUB_RR] = &&LABEL_OP_SUB_RR,
+		[OP_MUL_RR] = &&LABEL_OP_MUL_RR,
+		[OP_DIV_RR] = &&LABEL_OP_DIV_RR,
+		[OP_MOD_RR] = &&LABEL_OP_MOD_RR,
+		[OP_EQUAL_RR] = &&LABEL_OP_EQUAL_RR,
+		[OP_GREATER_RR] = &&LABEL_OP_GREATER_RR,
+		[OP_GREATER_EQUAL_RR] = &&LABEL_OP_GREATER_EQUAL_RR,
+		[OP_LESS_RR] = &&LABEL_OP_LESS_RR,
+		[OP_LESS_EQUAL_RR] = &&LABEL_OP_LESS_EQUAL_RR,
+		[OP_ADD_RK] = &&LABEL_OP_ADD_RK,
+		[OP_SUB_RK] = &&LABEL_OP_SUB_RK,
+		[OP_MUL_RK] = &&LABEL_OP_MUL_RK,
+		[OP_DIV_RK] = &&LABEL_OP_DIV_RK,
+		[OP_MOD_RK] = &&LABEL_OP_MOD_RK,
+		[OP_EQUAL_RK] = &&LABEL_OP_EQUAL_RK,
+		[OP_GREATER_RK] = &&LABEL_OP_GREATER_RK,
+		[OP_GREATER_EQUAL_RK] = &&LABEL_OP_GREATER_EQUAL_RK,
+		[OP_LESS_RK] = &&LABEL_OP_LESS_RK,
+		[OP_LESS_EQUAL_RK] = &&LABEL_OP_LESS_EQUAL_RK,
+		[OP_ADD_RRR] = &&LABEL_OP_ADD_RRR,
+		[OP_SUB_RRR] = &&LABEL_OP_SUB_RRR,
+		[OP_MUL_RRR] = &&LABEL_OP_MUL_RRR,
+		[OP_DIV_RRR] = &&LABEL_OP_DIV_RRR,
+		[OP_MOD_RRR] = &&LABEL_OP_MOD_RRR,
+		[OP_ADD_RRK] = &&LABEL_OP_ADD_RRK,
+		[OP_SUB_RRK] = &&LABEL_OP_SUB_RRK,
+		[OP_MUL_RRK] = &&LABEL_OP_MUL_RRK,
+		[OP_DIV_RRK] = &&LABEL_OP_DIV_RRK,
+		[OP_MOD_RRK] = &&LABEL_OP_MOD_RRK,
+
+#define SUPER_LABEL(NAME, LENGTH, COUNT, ...) [NAME] = &&LABEL_##NAME,
+		SUPERINSTRUCTIONS(SUPER_LABEL)
+#undef SUPER_LABEL
+	};
+
+#ifdef JIT
+	/* Enquanto um trace é gravado, toda instrução passa pelo gravador */
+	static void *recordTable[UINT8_COUNT] = {
+		[0 ... UINT8_MAX] = &&LABEL_RECORD,
+	};
+#endif
+
+	void **dispatch = dispatchTable;
+#elif defined(JIT)
+	bool recording = false;
+#endif
+
 	while( true ) {
 #ifdef DEBUG_TRACE_EXECUTION
 		_printStack();
@@ -493,57 +1318,66 @@ static Result _run(void) {
 			&frame->closure->function->chunk,
 			(size_t)(fp - frame->closure->function->chunk.code));
 #endif
-		const OpCode OP = READ_8();
-		switch( OP ) {
-			case OP_CONST_16: {
+#ifdef DEBUG_PROFILE_OPS
+		profInstruction(&frame->closure->function->chunk, fp);
+#endif
+#if defined(JIT) && !defined(COMPUTED_GOTO)
+		if( recording ) {
+			JIT_RECORDING(jitRecord(frame, fp));
+		}
+#endif
+		DISPATCH() {
+			CASE(OP_CONST_16): {
 				Value constant = READ_CONST_16();
 				vmPush(constant);
-			} break;
+			} NEXT();
 
-			case OP_CONST_32: {
+			CASE(OP_CONST_32): {
 				Value constant = READ_CONST_32();
 				vmPush(constant);
-			} break;
+			} NEXT();
 
-			case OP_TRUE:
+			CASE(OP_TRUE):
 				vmPush(CREATE_BOOL(true));
-				break;
+				NEXT();
 
-			case OP_FALSE:
+			CASE(OP_FALSE):
 				vmPush(CREATE_BOOL(false));
-				break;
+				NEXT();
 
-			case OP_NIL:
+			CASE(OP_NIL):
 				vmPush(CREATE_NIL());
-				break;
+				NEXT();
 
-			case OP_POP:
+			CASE(OP_POP):
 				vmPop();
-				break;
+				NEXT();
 
-			case OP_DEF_GLOBAL_16:
+			CASE(OP_DEF_GLOBAL_16):
 				READ_GLOBAL_16() = vmPop();
-				break;
+				NEXT();
 
-			case OP_DEF_GLOBAL_32:
+			CASE(OP_DEF_GLOBAL_32):
 				READ_GLOBAL_32() = vmPop();
-				break;
+				NEXT();
 
-			case OP_DEF_CONST_16: {
+			CASE(OP_DEF_CONST_16): {
 				const uint8_t INDEX = READ_8();
 
 				vm.globalValues.values[INDEX] = vmPop();
-				SET_TO_CONSTANT(vm.globalValues.values[INDEX]);
-			} break;
+				tableSet(&vm.globalConsts, CREATE_NUMBER((double)INDEX),
+						 CREATE_BOOL(true));
+			} NEXT();
 
-			case OP_DEF_CONST_32: {
+			CASE(OP_DEF_CONST_32): {
 				const size_t INDEX = READ_24();
 
 				vm.globalValues.values[INDEX] = vmPop();
-				SET_TO_CONSTANT(vm.globalValues.values[INDEX]);
-			} break;
+				tableSet(&vm.globalConsts, CREATE_NUMBER((double)INDEX),
+						 CREATE_BOOL(true));
+			} NEXT();
 
-			case OP_GET_GLOBAL_16: {
+			CASE(OP_GET_GLOBAL_16): {
 				Value value = READ_GLOBAL_16();
 				if( IS_EMPTY(value) ) {
 					RUNTIME_ERROR("Variavel indefinida");
@@ -551,10 +1385,10 @@ static Result _run(void) {
 				}
 
 				vmPush(value);
-				break;
+				NEXT();
 			}
 
-			case OP_GET_GLOBAL_32: {
+			CASE(OP_GET_GLOBAL_32): {
 				Value value = READ_GLOBAL_32();
 				if( IS_EMPTY(value) ) {
 					RUNTIME_ERROR("Variavel indefinida");
@@ -562,26 +1396,26 @@ static Result _run(void) {
 				}
 
 				vmPush(value);
-				break;
+				NEXT();
 			}
 
-			case OP_GET_LOCAL_16:
+			CASE(OP_GET_LOCAL_16):
 				vmPush(frame->slots[READ_8()]);
-				break;
+				NEXT();
 
-			case OP_GET_LOCAL_32:
+			CASE(OP_GET_LOCAL_32):
 				vmPush(frame->slots[READ_24()]);
-				break;
+				NEXT();
 
-			case OP_GET_UPVALUE_16:
+			CASE(OP_GET_UPVALUE_16):
 				vmPush(*frame->closure->upvalues[READ_8()]->location);
-				break;
+				NEXT();
 
-			case OP_GET_UPVALUE_32:
+			CASE(OP_GET_UPVALUE_32):
 				vmPush(*frame->closure->upvalues[READ_24()]->location);
-				break;
+				NEXT();
 
-			case OP_SET_GLOBAL_16: {
+			CASE(OP_SET_GLOBAL_16): {
 				const uint8_t index = READ_8();
 				Value value = vm.globalValues.values[index];
 
@@ -591,9 +1425,9 @@ static Result _run(void) {
 				}
 
 				vm.globalValues.values[index] = _peek(0);
-			} break;
+			} NEXT();
 
-			case OP_SET_GLOBAL_32: {
+			CASE(OP_SET_GLOBAL_32): {
 				const uint32_t INDEX = READ_24();
 				Value value = vm.globalValues.values[INDEX];
 
@@ -603,47 +1437,57 @@ static Result _run(void) {
 				}
 
 				vm.globalValues.values[INDEX] = _peek(0);
-			} break;
+			} NEXT();
 
-			case OP_SET_LOCAL_16:
+			CASE(OP_SET_LOCAL_16):
 				frame->slots[READ_8()] = _peek(0);
-				break;
+				NEXT();
 
-			case OP_SET_LOCAL_32:
+			CASE(OP_SET_LOCAL_32):
 				frame->slots[READ_24()] = _peek(0);
-				break;
-
-			case OP_SET_UPVALUE_16:
-				*frame->closure->upvalues[READ_8()]->location = _peek(0);
-				break;
-
-			case OP_SET_UPVALUE_32:
-				*frame->closure->upvalues[READ_24()]->location = _peek(0);
-				break;
-
-			case OP_EQUAL: {
+				NEXT();
+
+			CASE(OP_SET_UPVALUE_16): {
+				ObjUpvalue *upvalue = frame->closure->upvalues[READ_8()];
+				gcPreBarrier((Obj *)upvalue);
+				*upvalue->location = _peek(0);
+				gcBarrier((Obj *)upvalue, _peek(0));
+			} NEXT();
+
+			CASE(OP_SET_UPVALUE_32): {
+				ObjUpvalue *upvalue = frame->closure->upvalues[READ_24()];
+				gcPreBarrier((Obj *)upvalue);
+				*upvalue->location = _peek(0);
+				gcBarrier((Obj *)upvalue, _peek(0));
+			} NEXT();
+
+			CASE(OP_EQUAL): {
 				Value a = vmPop();
 				Value b = vmPop();
+				if( IS_NUMBER(a) && IS_NUMBER(b) ) {
+					QUICKEN(OP_EQUAL_NUM);
+				}
+
 				vmPush(CREATE_BOOL(valueEquals(a, b)));
-			} break;
+			} NEXT();
 
-			case OP_GREATER:
-				BINARY_OP(CREATE_BOOL, >);
-				break;
+			CASE(OP_GREATER):
+				BINARY_OP(CREATE_BOOL, >, OP_GREATER_NUM);
+				NEXT();
 
-			case OP_GREATER_EQUAL:
-				BINARY_OP(CREATE_BOOL, >=);
-				break;
+			CASE(OP_GREATER_EQUAL):
+				BINARY_OP(CREATE_BOOL, >=, OP_GREATER_EQUAL_NUM);
+				NEXT();
 
-			case OP_LESS:
-				BINARY_OP(CREATE_BOOL, <);
-				break;
+			CASE(OP_LESS):
+				BINARY_OP(CREATE_BOOL, <, OP_LESS_NUM);
+				NEXT();
 
-			case OP_LESS_EQUAL:
-				BINARY_OP(CREATE_BOOL, <=);
-				break;
+			CASE(OP_LESS_EQUAL):
+				BINARY_OP(CREATE_BOOL, <=, OP_LESS_EQUAL_NUM);
+				NEXT();
 
-			case OP_ADD: {
+			CASE(OP_ADD): {
 				if( IS_STRING(_peek(0)) && IS_STRING(_peek(1)) ) {
 					_concatenate();
 				} else if( IS_NUMBER(_peek(0)) && IS_NUMBER(_peek(1)) ) {
@@ -651,27 +1495,28 @@ static Result _run(void) {
 					const double A = AS_NUMBER(vmPop());
 
 					vmPush(CREATE_NUMBER(A + B));
+					QUICKEN(OP_ADD_NUM);
 				} else {
 					RUNTIME_ERROR(
 						"Operandos devem ser dois numeros ou duas "
 						"strings");
 					return RESULT_RUNTIME_ERROR;
 				}
-			} break;
+			} NEXT();
 
-			case OP_SUB:
-				BINARY_OP(CREATE_NUMBER, -);
-				break;
+			CASE(OP_SUB):
+				BINARY_OP(CREATE_NUMBER, -, OP_SUB_NUM);
+				NEXT();
 
-			case OP_MUL:
-				BINARY_OP(CREATE_NUMBER, *);
-				break;
+			CASE(OP_MUL):
+				BINARY_OP(CREATE_NUMBER, *, OP_MUL_NUM);
+				NEXT();
 
-			case OP_DIV:
-				BINARY_OP(CREATE_NUMBER, /);
-				break;
+			CASE(OP_DIV):
+				BINARY_OP(CREATE_NUMBER, /, OP_DIV_NUM);
+				NEXT();
 
-			case OP_MOD: {
+			CASE(OP_MOD): {
 				if( !IS_NUMBER(_peek(0)) || !IS_NUMBER(_peek(1)) ) {
 					RUNTIME_ERROR("Ambos os operandos devem ser numeros");
 					return RESULT_RUNTIME_ERROR;
@@ -680,52 +1525,62 @@ static Result _run(void) {
 				double b = AS_NUMBER(vmPop());
 				double a = AS_NUMBER(vmPop());
 				vmPush(CREATE_NUMBER(fmod(a, b)));
-			} break;
+				QUICKEN(OP_MOD_NUM);
+			} NEXT();
 
-			case OP_NEGATE: {
+			CASE(OP_NEGATE): {
 				if( !IS_NUMBER(_peek(0)) ) {
 					RUNTIME_ERROR("Impossivel negar algo que nao e um numero");
 					return RESULT_RUNTIME_ERROR;
 				}
 
 #ifdef NAN_BOXING
-				vmPush(-vmPop());
+				vmPush(CREATE_NUMBER(-AS_NUMBER(vmPop())));
 #else
 				(vm.stackTop - 1)->vNumber = -(vm.stackTop - 1)->vNumber;
 #endif
-			} break;
+				QUICKEN(OP_NEGATE_NUM);
+			} NEXT();
 
-			case OP_NOT:
+			CASE(OP_NOT):
 				vmPush(CREATE_BOOL(_isFalsey(vmPop())));
-				break;
+				NEXT();
 
-			case OP_PRINT:
+			CASE(OP_PRINT):
 				valuePrint(vmPop());
 				printf("\n");
-				break;
+				NEXT();
 
-			case OP_JUMP: {
+			CASE(OP_JUMP): {
 				const uint16_t OFFSET = READ_16();
 				fp += OFFSET;
-			} break;
+			} NEXT();
 
-			case OP_JUMP_IF_FALSE: {
+			CASE(OP_JUMP_IF_FALSE): {
 				const uint16_t OFFSET = READ_16();
 				if( _isFalsey(_peek(0)) ) {
 					fp += OFFSET;
 				}
-			} break;
+			} NEXT();
+			CASE(OP_JUMP_IF_TRUE): {
+				const uint16_t OFFSET = READ_16();
+				if( !_isFalsey(_peek(0)) ) {
+					fp += OFFSET;
+				}
+			} NEXT();
 
-			case OP_LOOP: {
+			CASE(OP_LOOP): {
 				const uint16_t OFFSET = READ_16();
 				fp -= OFFSET;
-			} break;
+				HOT_LOOP();
+				JIT_ENTER();
+			} NEXT();
 
-			case OP_DUP:
+			CASE(OP_DUP):
 				vmPush(_peek(0));
-				break;
+				NEXT();
 
-			case OP_CALL: {
+			CASE(OP_CALL): {
 				const uint8_t ARG_COUNT = READ_8();
 
 				if( vm.stackTop + ARG_COUNT > &vm.stack[vm.stackMax] ) {
@@ -739,11 +1594,21 @@ static Result _run(void) {
 					return RESULT_RUNTIME_ERROR;
 				}
 
+#ifdef GC_COMPACT
+				/* Ponto seguro: todo o estado está na VM, e é recarregado
+				 * logo abaixo
+				 */
+				if( vm.compactPending && !vm.isLocked ) {
+					gcCompact();
+				}
+#endif
+
 				frame = &vm.frames[vm.frameCount - 1];
 				fp = frame->fp;
-			} break;
+				JIT_ENTER();
+			} NEXT();
 
-			case OP_CLOSURE_16: {
+			CASE(OP_CLOSURE_16): {
 				ObjFunction *function = AS_FUNCTION(READ_CONST_16());
 				ObjClosure *closure = objMakeClosure(function);
 				vmPush(CREATE_OBJECT(closure));
@@ -751,16 +1616,21 @@ static Result _run(void) {
 				for( size_t i = 0; i < closure->upvalueCount; ++i ) {
 					uint8_t isLocal = READ_8();
 					uint32_t index = READ_24();
-					if( isLocal ) {
-						closure->upvalues[i] =
-							_captureUpvalue(frame->slots + index);
-					} else {
-						closure->upvalues[i] = frame->closure->upvalues[index];
-					}
+					ObjUpvalue *upvalue =
+						isLocal ? _captureUpvalue(frame->slots + index)
+								: frame->closure->upvalues[index];
+
+					gcPreBarrier((Obj *)closure);
+					closure->upvalues[i] = upvalue;
+
+					/* Capturar um upvalue aloca, e pode ter promovido a
+					 * closure */
+					gcBarrier((Obj *)closure,
+							  CREATE_OBJECT(closure->upvalues[i]));
 				}
-			} break;
+			} NEXT();
 
-			case OP_CLOSURE_32: {
+			CASE(OP_CLOSURE_32): {
 				ObjFunction *function = AS_FUNCTION(READ_CONST_32());
 				ObjClosure *closure = objMakeClosure(function);
 				vmPush(CREATE_OBJECT(closure));
@@ -768,143 +1638,112 @@ static Result _run(void) {
 				for( size_t i = 0; i < closure->upvalueCount; ++i ) {
 					uint8_t isLocal = READ_8();
 					uint32_t index = READ_24();
-					if( isLocal ) {
-						closure->upvalues[i] =
-							_captureUpvalue(frame->slots + index);
-					} else {
-						closure->upvalues[i] = frame->closure->upvalues[index];
-					}
+					ObjUpvalue *upvalue =
+						isLocal ? _captureUpvalue(frame->slots + index)
+								: frame->closure->upvalues[index];
+
+					gcPreBarrier((Obj *)closure);
+					closure->upvalues[i] = upvalue;
+
+					/* Capturar um upvalue aloca, e pode ter promovido a
+					 * closure */
+					gcBarrier((Obj *)closure,
+							  CREATE_OBJECT(closure->upvalues[i]));
 				}
-			} break;
+			} NEXT();
 
-			case OP_CLOSE_UPVALUE:
+			CASE(OP_CLOSE_UPVALUE):
 				_closeUpvalues(vm.stackTop - 1);
 				vmPop();
-				break;
+				NEXT();
 
-			case OP_CLASS_16:
+			CASE(OP_CLASS_16):
 				vmPush(CREATE_OBJECT(objMakeClass(READ_STRING_16())));
-				break;
+				NEXT();
 
-			case OP_CLASS_32:
+			CASE(OP_CLASS_32):
 				vmPush(CREATE_OBJECT(objMakeClass(READ_STRING_32())));
-				break;
-
-			case OP_GET_PROPERTY_16: {
-				if( !IS_INSTANCE(_peek(0)) ) {
-					RUNTIME_ERROR(
-						"So e possivel acessar as propriedades de uma "
-						"instancia");
-					return RESULT_RUNTIME_ERROR;
-				}
+				NEXT();
 
-				ObjInstance *instance = AS_INSTANCE(_peek(0));
+			CASE(OP_GET_PROPERTY_16): {
 				ObjString *name = READ_STRING_16();
-
-				Value value;
-				if( tableGet(&instance->fields, CREATE_OBJECT(name), &value) ) {
-					vmPop();
-					vmPush(value);
-					break;
-				}
+				InlineCache *cache = READ_CACHE();
 
 				frame->fp = fp;
-				if( !_bindMethod(instance->klass, name) ) {
+				if( !vmGetProperty(name, cache) ) {
 					return RESULT_RUNTIME_ERROR;
 				}
-			} break;
+			} NEXT();
 
-			case OP_GET_PROPERTY_32: {
-				if( !IS_INSTANCE(_peek(0)) ) {
-					RUNTIME_ERROR(
-						"So e possivel acessar as propriedades de uma "
-						"instancia");
-					return RESULT_RUNTIME_ERROR;
-				}
-
-				ObjInstance *instance = AS_INSTANCE(_peek(0));
+			CASE(OP_GET_PROPERTY_32): {
 				ObjString *name = READ_STRING_32();
-
-				Value value;
-				if( tableGet(&instance->fields, CREATE_OBJECT(name), &value) ) {
-					vmPop();
-					vmPush(value);
-					break;
-				}
+				InlineCache *cache = READ_CACHE();
 
 				frame->fp = fp;
-				if( !_bindMethod(instance->klass, name) ) {
+				if( !vmGetProperty(name, cache) ) {
 					return RESULT_RUNTIME_ERROR;
 				}
-			} break;
+			} NEXT();
 
-			case OP_SET_PROPERTY_16: {
-				if( !IS_INSTANCE(_peek(1)) ) {
-					RUNTIME_ERROR(
-						"So e possivel mudar as propriedades de uma "
-						"instancia");
+			CASE(OP_SET_PROPERTY_16): {
+				ObjString *name = READ_STRING_16();
+				InlineCache *cache = READ_CACHE();
+
+				frame->fp = fp;
+				if( !vmSetProperty(name, cache) ) {
 					return RESULT_RUNTIME_ERROR;
 				}
+			} NEXT();
 
-				ObjInstance *instance = AS_INSTANCE(_peek(1));
-				tableSet(&instance->fields, CREATE_OBJECT(READ_STRING_16()),
-						 _peek(0));
-				Value value = vmPop();
-				vmPop();
-				vmPush(value);
-			} break;
+			CASE(OP_SET_PROPERTY_32): {
+				ObjString *name = READ_STRING_32();
+				InlineCache *cache = READ_CACHE();
 
-			case OP_SET_PROPERTY_32: {
-				if( !IS_INSTANCE(_peek(1)) ) {
-					RUNTIME_ERROR(
-						"So e possivel mudar as propriedades de uma "
-						"instancia");
+				frame->fp = fp;
+				if( !vmSetProperty(name, cache) ) {
 					return RESULT_RUNTIME_ERROR;
 				}
+			} NEXT();
 
-				ObjInstance *instance = AS_INSTANCE(_peek(1));
-				tableSet(&instance->fields, CREATE_OBJECT(READ_STRING_32()),
-						 _peek(0));
-				Value value = vmPop();
-				vmPop();
-				vmPush(value);
-			} break;
-
-			case OP_METHOD_16:
+			CASE(OP_METHOD_16):
 				_defineMethod(READ_STRING_16());
-				break;
+				NEXT();
 
-			case OP_METHOD_32:
+			CASE(OP_METHOD_32):
 				_defineMethod(READ_STRING_32());
-				break;
+				NEXT();
 
-			case OP_INVOKE_16: {
+			CASE(OP_INVOKE_16): {
 				ObjString *method = READ_STRING_16();
 				const uint8_t ARG_COUNT = READ_8();
+				InlineCache *cache = READ_CACHE();
 
 				frame->fp = fp;
-				if( !_invoke(method, ARG_COUNT) ) {
+				if( !_invoke(method, ARG_COUNT, cache) ) {
 					return RESULT_RUNTIME_ERROR;
 				}
 
 				frame = &vm.frames[vm.frameCount - 1];
 				fp = frame->fp;
-			} break;
+				JIT_ENTER();
+			} NEXT();
 
-			case OP_INVOKE_32: {
+			CASE(OP_INVOKE_32): {
 				ObjString *method = READ_STRING_32();
 				const uint8_t ARG_COUNT = READ_8();
+				InlineCache *cache = READ_CACHE();
 
 				frame->fp = fp;
-				if( !_invoke(method, ARG_COUNT) ) {
+				if( !_invoke(method, ARG_COUNT, cache) ) {
 					return RESULT_RUNTIME_ERROR;
 				}
 
 				frame = &vm.frames[vm.frameCount - 1];
 				fp = frame->fp;
-			} break;
+				JIT_ENTER();
+			} NEXT();
 
-			case OP_INHERIT: {
+			CASE(OP_INHERIT): {
 				Value superclass = _peek(1);
 				if( !IS_CLASS(superclass) ) {
 					RUNTIME_ERROR("So e possivel herdar classes");
@@ -912,29 +1751,31 @@ static Result _run(void) {
 				}
 
 				ObjClass *subclass = AS_CLASS(_peek(0));
+				gcPreBarrier((Obj *)subclass);
 				tableCopyTo(&AS_CLASS(superclass)->methods, &subclass->methods);
+				gcRemember((Obj *)subclass);
 				vmPop();
-			} break;
+			} NEXT();
 
-			case OP_GET_SUPER_16: {
+			CASE(OP_GET_SUPER_16): {
 				ObjString *name = READ_STRING_16();
 				ObjClass *superclass = AS_CLASS(vmPop());
 
 				if( !_bindMethod(superclass, name) ) {
 					return RESULT_RUNTIME_ERROR;
 				}
-			} break;
+			} NEXT();
 
-			case OP_GET_SUPER_32: {
+			CASE(OP_GET_SUPER_32): {
 				ObjString *name = READ_STRING_32();
 				ObjClass *superclass = AS_CLASS(vmPop());
 
 				if( !_bindMethod(superclass, name) ) {
 					return RESULT_RUNTIME_ERROR;
 				}
-			} break;
+			} NEXT();
 
-			case OP_SUPER_INVOKE_16: {
+			CASE(OP_SUPER_INVOKE_16): {
 				ObjString *method = READ_STRING_16();
 				const uint8_t ARG_COUNT = READ_8();
 
@@ -946,9 +1787,10 @@ static Result _run(void) {
 
 				frame = &vm.frames[vm.frameCount - 1];
 				fp = frame->fp;
-			} break;
+				JIT_ENTER();
+			} NEXT();
 
-			case OP_SUPER_INVOKE_32: {
+			CASE(OP_SUPER_INVOKE_32): {
 				ObjString *method = READ_STRING_32();
 				const uint8_t ARG_COUNT = READ_8();
 
@@ -960,27 +1802,36 @@ static Result _run(void) {
 
 				frame = &vm.frames[vm.frameCount - 1];
 				fp = frame->fp;
-			} break;
+				JIT_ENTER();
+			} NEXT();
 
-			case OP_ARRAY:
+			CASE(OP_ARRAY):
 				vmPush(CREATE_OBJECT(objMakeArray()));
-				break;
+				NEXT();
 
-			case OP_PUSH_TO_ARRAY: {
+			CASE(OP_PUSH_TO_ARRAY): {
+				/* O valor continua na pilha caso o array cresça e o GC rode */
 				ObjArray *array = AS_ARRAY(_peek(1));
-				valueArrayWrite(&array->array, vmPop());
-			} break;
+				gcPreBarrier((Obj *)array);
+				valueArrayWrite(&array->array, _peek(0));
+				gcBarrier((Obj *)array, vmPop());
+			} NEXT();
 
-			case OP_TABLE:
+			CASE(OP_TABLE):
 				vmPush(CREATE_OBJECT(objMakeTable()));
-				break;
+				NEXT();
 
-			case OP_PUSH_TO_TABLE: {
+			CASE(OP_PUSH_TO_TABLE): {
+				/* Chave e valor continuam na pilha caso o hashmap cresça */
 				ObjTable *table = AS_TABLE(_peek(2));
-				tableSet(&table->table, vmPop(), vmPop());
-			} break;
-
-			case OP_GET_SUBSCRIPT: {
+				gcPreBarrier((Obj *)table);
+				tableSet(&table->table, _peek(1), _peek(0));
+				gcBarrier((Obj *)table, _peek(1));
+				gcBarrier((Obj *)table, _peek(0));
+				vm.stackTop -= 2;
+			} NEXT();
+
+			CASE(OP_GET_SUBSCRIPT): {
 				if( IS_ARRAY(_peek(1)) ) {
 					if( !IS_NUMBER(_peek(0)) ) {
 						RUNTIME_ERROR("Indice do array deve ser um numero");
@@ -1029,9 +1880,9 @@ static Result _run(void) {
 					RUNTIME_ERROR("So arrays, hashmaps e strings podem ter seus itens acessados por indice");
 					return RESULT_RUNTIME_ERROR;
 				}
-			} break;
+			} NEXT();
 
-			case OP_SET_SUBSCRIPT: {
+			CASE(OP_SET_SUBSCRIPT): {
 				if( IS_ARRAY(_peek(2)) ) {
 					if( !IS_NUMBER(_peek(1)) ) {
 						RUNTIME_ERROR("Indice do array deve ser um numero");
@@ -1042,10 +1893,13 @@ static Result _run(void) {
 					int64_t index = (int64_t)AS_NUMBER(vmPop());
 
 					frame->fp = fp;
+					gcPreBarrier(AS_OBJECT(_peek(0)));
 					if( !_setArrayValue(&AS_ARRAY(_peek(0))->array, index,
 										value) ) {
 						return RESULT_RUNTIME_ERROR;
 					}
+
+					gcBarrier(AS_OBJECT(_peek(0)), value);
 				} else if( IS_TABLE(_peek(2)) ) {
 					if( !IS_STRING(_peek(1)) ) {
 						RUNTIME_ERROR(
@@ -1054,17 +1908,19 @@ static Result _run(void) {
 						return RESULT_RUNTIME_ERROR;
 					}
 
-					Value value = vmPop();
-					Value key = vmPop();
-
-					tableSet(&AS_TABLE(_peek(0))->table, key, value);
+					ObjTable *table = AS_TABLE(_peek(2));
+					gcPreBarrier((Obj *)table);
+					tableSet(&table->table, _peek(1), _peek(0));
+					gcBarrier((Obj *)table, _peek(1));
+					gcBarrier((Obj *)table, _peek(0));
+					vm.stackTop -= 2;
 				} else {
 					RUNTIME_ERROR("So arrays e hashmap podem ter seus valores mudados por acesso de indice");
 					return RESULT_RUNTIME_ERROR;
 				}
-			} break;
+			} NEXT();
 
-			case OP_RETURN: {
+			CASE(OP_RETURN): {
 				Value result = vmPop();
 				frame->fp = fp;
 
@@ -1080,17 +1936,216 @@ static Result _run(void) {
 
 				frame = &vm.frames[vm.frameCount - 1];
 				fp = frame->fp;
-			} break;
+				JIT_ENTER();
+			} NEXT();
+
+			CASE(OP_EQUAL_NUM):
+				BINARY_OP_NUM(CREATE_BOOL, ==, OP_EQUAL);
+				NEXT();
+
+			CASE(OP_GREATER_NUM):
+				BINARY_OP_NUM(CREATE_BOOL, >, OP_GREATER);
+				NEXT();
+
+			CASE(OP_GREATER_EQUAL_NUM):
+				BINARY_OP_NUM(CREATE_BOOL, >=, OP_GREATER_EQUAL);
+				NEXT();
+
+			CASE(OP_LESS_NUM):
+				BINARY_OP_NUM(CREATE_BOOL, <, OP_LESS);
+				NEXT();
+
+			CASE(OP_LESS_EQUAL_NUM):
+				BINARY_OP_NUM(CREATE_BOOL, <=, OP_LESS_EQUAL);
+				NEXT();
+
+			CASE(OP_ADD_NUM):
+				BINARY_OP_NUM(CREATE_NUMBER, +, OP_ADD);
+				NEXT();
+
+			CASE(OP_SUB_NUM):
+				BINARY_OP_NUM(CREATE_NUMBER, -, OP_SUB);
+				NEXT();
+
+			CASE(OP_MUL_NUM):
+				BINARY_OP_NUM(CREATE_NUMBER, *, OP_MUL);
+				NEXT();
+
+			CASE(OP_DIV_NUM):
+				BINARY_OP_NUM(CREATE_NUMBER, /, OP_DIV);
+				NEXT();
+
+			CASE(OP_MOD_NUM): {
+				const Value B = vm.stackTop[-1];
+				const Value A = vm.stackTop[-2];
+				if( !IS_NUMBER(A) || !IS_NUMBER(B) ) {
+					DEOPT(OP_MOD);
+				}
 
-			default:
-				errWarn(
-					chunkGetLine(&frame->closure->function->chunk, *(fp - 1)),
-					"OPCODE desconhecido encontrado! -> ");
-				printf("%02x\n", OP);
+				vm.stackTop[-2] =
+					CREATE_NUMBER(fmod(AS_NUMBER(A), AS_NUMBER(B)));
+				--vm.stackTop;
+			} NEXT();
+
+			CASE(OP_NEGATE_NUM): {
+				const Value A = vm.stackTop[-1];
+				if( !IS_NUMBER(A) ) {
+					DEOPT(OP_NEGATE);
+				}
+
+				vm.stackTop[-1] = CREATE_NUMBER(-AS_NUMBER(A));
+			} NEXT();
+
+			CASE(OP_ADD_RR):
+				REGISTER_OP(CREATE_NUMBER(a + b), OP_ADD, READ_REG);
+				NEXT();
+
+			CASE(OP_SUB_RR):
+				REGISTER_OP(CREATE_NUMBER(a - b), OP_SUB, READ_REG);
+				NEXT();
+
+			CASE(OP_MUL_RR):
+				REGISTER_OP(CREATE_NUMBER(a * b), OP_MUL, READ_REG);
+				NEXT();
+
+			CASE(OP_DIV_RR):
+				REGISTER_OP(CREATE_NUMBER(a / b), OP_DIV, READ_REG);
+				NEXT();
+
+			CASE(OP_MOD_RR):
+				REGISTER_OP(CREATE_NUMBER(fmod(a, b)), OP_MOD, READ_REG);
+				NEXT();
+
+			CASE(OP_EQUAL_RR):
+				REGISTER_OP(CREATE_BOOL(a == b), OP_EQUAL, READ_REG);
+				NEXT();
+
+			CASE(OP_GREATER_RR):
+				REGISTER_OP(CREATE_BOOL(a > b), OP_GREATER, READ_REG);
+				NEXT();
+
+			CASE(OP_GREATER_EQUAL_RR):
+				REGISTER_OP(CREATE_BOOL(a >= b), OP_GREATER_EQUAL, READ_REG);
+				NEXT();
+
+			CASE(OP_LESS_RR):
+				REGISTER_OP(CREATE_BOOL(a < b), OP_LESS, READ_REG);
+				NEXT();
+
+			CASE(OP_LESS_EQUAL_RR):
+				REGISTER_OP(CREATE_BOOL(a <= b), OP_LESS_EQUAL, READ_REG);
+				NEXT();
+
+			CASE(OP_ADD_RK):
+				REGISTER_OP(CREATE_NUMBER(a + b), OP_ADD, READ_CONST_16);
+				NEXT();
+
+			CASE(OP_SUB_RK):
+				REGISTER_OP(CREATE_NUMBER(a - b), OP_SUB, READ_CONST_16);
+				NEXT();
+
+			CASE(OP_MUL_RK):
+				REGISTER_OP(CREATE_NUMBER(a * b), OP_MUL, READ_CONST_16);
+				NEXT();
+
+			CASE(OP_DIV_RK):
+				REGISTER_OP(CREATE_NUMBER(a / b), OP_DIV, READ_CONST_16);
+				NEXT();
+
+			CASE(OP_MOD_RK):
+				REGISTER_OP(CREATE_NUMBER(fmod(a, b)), OP_MOD, READ_CONST_16);
+				NEXT();
+
+			CASE(OP_EQUAL_RK):
+				REGISTER_OP(CREATE_BOOL(a == b), OP_EQUAL, READ_CONST_16);
+				NEXT();
+
+			CASE(OP_GREATER_RK):
+				REGISTER_OP(CREATE_BOOL(a > b), OP_GREATER, READ_CONST_16);
+				NEXT();
+
+			CASE(OP_GREATER_EQUAL_RK):
+				REGISTER_OP(CREATE_BOOL(a >= b), OP_GREATER_EQUAL, READ_CONST_16);
+				NEXT();
+
+			CASE(OP_LESS_RK):
+				REGISTER_OP(CREATE_BOOL(a < b), OP_LESS, READ_CONST_16);
+				NEXT();
+
+			CASE(OP_LESS_EQUAL_RK):
+				REGISTER_OP(CREATE_BOOL(a <= b), OP_LESS_EQUAL, READ_CONST_16);
+				NEXT();
+
+			CASE(OP_ADD_RRR):
+				REGISTER_STORE_OP(CREATE_NUMBER(a + b), OP_ADD, READ_REG);
+				NEXT();
+
+			CASE(OP_SUB_RRR):
+				REGISTER_STORE_OP(CREATE_NUMBER(a - b), OP_SUB, READ_REG);
+				NEXT();
+
+			CASE(OP_MUL_RRR):
+				REGISTER_STORE_OP(CREATE_NUMBER(a * b), OP_MUL, READ_REG);
+				NEXT();
+
+			CASE(OP_DIV_RRR):
+				REGISTER_STORE_OP(CREATE_NUMBER(a / b), OP_DIV, READ_REG);
+				NEXT();
+
+			CASE(OP_MOD_RRR):
+				REGISTER_STORE_OP(CREATE_NUMBER(fmod(a, b)), OP_MOD, READ_REG);
+				NEXT();
+
+			CASE(OP_ADD_RRK):
+				REGISTER_STORE_OP(CREATE_NUMBER(a + b), OP_ADD, READ_CONST_16);
+				NEXT();
+
+			CASE(OP_SUB_RRK):
+				REGISTER_STORE_OP(CREATE_NUMBER(a - b), OP_SUB, READ_CONST_16);
+				NEXT();
+
+			CASE(OP_MUL_RRK):
+				REGISTER_STORE_OP(CREATE_NUMBER(a * b), OP_MUL, READ_CONST_16);
+				NEXT();
+
+			CASE(OP_DIV_RRK):
+				REGISTER_STORE_OP(CREATE_NUMBER(a / b), OP_DIV, READ_CONST_16);
+				NEXT();
+
+			CASE(OP_MOD_RRK):
+				REGISTER_STORE_OP(CREATE_NUMBER(fmod(a, b)), OP_MOD, READ_CONST_16);
+				NEXT();
+
+#define SUPER_CASE(NAME, LENGTH, COUNT, ...)       \
+	CASE(NAME) : {                                 \
+		SUPER_EACH(SUPER_STEP, COUNT, __VA_ARGS__) \
+	}                                              \
+	NEXT();
+			SUPERINSTRUCTIONS(SUPER_CASE)
+#undef SUPER_CASE
+
+			CASE_UNKNOWN:
+				errWarn(chunkGetLine(&frame->closure->function->chunk,
+									 (size_t)(fp - 1 - frame->closure->function->chunk.code)),
+						"OPCODE desconhecido encontrado! -> ");
+				printf("%02x\n", *(fp - 1));
+				NEXT();
+
+#if defined(JIT) && defined(COMPUTED_GOTO)
+			/* Grava a instrução antes de executá-la */
+			LABEL_RECORD:
+				--fp;
+				JIT_RECORDING(jitRecord(frame, fp));
+				goto *dispatchTable[READ_8()];
+#endif
 		}
 	}
 }
 
+#ifdef COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+
 Result vmInterpret(const char *SOURCE) {
 	ObjFunction *function = compCompile(SOURCE);
 
@@ -1098,9 +2153,14 @@ Result vmInterpret(const char *SOURCE) {
 		return RESULT_COMPILER_ERROR;
 	}
 
+	return vmInterpretFunction(function);
+}
+
+Result vmInterpretFunction(ObjFunction *function) {
+	const bool WAS_LOCKED = vm.isLocked;
 	vm.isLocked = true;
 	ObjClosure *closure = objMakeClosure(function);
-	vm.isLocked = false;
+	vm.isLocked = WAS_LOCKED;
 
 	vmPush(CREATE_OBJECT(closure));
 	_call(closure, 0);
@@ -1118,4 +2178,17 @@ Result vmInterpret(const char *SOURCE) {
 #undef READ_STRING_16
 #undef READ_STRING_32
 
+#undef READ_CACHE
+
 #undef BINARY_OP
+#undef BINARY_OP_NUM
+#undef READ_REG
+#undef REGISTER_OP
+#undef REGISTER_STORE_OP
+#undef QUICKEN
+#undef DEOPT
+
+#undef DISPATCH
+#undef CASE
+#undef CASE_UNKNOWN
+#undef NEXT